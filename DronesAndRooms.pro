@@ -4,28 +4,69 @@ greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 CONFIG += c++17
 
+# per-stage timers and profiler overlay: qmake CONFIG+=profiling
+profiling: DEFINES += DRONES_PROFILING
+
 # You can make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    batchrunner.cpp \
     canvas.cpp \
     determinant.cpp \
+    dronegrid.cpp \
+    fleet.cpp \
+    handoffbatch.cpp \
+    hittest.cpp \
     main.cpp \
     mainwindow.cpp \
+    mapbuilder.cpp \
+    maploader.cpp \
+    navigationgraph.cpp \
     polygon.cpp \
+    predicates.cpp \
+    profiler.cpp \
+    room.cpp \
+    routeplanner.cpp \
+    router.cpp \
+    rtree.cpp \
+    scenariogenerator.cpp \
     serveranddrone.cpp \
+    servermap.cpp \
+    telemetry.cpp \
     trianglemesh.cpp \
-    vector2d.cpp
+    vector2d.cpp \
+    voronoicells.cpp
 
 HEADERS += \
+    batchrunner.h \
+    buildprogress.h \
     canvas.h \
     determinant.h \
+    dronegrid.h \
+    fleet.h \
+    handoffbatch.h \
+    hittest.h \
     mainwindow.h \
+    mapbuilder.h \
+    maploader.h \
+    navigationgraph.h \
     polygon.h \
+    predicates.h \
+    profiler.h \
+    room.h \
+    routeplanner.h \
+    router.h \
+    rtree.h \
+    scenariogenerator.h \
+    scratchbuffer.h \
     serveranddrone.h \
+    servermap.h \
+    telemetry.h \
     trianglemesh.h \
-    vector2d.h
+    vector2d.h \
+    voronoicells.h
 
 FORMS += \
     mainwindow.ui
@@ -37,5 +78,6 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 
 DISTFILES += \
     json/arcane.json \
+    json/rooms.json \
     json/simple.json \
     media/drone.png
@@ -0,0 +1,283 @@
+#include "batchrunner.h"
+#include <QFile>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QAtomicInt>
+#include <QDebug>
+#include <QHash>
+#include <algorithm>
+#include <functional>
+#include <fleet.h>
+
+namespace {
+/**
+ * @brief expand : each run is replaced by one copy per value
+ */
+template<class T> void expand(QVector<BatchRun> &runs,const QVector<T> &values,const std::function<void(BatchRun&,const T&)> &set) {
+    if (values.isEmpty()) return;
+    QVector<BatchRun> res;
+    res.reserve(runs.size()*values.size());
+    for (auto &r:runs) {
+        for (auto &v:values) {
+            res.append(r);
+            set(res.last(),v);
+        }
+    }
+    runs.swap(res);
+}
+
+bool toReals(const QStringList &lst,QVector<qreal> &res) {
+    for (auto &s:lst) {
+        bool ok;
+        qreal v=s.toDouble(&ok);
+        if (!ok || v<0) return false;
+        res.append(v);
+    }
+    return true;
+}
+
+/**
+ * @brief toInts : list of positive integers, "a-b" is the range from a to b
+ */
+bool toInts(const QStringList &lst,QVector<int> &res) {
+    for (auto &s:lst) {
+        auto bounds=s.split('-');
+        bool ok0,ok1=true;
+        int v0=bounds[0].toInt(&ok0),v1=v0;
+        if (bounds.size()==2) v1=bounds[1].toInt(&ok1);
+        if (!ok0 || !ok1 || bounds.size()>2 || v0<0 || v1<v0) return false;
+        for (int v=v0; v<=v1; v++) res.append(v);
+    }
+    return true;
+}
+}
+
+int BatchRunner::exec(const QStringList &args) {
+    QString error;
+    if (!parseArguments(args,error)) {
+        qWarning().noquote() << error;
+        qWarning().noquote() << "usage: DronesAndRooms --batch=results.csv [--layouts=uniform,clustered,grid,collinear]"
+                             << "[--servers=20] [--map-seeds=1] [--drones=100] [--seeds=1-8] [--acceleration=2] [--speed-max=1]"
+                             << "[--speed-local=0.1] [--slow-down=20] [--min-distance=5] [--dt=0.1] [--max-time=3600]"
+                             << "[--window=1200,900] [--threads=n]";
+        return 1;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    run();
+    if (!writeCsv(output)) {
+        qWarning() << "Impossible d'ouvrir le fichier:" << output;
+        return 2;
+    }
+    qInfo().noquote() << QString("%1 runs in %2 s, results in %3").arg(runs.size()).arg(timer.elapsed()/1000.0).arg(output);
+    return 0;
+}
+
+bool BatchRunner::parseArguments(const QStringList &args,QString &error) {
+    QVector<ScenarioGenerator::Layout> layouts;
+    QVector<int> servers,mapSeeds,drones,seeds;
+    QVector<qreal> acceleration,speedMax,speedLocal,slowDown,minDist;
+    for (int i=1; i<args.size(); i++) {
+        int eq=args[i].indexOf('=');
+        QString name=args[i].left(eq);
+        QStringList values=(eq<0)?QStringList():args[i].mid(eq+1).split(',');
+        bool ok=!values.isEmpty();
+        if (name=="--batch") {
+            output=values.value(0);
+            ok=!output.isEmpty();
+        } else if (name=="--layouts") {
+            for (auto &v:values) {
+                int l=0;
+                while (l<=ScenarioGenerator::Collinear && ScenarioGenerator::layoutName(ScenarioGenerator::Layout(l))!=v) l++;
+                ok=ok && l<=ScenarioGenerator::Collinear;
+                layouts.append(ScenarioGenerator::Layout(l));
+            }
+        } else if (name=="--servers") {
+            ok=ok && toInts(values,servers);
+        } else if (name=="--map-seeds") {
+            ok=ok && toInts(values,mapSeeds);
+        } else if (name=="--drones") {
+            ok=ok && toInts(values,drones);
+        } else if (name=="--seeds") {
+            ok=ok && toInts(values,seeds);
+        } else if (name=="--acceleration") {
+            ok=ok && toReals(values,acceleration);
+        } else if (name=="--speed-max") {
+            ok=ok && toReals(values,speedMax);
+        } else if (name=="--speed-local") {
+            ok=ok && toReals(values,speedLocal);
+        } else if (name=="--slow-down") {
+            ok=ok && toReals(values,slowDown);
+        } else if (name=="--min-distance") {
+            ok=ok && toReals(values,minDist);
+        } else if (name=="--dt") {
+            dt=values.value(0).toDouble(&ok);
+            ok=ok && dt>0;
+        } else if (name=="--max-time") {
+            maxTime=values.value(0).toDouble(&ok);
+        } else if (name=="--window") {
+            bool okH=false;
+            window=QRect(0,0,values.value(0).toInt(&ok),values.value(1).toInt(&okH));
+            ok=ok && okH && !window.isEmpty();
+        } else if (name=="--threads") {
+            nbThreads=values.value(0).toInt(&ok);
+        } else {
+            ok=false;
+        }
+        if (!ok) {
+            error="bad argument: "+args[i];
+            return false;
+        }
+    }
+    if (output.isEmpty()) {
+        error="missing --batch=file.csv";
+        return false;
+    }
+    // the seeds vary first, then the motion parameters, then the scenario
+    runs={BatchRun()};
+    expand<ScenarioGenerator::Layout>(runs,layouts,[](BatchRun &r,const ScenarioGenerator::Layout &v) { r.layout=v; });
+    expand<int>(runs,servers,[](BatchRun &r,const int &v) { r.nbServers=v; });
+    expand<int>(runs,mapSeeds,[](BatchRun &r,const int &v) { r.mapSeed=quint32(v); });
+    expand<int>(runs,drones,[](BatchRun &r,const int &v) { r.nbDrones=v; });
+    expand<qreal>(runs,acceleration,[](BatchRun &r,const qreal &v) { r.motion.acceleration=v; });
+    expand<qreal>(runs,speedMax,[](BatchRun &r,const qreal &v) { r.motion.speedMax=v; });
+    expand<qreal>(runs,speedLocal,[](BatchRun &r,const qreal &v) { r.motion.speedLocal=v; });
+    expand<qreal>(runs,slowDown,[](BatchRun &r,const qreal &v) { r.motion.slowDownDistance=v; });
+    expand<qreal>(runs,minDist,[](BatchRun &r,const qreal &v) { r.motion.minDistance=v; });
+    expand<int>(runs,seeds,[](BatchRun &r,const int &v) { r.seed=quint32(v); });
+    for (auto &r:runs) {
+        if (r.nbServers<3 || r.motion.slowDownDistance<=0 || r.motion.minDistance<=0) {
+            error="at least 3 servers, slow down and minimal distances greater than 0";
+            return false;
+        }
+        // the servers have distinct integer positions in the window
+        if (qint64(r.nbServers)>qint64(window.width())*window.height()) {
+            error=QString("%1 servers do not fit in a %2x%3 window").arg(r.nbServers).arg(window.width()).arg(window.height());
+            return false;
+        }
+    }
+    return true;
+}
+
+void BatchRunner::run() {
+    QThreadPool pool;
+    if (nbThreads>0) pool.setMaxThreadCount(nbThreads);
+    // one map per layout, number of servers, map seed and slow down distance (clearance of the
+    // navigation graph), built in parallel before the runs
+    QHash<QString,int> mapIds;
+    QVector<int> mapOf(runs.size());
+    QVector<const BatchRun*> mapRuns;
+    for (int i=0; i<runs.size(); i++) {
+        QString key=QString("%1/%2/%3/%4").arg(int(runs[i].layout)).arg(runs[i].nbServers).arg(runs[i].mapSeed).arg(runs[i].motion.slowDownDistance);
+        if (!mapIds.contains(key)) {
+            mapIds.insert(key,mapRuns.size());
+            mapRuns.append(&runs[i]);
+        }
+        mapOf[i]=mapIds.value(key);
+    }
+    QVector<ServerMapPtr> maps(mapRuns.size());
+    for (int k=0; k<mapRuns.size(); k++) {
+        pool.start([this,k,&maps,&mapRuns]() { maps[k]=createMap(*mapRuns[k],window); });
+    }
+    pool.waitForDone();
+
+    // the longest runs first: the last threads do not wait for a large run
+    QVector<int> order(runs.size());
+    for (int i=0; i<runs.size(); i++) order[i]=i;
+    std::stable_sort(order.begin(),order.end(),[this](int a,int b) {
+        return qint64(runs[a].nbDrones)*runs[a].nbServers>qint64(runs[b].nbDrones)*runs[b].nbServers;
+    });
+    QAtomicInt done=0;
+    const int total=runs.size();
+    // each run only writes in its own BatchRun: the results do not depend on the scheduling
+    for (int i:order) {
+        BatchRun *r=&runs[i];
+        const ServerMapPtr &map=maps[mapOf[i]];
+        pool.start([this,r,&map,&done,total]() {
+            simulate(*r,map,dt,maxTime);
+            qInfo().noquote() << QString("run %1/%2: %3 drones arrived in %4 s").arg(done.fetchAndAddRelaxed(1)+1).arg(total)
+                                     .arg(r->arrived).arg(r->simulatedTime);
+        });
+    }
+    pool.waitForDone();
+}
+
+bool BatchRunner::writeCsv(const QString &fileName) const {
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
+    QTextStream out(&file);
+    out << "layout,servers,mapSeed,drones,seed,acceleration,speedMax,speedLocal,slowDownDistance,minDistance,"
+        << "arrived,meanTimeToTarget,maxTimeToTarget,handoffs,distanceFlown,simulatedTime,wallMs\n";
+    for (auto &r:runs) {
+        out << ScenarioGenerator::layoutName(r.layout) << "," << r.nbServers << "," << r.mapSeed << "," << r.nbDrones << "," << r.seed << ","
+            << r.motion.acceleration << "," << r.motion.speedMax << "," << r.motion.speedLocal << ","
+            << r.motion.slowDownDistance << "," << r.motion.minDistance << ","
+            << r.arrived << "," << r.meanTimeToTarget << "," << r.maxTimeToTarget << "," << r.handoffs << ","
+            << r.distanceFlown << "," << r.simulatedTime << "," << r.wallMs << "\n";
+    }
+    return true;
+}
+
+ServerMapPtr BatchRunner::createMap(const BatchRun &run,const QRect &window) {
+    ScenarioGenerator gen(run.mapSeed);
+    QSharedPointer<ServerMap> map(new ServerMap);
+    map->origin=window.topLeft();
+    map->size=window.size();
+    map->servers=gen.servers(run.layout,run.nbServers,window);
+    map->wallClearance=run.motion.slowDownDistance;
+    map->build();
+    return map;
+}
+
+void BatchRunner::simulate(BatchRun &run,const ServerMapPtr &map,qreal dt,qreal maxTime) {
+    QElapsedTimer timer;
+    timer.start();
+    ScenarioGenerator gen(run.seed);
+    const QRect window(map->origin,map->size);
+    // same steps as MainWindow::update with a fixed time step
+    Fleet fleet;
+    fleet.motion=run.motion;
+    fleet.reset(map,gen.drones(run.nbDrones,map->servers,window));
+    const QList<Drone> &drones=fleet.drones;
+
+    QVector<qreal> arrival(drones.size(),-1);
+    QVector<Vector2D> previous(drones.size(),Vector2D(0,0));
+    int remaining=0;
+    for (auto &drone:drones) {
+        if (drone.hasTarget()) remaining++;
+    }
+    qreal time=0;
+    while (remaining>0 && time<maxTime) {
+        for (int i=0; i<drones.size(); i++) {
+            previous[i]=drones[i].position;
+        }
+        fleet.step(dt);
+        time+=dt;
+        for (int i=0; i<drones.size(); i++) {
+            const Drone &drone=drones[i];
+            run.distanceFlown+=(drone.position-previous[i]).length();
+            if (arrival[i]<0 && drone.hasTarget()) {
+                const QPointF &p=map->servers[drone.target].position;
+                Vector2D target(p.x(),p.y());
+                if ((drone.position-target).length()<run.motion.slowDownDistance) {
+                    arrival[i]=time;
+                    remaining--;
+                }
+            }
+        }
+    }
+    run.simulatedTime=time;
+    run.arrived=0;
+    run.meanTimeToTarget=run.maxTimeToTarget=0;
+    for (qreal t:arrival) {
+        if (t<0) continue;
+        run.arrived++;
+        run.meanTimeToTarget+=t;
+        run.maxTimeToTarget=qMax(run.maxTimeToTarget,t);
+    }
+    if (run.arrived>0) run.meanTimeToTarget/=run.arrived;
+    run.handoffs=0;
+    for (auto &l:fleet.loads) run.handoffs+=l.handoffsIn;
+    run.wallMs=timer.elapsed();
+}
@@ -0,0 +1,81 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <QVector>
+#include <QStringList>
+#include <QRect>
+#include <servermap.h>
+#include <scenariogenerator.h>
+
+/**
+ * @brief The BatchRun struct : one simulation of a parameter sweep and its metrics
+ */
+struct BatchRun {
+    ScenarioGenerator::Layout layout=ScenarioGenerator::Uniform;
+    int nbServers=20;
+    int nbDrones=100;
+    quint32 mapSeed=1; ///< seed of the servers, the runs with the same map share it
+    quint32 seed=1; ///< seed of the drones
+    MotionParameters motion;
+    // metrics
+    int arrived=0; ///< drones that reached their target
+    qreal meanTimeToTarget=0; ///< s, mean of the drones that arrived
+    qreal maxTimeToTarget=0; ///< s
+    int handoffs=0; ///< changes of cell of all the drones
+    qreal distanceFlown=0; ///< sum of the distances flown by the drones
+    qreal simulatedTime=0; ///< s, until all the drones arrived or the time limit
+    qint64 wallMs=0; ///< duration of the run (without the build of the shared map)
+};
+
+/**
+ * @brief The BatchRunner class runs the simulations of a parameter sweep without GUI:
+ * each combination of layout, numbers of servers and drones, seed and motion parameters
+ * is an independent run with a fixed time step (same arguments, same results), the runs
+ * are spread on a thread pool and the metrics are written in CSV, one line per run.
+ * The runs with the same layout, number of servers and map seed fly over one shared
+ * ServerMap, built once: only the fleets (drones and loads) are per run.
+ * Usage: DronesAndRooms --batch=results.csv --layouts=uniform,clustered --drones=100,1000
+ *        --seeds=1-16 --speed-max=0.5,1,2
+ */
+class BatchRunner {
+public:
+    /**
+     * @brief exec : parse the arguments, run the sweep and write the CSV file
+     * @param args command line arguments
+     * @return exit code of the program
+     */
+    int exec(const QStringList &args);
+    /**
+     * @brief parseArguments : build the list of runs (cartesian product of the lists of values)
+     * @param error message if the arguments are not valid
+     * @return false if the arguments are not valid
+     */
+    bool parseArguments(const QStringList &args,QString &error);
+    /**
+     * @brief run : build the maps, then execute all the runs on a thread pool (--threads, all the cores by default)
+     */
+    void run();
+    bool writeCsv(const QString &fileName) const;
+    /**
+     * @brief createMap : servers of run.layout, run.nbServers and run.mapSeed in window, and their cells, links and router
+     */
+    static ServerMapPtr createMap(const BatchRun &run,const QRect &window);
+    /**
+     * @brief simulate : fly the drones of the run over map until they all reached
+     * their target or maxTime, the metrics are stored in run
+     * @param map map created for the layout, servers and map seed of the run
+     * @param dt time step (s)
+     * @param maxTime time limit (s)
+     */
+    static void simulate(BatchRun &run,const ServerMapPtr &map,qreal dt,qreal maxTime);
+    const QVector<BatchRun>& getRuns() const { return runs; }
+private:
+    QVector<BatchRun> runs;
+    QString output; ///< CSV file
+    QRect window{0,0,1200,900};
+    qreal dt=0.1;
+    qreal maxTime=3600;
+    int nbThreads=0; ///< 0: QThread::idealThreadCount()
+};
+
+#endif // BATCHRUNNER_H
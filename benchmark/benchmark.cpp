@@ -0,0 +1,155 @@
+#include "benchmark.h"
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QDateTime>
+#include <QHash>
+#include <QThread>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace {
+std::atomic<qint64> allocations{0};
+}
+
+#if defined(__GLIBC__)
+// Qt containers allocate with malloc: the allocation functions of the C library are
+// replaced by counting ones (operator new calls malloc)
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n,size_t size);
+void *__libc_realloc(void *p,size_t size);
+void __libc_free(void *p);
+
+void *malloc(size_t size) {
+    allocations.fetch_add(1,std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+void *calloc(size_t n,size_t size) {
+    allocations.fetch_add(1,std::memory_order_relaxed);
+    return __libc_calloc(n,size);
+}
+void *realloc(void *p,size_t size) {
+    allocations.fetch_add(1,std::memory_order_relaxed);
+    return __libc_realloc(p,size);
+}
+void free(void *p) {
+    __libc_free(p);
+}
+}
+#else
+void *operator new(std::size_t size) {
+    allocations.fetch_add(1,std::memory_order_relaxed);
+    if (void *p=std::malloc(size?size:1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p,std::size_t) noexcept { std::free(p); }
+#endif
+
+qint64 allocationCount() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+namespace {
+/**
+ * @brief resetPeakMemory : the peak of the next case is measured from the current memory (Linux only)
+ */
+void resetPeakMemory() {
+#if defined(__linux__)
+    if (FILE *f=fopen("/proc/self/clear_refs","w")) {
+        fputs("5",f);
+        fclose(f);
+    }
+#endif
+}
+}
+
+qint64 peakMemoryKb() {
+#if defined(__linux__)
+    // VmHWM is reset by resetPeakMemory, ru_maxrss is not
+    if (FILE *f=fopen("/proc/self/status","r")) {
+        char line[256];
+        long long kb=-1;
+        while (kb<0 && fgets(line,sizeof(line),f)) {
+            if (sscanf(line,"VmHWM: %lld kB",&kb)!=1) kb=-1;
+        }
+        fclose(f);
+        if (kb>=0) return kb;
+    }
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF,&usage)!=0) return 0;
+#if defined(__APPLE__)
+    return usage.ru_maxrss/1024; // bytes
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
+
+QJsonDocument BenchmarkSuite::run(const QString &filter,qint64 minTimeNs,quint32 seed) {
+    QJsonObject context;
+    context["date"]=QDateTime::currentDateTime().toString(Qt::ISODate);
+    context["num_cpus"]=QThread::idealThreadCount();
+    context["seed"]=qint64(seed);
+#ifdef QT_NO_DEBUG
+    context["library_build_type"]="release";
+#else
+    context["library_build_type"]="debug";
+#endif
+    QJsonArray results;
+    printf("%-45s %15s %12s %15s %12s %12s\n","Benchmark","Time (ns)","Iterations","Items/s","Allocs/iter","Peak RSS kB");
+    for (auto &c:cases) {
+        if (!filter.isEmpty() && !c.name.contains(filter)) continue;
+        BenchmarkState state(minTimeNs);
+        resetPeakMemory();
+        c.run(state);
+        printf("%-45s %15.0f %12lld %15.0f %12.1f %12lld\n",qPrintable(c.name),state.nsPerIteration(),
+               state.getIterations(),state.itemsPerSecond(),state.allocationsPerIteration(),peakMemoryKb());
+        fflush(stdout);
+        QJsonObject obj;
+        obj["name"]=c.name;
+        obj["run_type"]="iteration";
+        obj["iterations"]=state.getIterations();
+        obj["real_time"]=state.nsPerIteration();
+        obj["cpu_time"]=state.nsPerIteration();
+        obj["time_unit"]="ns";
+        if (state.getItems()>0) obj["items_per_second"]=state.itemsPerSecond();
+        obj["allocs_per_iter"]=state.allocationsPerIteration();
+        obj["peak_rss_kb"]=peakMemoryKb();
+        results.append(obj);
+    }
+    QJsonObject root;
+    root["context"]=context;
+    root["benchmarks"]=results;
+    return QJsonDocument(root);
+}
+
+int BenchmarkSuite::compare(const QJsonDocument &results,const QJsonDocument &baseline,qreal maxSlowdown) {
+    QHash<QString,qreal> baseTimes;
+    for (const QJsonValue &v:baseline.object().value("benchmarks").toArray()) {
+        QJsonObject obj=v.toObject();
+        baseTimes[obj.value("name").toString()]=obj.value("real_time").toDouble();
+    }
+    int regressions=0;
+    printf("\n%-45s %15s %15s %8s\n","Benchmark","Baseline (ns)","Time (ns)","Ratio");
+    for (const QJsonValue &v:results.object().value("benchmarks").toArray()) {
+        QJsonObject obj=v.toObject();
+        QString name=obj.value("name").toString();
+        qreal base=baseTimes.value(name,0);
+        if (base<=0) continue;
+        qreal time=obj.value("real_time").toDouble();
+        bool regression=time>maxSlowdown*base;
+        if (regression) regressions++;
+        printf("%-45s %15.0f %15.0f %8.2f%s\n",qPrintable(name),base,time,time/base,regression?" REGRESSION":"");
+    }
+    printf("%d regression(s) above x%.2f\n",regressions,maxSlowdown);
+    return regressions;
+}
@@ -0,0 +1,126 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QVector>
+#include <QJsonDocument>
+#include <functional>
+#include <atomic>
+
+/**
+ * @brief allocationCount : number of heap allocations since the start of the program
+ * (malloc is counted with glibc, operator new on the other platforms)
+ */
+qint64 allocationCount();
+/**
+ * @brief peakMemoryKb : peak resident set size of the process in kB, 0 if unknown
+ * (peak of the current case on Linux, of the process elsewhere)
+ */
+qint64 peakMemoryKb();
+
+/**
+ * @brief The BenchmarkState class drives the loop of a benchmark case
+ * (same usage as Google Benchmark: while (state.keepRunning()) { ... }).
+ * The loop runs until minTime is spent in the timed part.
+ */
+class BenchmarkState {
+public:
+    BenchmarkState(qint64 p_minTimeNs):minTimeNs(p_minTimeNs) {}
+    bool keepRunning() {
+        if (!started) {
+            started=true;
+            allocationsStart=allocationCount();
+            timer.start();
+            return true;
+        }
+        iterations++;
+        if (timer.nsecsElapsed()-pausedNs>=minTimeNs) {
+            timeNs=timer.nsecsElapsed()-pausedNs;
+            allocations=allocationCount()-allocationsStart-pausedAllocations;
+            return false;
+        }
+        return true;
+    }
+    /**
+     * @brief pauseTiming/resumeTiming exclude the preparation of an iteration from the measure
+     * (time and allocations)
+     */
+    void pauseTiming() {
+        pauseStart=timer.nsecsElapsed();
+        pauseAllocations=allocationCount();
+    }
+    void resumeTiming() {
+        pausedNs+=timer.nsecsElapsed()-pauseStart;
+        pausedAllocations+=allocationCount()-pauseAllocations;
+    }
+    /**
+     * @brief setItemsPerIteration : number of processed items (points, drones...) by an iteration
+     */
+    void setItemsPerIteration(qint64 n) { items=n; }
+    qint64 getIterations() const { return iterations; }
+    qreal nsPerIteration() const { return iterations>0?qreal(timeNs)/iterations:0; }
+    qreal itemsPerSecond() const { return timeNs>0?1e9*items*iterations/timeNs:0; }
+    qint64 getItems() const { return items; }
+    qreal allocationsPerIteration() const { return iterations>0?qreal(allocations)/iterations:0; }
+private:
+    QElapsedTimer timer;
+    qint64 minTimeNs;
+    bool started=false;
+    qint64 iterations=0;
+    qint64 timeNs=0;
+    qint64 pausedNs=0;
+    qint64 pauseStart=0;
+    qint64 items=0;
+    qint64 allocationsStart=0;
+    qint64 pauseAllocations=0;
+    qint64 pausedAllocations=0;
+    qint64 allocations=0;
+};
+
+/**
+ * @brief doNotOptimize : force the computation of value (and the escape of a pointer),
+ * clobberMemory : force the reload of the escaped memory (same as Google Benchmark).
+ */
+#if defined(__GNUC__)
+template<class T> inline void doNotOptimize(const T &value) { asm volatile("" : : "r,m"(value) : "memory"); }
+inline void clobberMemory() { asm volatile("" : : : "memory"); }
+#else
+template<class T> inline void doNotOptimize(const T &value) {
+    static volatile const void *sink;
+    sink=&value;
+}
+inline void clobberMemory() { std::atomic_signal_fence(std::memory_order_acq_rel); }
+#endif
+
+/**
+ * @brief The BenchmarkSuite class registers and runs the cases, results are printed
+ * and can be saved in the JSON format of Google Benchmark (to compare releases).
+ */
+class BenchmarkSuite {
+public:
+    void add(const QString &name,std::function<void(BenchmarkState&)> run) {
+        cases.push_back({name,run});
+    }
+    /**
+     * @brief run : run the cases whose name contains filter
+     * @param minTimeNs minimal measured time per case
+     * @return the results in the Google Benchmark JSON format
+     */
+    QJsonDocument run(const QString &filter,qint64 minTimeNs,quint32 seed);
+    /**
+     * @brief compare : performance regression gate, the time of each case is compared with the
+     * same case of a baseline saved with --out (cases missing in the baseline are skipped)
+     * @param maxSlowdown a case regresses when its time is above maxSlowdown times the baseline
+     * @return the number of regressions
+     */
+    static int compare(const QJsonDocument &results,const QJsonDocument &baseline,qreal maxSlowdown);
+private:
+    struct Case {
+        QString name;
+        std::function<void(BenchmarkState&)> run;
+    };
+    QVector<Case> cases;
+};
+
+#endif // BENCHMARK_H
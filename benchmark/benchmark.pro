@@ -0,0 +1,56 @@
+QT       += core gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = benchmark
+
+# per-stage timers: qmake CONFIG+=profiling
+profiling: DEFINES += DRONES_PROFILING
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    benchmark.cpp \
+    crosscheck.cpp \
+    main.cpp \
+    ../determinant.cpp \
+    ../dronegrid.cpp \
+    ../hittest.cpp \
+    ../mapbuilder.cpp \
+    ../navigationgraph.cpp \
+    ../polygon.cpp \
+    ../predicates.cpp \
+    ../profiler.cpp \
+    ../room.cpp \
+    ../router.cpp \
+    ../rtree.cpp \
+    ../scenariogenerator.cpp \
+    ../serveranddrone.cpp \
+    ../telemetry.cpp \
+    ../trianglemesh.cpp \
+    ../vector2d.cpp \
+    ../voronoicells.cpp
+
+HEADERS += \
+    benchmark.h \
+    crosscheck.h \
+    ../buildprogress.h \
+    ../determinant.h \
+    ../dronegrid.h \
+    ../hittest.h \
+    ../mapbuilder.h \
+    ../navigationgraph.h \
+    ../polygon.h \
+    ../predicates.h \
+    ../profiler.h \
+    ../room.h \
+    ../router.h \
+    ../rtree.h \
+    ../scratchbuffer.h \
+    ../scenariogenerator.h \
+    ../serveranddrone.h \
+    ../telemetry.h \
+    ../trianglemesh.h \
+    ../vector2d.h \
+    ../voronoicells.h
@@ -0,0 +1,865 @@
+#include "crosscheck.h"
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QRandomGenerator>
+#include <QSet>
+#include <QHash>
+#include <QDir>
+#include <QFile>
+#include <cstdio>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <scenariogenerator.h>
+#include <mapbuilder.h>
+#include <trianglemesh.h>
+#include <voronoicells.h>
+#include <predicates.h>
+#include <telemetry.h>
+
+int CrossCheckSuite::run(const QString &filter,quint32 firstSeed,int nbSeeds) {
+    const int maxReported=3;
+    int total=0;
+    printf("%-45s %8s %9s %12s\n","Check","Seeds","Failures","Time (ms)");
+    for (auto &c:checks) {
+        if (!filter.isEmpty() && !c.name.contains(filter)) continue;
+        QStringList errors;
+        int failures=0;
+        QElapsedTimer timer;
+        timer.start();
+        for (int i=0; i<nbSeeds; i++) {
+            quint32 seed=firstSeed+i;
+            QString error;
+            if (!c.check(seed,error)) {
+                if (failures<maxReported) errors << QString("  seed %1: %2").arg(seed).arg(error);
+                failures++;
+            }
+        }
+        printf("%-45s %8d %9d %12lld\n",qPrintable(c.name),nbSeeds,failures,(long long)timer.elapsed());
+        for (auto &e:errors) printf("%s\n",qPrintable(e));
+        fflush(stdout);
+        total+=failures;
+    }
+    return total;
+}
+
+namespace {
+const QRect window(0,0,1000,1000);
+const int maxPoints=48; ///< the references are in O(n^3)
+const int nbLayouts=8;
+
+double orient(const Vector2D &a,const Vector2D &b,const Vector2D &c) {
+    return orient2d(a.x,a.y,b.x,b.y,c.x,c.y);
+}
+
+/**
+ * @brief onSegment : p (collinear with a and b) is in [ab]
+ */
+bool onSegment(const Vector2D &a,const Vector2D &b,const Vector2D &p) {
+    return qMin(a.x,b.x)<=p.x && p.x<=qMax(a.x,b.x) && qMin(a.y,b.y)<=p.y && p.y<=qMax(a.y,b.y);
+}
+
+double distance2(const Vector2D &a,const Vector2D &b) {
+    double dx=double(a.x)-b.x,dy=double(a.y)-b.y;
+    return dx*dx+dy*dy;
+}
+
+QString toString(const Vector2D &p) {
+    return QString("(%1,%2)").arg(p.x).arg(p.y);
+}
+
+QVector<Vector2D> vertices(const Polygon &poly) {
+    QVector<Vector2D> res;
+    for (int i=0; i<poly.nbVertices(); i++) res.push_back(poly[i]);
+    return res;
+}
+
+double shoelace(const QVector<Vector2D> &pts) {
+    double res=0;
+    for (int i=0; i<pts.size(); i++) {
+        const Vector2D &a=pts[i],&b=pts[(i+1)%pts.size()];
+        res+=double(a.x)*b.y-double(b.x)*a.y;
+    }
+    return 0.5*res;
+}
+
+QVector<Vector2D> distinct(QVector<Vector2D> pts) {
+    auto less=[](const Vector2D &a,const Vector2D &b) { return a.x<b.x || (a.x==b.x && a.y<b.y); };
+    std::sort(pts.begin(),pts.end(),less);
+    pts.erase(std::unique(pts.begin(),pts.end()),pts.end());
+    return pts;
+}
+
+/**
+ * @brief randomPoints : input of a seed, the layouts of the scenarios and degenerate ones
+ * (lattice: collinear and cocircular points, cocircular, all on a line, duplicated points)
+ */
+QVector<Vector2D> randomPoints(quint32 seed,QString &layout) {
+    QRandomGenerator rnd(seed);
+    int n=3+rnd.bounded(maxPoints-2);
+    QVector<Vector2D> pts;
+    int kind=seed%nbLayouts;
+    if (kind<=ScenarioGenerator::Collinear) {
+        auto l=ScenarioGenerator::Layout(kind);
+        layout=ScenarioGenerator::layoutName(l);
+        ScenarioGenerator gen(seed);
+        for (auto &p:gen.positions(l,n,window)) pts.push_back(Vector2D(p.x(),p.y()));
+    } else if (kind==4) {
+        layout="lattice";
+        for (int i=0; i<n; i++) pts.push_back(Vector2D(125*(1+rnd.bounded(7)),125*(1+rnd.bounded(7))));
+    } else if (kind==5) {
+        layout="cocircular";
+        // integer points of the circle of radius 250
+        const int triples[][2]={{0,250},{70,240},{150,200},{200,150},{240,70},{250,0}};
+        for (auto &t:triples) {
+            for (int sx:{-1,1}) {
+                for (int sy:{-1,1}) {
+                    Vector2D p(500+sx*t[0],500+sy*t[1]);
+                    if (!pts.contains(p) && (pts.size()<3 || rnd.bounded(4)!=0)) pts.push_back(p);
+                }
+            }
+        }
+        if (rnd.bounded(2)) pts.push_back(Vector2D(500,500));
+    } else if (kind==6) {
+        layout="line";
+        int dx=1+rnd.bounded(5),dy=rnd.bounded(5);
+        for (int i=0; i<n; i++) {
+            int t=rnd.bounded(150);
+            pts.push_back(Vector2D(100+t*dx,100+t*dy));
+        }
+    } else {
+        layout="duplicated";
+        int m=qMax(3,n/2);
+        for (int i=0; i<m; i++) pts.push_back(Vector2D(rnd.bounded(window.width()),rnd.bounded(window.height())));
+        for (int i=m; i<n; i++) pts.push_back(pts[rnd.bounded(m)]);
+    }
+    return pts;
+}
+
+QList<Server> toServers(const QVector<Vector2D> &points) {
+    QList<Server> servers;
+    for (int i=0; i<points.size(); i++) {
+        Server s;
+        s.id=i;
+        s.name=QString("S%1").arg(i);
+        s.position=QPointF(points[i].x,points[i].y);
+        servers.append(s);
+    }
+    return servers;
+}
+
+/**
+ * @brief referenceHull : brute-force convex hull in O(n^3), AB is an edge if all the points are
+ * on its left or in [AB]. CCW from the lowest point (lowest x for equal y) like Polygon,
+ * the two ends of collinear points.
+ */
+QVector<Vector2D> referenceHull(const QVector<Vector2D> &points) {
+    auto pts=distinct(points);
+    int n=pts.size();
+    if (n<3) return pts;
+    QVector<int> next(n,-1);
+    for (int i=0; i<n; i++) {
+        for (int j=0; j<n && next[i]==-1; j++) {
+            if (j==i) continue;
+            bool edge=true;
+            for (int k=0; k<n && edge; k++) {
+                if (k==i || k==j) continue;
+                double o=orient(pts[i],pts[j],pts[k]);
+                edge=o>0 || (o==0 && onSegment(pts[i],pts[j],pts[k]));
+            }
+            if (edge) next[i]=j;
+        }
+    }
+    int start=0;
+    for (int i=1; i<n; i++) {
+        if (pts[i].y<pts[start].y || (pts[i].y==pts[start].y && pts[i].x<pts[start].x)) start=i;
+    }
+    QVector<Vector2D> hull;
+    int i=start;
+    do {
+        hull.push_back(pts[i]);
+        i=next[i];
+    } while (i!=start && i!=-1 && hull.size()<=n);
+    return hull;
+}
+
+double shoelace(const QVector<QPointF> &pts) {
+    double res=0;
+    for (int i=0; i<pts.size(); i++) {
+        const QPointF &a=pts[i],&b=pts[(i+1)%pts.size()];
+        res+=a.x()*b.y()-b.x()*a.y();
+    }
+    return 0.5*res;
+}
+
+/**
+ * @brief monotoneHull : convex hull of double points (Andrew's monotone chain), CCW
+ */
+QVector<QPointF> monotoneHull(QVector<QPointF> pts) {
+    std::sort(pts.begin(),pts.end(),[](const QPointF &a,const QPointF &b) { return a.x()<b.x() || (a.x()==b.x() && a.y()<b.y()); });
+    pts.erase(std::unique(pts.begin(),pts.end()),pts.end());
+    if (pts.size()<3) return pts;
+    auto cross=[](const QPointF &o,const QPointF &a,const QPointF &b) {
+        return (a.x()-o.x())*(b.y()-o.y())-(a.y()-o.y())*(b.x()-o.x());
+    };
+    QVector<QPointF> hull(2*pts.size());
+    int k=0;
+    for (int i=0; i<pts.size(); i++) {
+        while (k>=2 && cross(hull[k-2],hull[k-1],pts[i])<=0) k--;
+        hull[k++]=pts[i];
+    }
+    for (int i=pts.size()-2,lower=k+1; i>=0; i--) {
+        while (k>=lower && cross(hull[k-2],hull[k-1],pts[i])<=0) k--;
+        hull[k++]=pts[i];
+    }
+    hull.resize(k-1);
+    return hull;
+}
+
+/**
+ * @brief referenceContains : crossing number (even-odd rule)
+ */
+bool referenceContains(const QVector<Vector2D> &poly,const Vector2D &p) {
+    bool inside=false;
+    for (int i=0,j=poly.size()-1; i<poly.size(); j=i++) {
+        const Vector2D &a=poly[i],&b=poly[j];
+        if ((a.y>p.y)!=(b.y>p.y) && p.x<a.x+(double(p.y)-a.y)*(double(b.x)-a.x)/(double(b.y)-a.y)) inside=!inside;
+    }
+    return inside;
+}
+
+double segmentDistance(const Vector2D &p,const Vector2D &a,const Vector2D &b) {
+    double abx=double(b.x)-a.x,aby=double(b.y)-a.y;
+    double l2=abx*abx+aby*aby;
+    double t=l2>0?qBound(0.0,((double(p.x)-a.x)*abx+(double(p.y)-a.y)*aby)/l2,1.0):0.0;
+    double dx=a.x+t*abx-p.x,dy=a.y+t*aby-p.y;
+    return std::sqrt(dx*dx+dy*dy);
+}
+
+/**
+ * @brief The HalfPlane struct : a*x+b*y+c>=0, (a,b) normed
+ */
+struct HalfPlane {
+    double a,b,c;
+    HalfPlane(double p_a,double p_b,double p_c) {
+        double l=std::sqrt(p_a*p_a+p_b*p_b);
+        a=p_a/l;
+        b=p_b/l;
+        c=p_c/l;
+    }
+    /**
+     * @brief left side of [AB]
+     */
+    static HalfPlane left(const Vector2D &A,const Vector2D &B) {
+        return HalfPlane(double(A.y)-B.y,double(B.x)-A.x,double(A.x)*B.y-double(A.y)*B.x);
+    }
+    double value(const Vector2D &p) const { return a*p.x+b*p.y+c; }
+    double value(const QPointF &p) const { return a*p.x()+b*p.y()+c; }
+};
+
+/**
+ * @brief referenceIntersection : intersection of half-planes by brute force, the convex hull of the
+ * intersections of their lines that are in all the half-planes
+ */
+QVector<QPointF> referenceIntersection(const QVector<HalfPlane> &planes) {
+    const double tolerance=1e-9;
+    QVector<QPointF> candidates;
+    for (int i=0; i<planes.size(); i++) {
+        for (int j=i+1; j<planes.size(); j++) {
+            const HalfPlane &p=planes[i],&q=planes[j];
+            double det=p.a*q.b-p.b*q.a;
+            if (std::fabs(det)<1e-12) continue;
+            QPointF x((p.b*q.c-q.b*p.c)/det,(q.a*p.c-p.a*q.c)/det);
+            bool inside=true;
+            for (auto &h:planes) inside=inside && h.value(x)>=-tolerance;
+            if (inside) candidates.push_back(x);
+        }
+    }
+    return monotoneHull(candidates);
+}
+
+/**
+ * @brief triangulationError : the triangles are a triangulation of the points (2n-h-2 CCW
+ * triangles, all the points are vertices, the area is the area of the hull)
+ * @return the failed property, empty if none
+ */
+QString triangulationError(const QVector<Vector2D> &points,const QVector<MeshTriangle> &triangles) {
+    auto pts=distinct(points);
+    auto hull=referenceHull(pts);
+    int n=pts.size();
+    if (hull.size()<3) {
+        if (!triangles.isEmpty()) return QString("%1 triangles for collinear points").arg(triangles.size());
+        return QString();
+    }
+    // points on the boundary of the hull, collinear ones included
+    int h=0;
+    for (auto &p:pts) {
+        bool onHull=false;
+        for (int k=0; k<hull.size() && !onHull; k++) {
+            const Vector2D &a=hull[k],&b=hull[(k+1)%hull.size()];
+            onHull=orient(a,b,p)==0 && onSegment(a,b,p);
+        }
+        if (onHull) h++;
+    }
+    if (triangles.size()!=2*n-h-2) {
+        return QString("%1 triangles instead of 2n-h-2=%2 (h=%3)").arg(triangles.size()).arg(2*n-h-2).arg(h);
+    }
+    double area=0;
+    QVector<Vector2D> used;
+    for (int t=0; t<triangles.size(); t++) {
+        const Vector2D a=points[triangles[t][0]],b=points[triangles[t][1]],c=points[triangles[t][2]];
+        double o=orient(a,b,c);
+        if (o<=0) return QString("triangle %1 %2 %3 %4 is not CCW").arg(t).arg(toString(a)).arg(toString(b)).arg(toString(c));
+        area+=0.5*o;
+        used << a << b << c;
+    }
+    if (distinct(used).size()!=n) return QString("%1 points are not vertices").arg(n-distinct(used).size());
+    // exact for integer coordinates: the triangles cover the hull
+    if (area!=shoelace(hull)) return QString("area of the triangles %1 instead of %2").arg(area).arg(shoelace(hull));
+    return QString();
+}
+
+bool checkTriangleMesh(quint32 seed,QString &error) {
+    QString layout;
+    auto points=randomPoints(seed,layout);
+    TriangleMesh mesh(toServers(points));
+    const QVector<MeshTriangle> &triangles=*mesh.getTriangles();
+    auto pts=distinct(points);
+    auto fail=[&](const QString &what) {
+        error=QString("%1, %2 points (%3 distinct): %4").arg(layout).arg(points.size()).arg(pts.size()).arg(what);
+        return false;
+    };
+    QString what=triangulationError(points,triangles);
+    if (!what.isEmpty()) return fail(what);
+    for (int t=0; t<triangles.size(); t++) {
+        const Vector2D a=points[triangles[t][0]],b=points[triangles[t][1]],c=points[triangles[t][2]];
+        for (auto &d:pts) {
+            if (incircle(a.x,a.y,b.x,b.y,c.x,c.y,d.x,d.y)>0) {
+                return fail(QString("%1 is in the circumcircle of triangle %2").arg(toString(d)).arg(t));
+            }
+        }
+    }
+    return true;
+}
+
+bool crosses(const Vector2D &a,const Vector2D &b,const Vector2D &c,const Vector2D &d) {
+    return orient(a,b,c)*orient(a,b,d)<0 && orient(c,d,a)*orient(c,d,b)<0;
+}
+
+/**
+ * @brief randomSegments : segments between the points that do not cross each other
+ */
+QVector<MeshEdge> randomSegments(quint32 seed,const QVector<Vector2D> &points) {
+    int n=points.size();
+    QRandomGenerator rnd(seed*2654435761u+1);
+    QVector<MeshEdge> segments;
+    for (int k=2*n; k>0; k--) {
+        int a=rnd.bounded(n),b=rnd.bounded(n);
+        if (points[a]==points[b]) continue;
+        bool crossing=false;
+        for (auto &s:segments) crossing=crossing || crosses(points[a],points[b],points[s.first],points[s.second]);
+        if (!crossing) segments.push_back({a,b});
+    }
+    return segments;
+}
+
+/**
+ * @brief checkConstrainedMesh : random segments that do not cross are inserted, each one must be
+ * a chain of constrained edges through the points on it, and the mesh locally Delaunay
+ * across the other edges (equivalent to the constrained Delaunay property)
+ */
+bool checkConstrainedMesh(quint32 seed,QString &error) {
+    QString layout;
+    auto points=randomPoints(seed,layout);
+    int n=points.size();
+    auto segments=randomSegments(seed,points);
+    TriangleMesh mesh(toServers(points),segments);
+    const QVector<MeshTriangle> &triangles=*mesh.getTriangles();
+    auto fail=[&](const QString &what) {
+        error=QString("%1, %2 points, %3 segments: %4").arg(layout).arg(n).arg(segments.size()).arg(what);
+        return false;
+    };
+    QString what=triangulationError(points,triangles);
+    if (!what.isEmpty()) return fail(what);
+    if (triangles.isEmpty()) return true;
+    // edges by position: a duplicated point is replaced by the first one
+    QVector<int> first(n);
+    for (int i=0; i<n; i++) first[i]=points.indexOf(points[i]);
+    auto key=[&first,n](int a,int b) {
+        return qint64(first[a])*n+first[b];
+    };
+    QHash<qint64,int> opposite; // directed edge -> opposite vertex
+    for (auto &tri:triangles) {
+        for (int k=0; k<3; k++) opposite[key(tri[k],tri[(k+1)%3])]=tri[(k+2)%3];
+    }
+    QSet<qint64> constrained;
+    for (auto &e:mesh.getConstraints()) {
+        constrained.insert(key(e.first,e.second));
+        constrained.insert(key(e.second,e.first));
+    }
+    for (auto &s:segments) {
+        // the points on the segment, sorted from its first end
+        const Vector2D &a=points[s.first],&b=points[s.second];
+        QVector<QPair<double,int>> on;
+        for (int i=0; i<n; i++) {
+            if (orient(a,b,points[i])==0 && onSegment(a,b,points[i])) on.push_back({distance2(a,points[i]),i});
+        }
+        std::sort(on.begin(),on.end());
+        for (int k=1; k<on.size(); k++) {
+            int u=on[k-1].second,v=on[k].second;
+            if (points[u]==points[v]) continue;
+            if (!constrained.contains(key(u,v))) {
+                return fail(QString("edge %1 %2 of segment %3 %4 is not constrained").arg(toString(points[u])).arg(toString(points[v]))
+                            .arg(toString(a)).arg(toString(b)));
+            }
+            if (!opposite.contains(key(u,v)) && !opposite.contains(key(v,u))) {
+                return fail(QString("edge %1 %2 of segment %3 %4 is not in the mesh").arg(toString(points[u])).arg(toString(points[v]))
+                            .arg(toString(a)).arg(toString(b)));
+            }
+        }
+    }
+    for (int t=0; t<triangles.size(); t++) {
+        const MeshTriangle &tri=triangles[t];
+        const Vector2D a=points[tri[0]],b=points[tri[1]],c=points[tri[2]];
+        for (int k=0; k<3; k++) {
+            qint64 reverse=key(tri[(k+1)%3],tri[k]);
+            if (constrained.contains(reverse) || !opposite.contains(reverse)) continue;
+            const Vector2D &d=points[opposite[reverse]];
+            if (incircle(a.x,a.y,b.x,b.y,c.x,c.y,d.x,d.y)>0) {
+                return fail(QString("%1 is in the circumcircle of triangle %2 across an unconstrained edge").arg(toString(d)).arg(t));
+            }
+        }
+    }
+    return true;
+}
+
+bool checkConvexHull(quint32 seed,QString &error) {
+    QString layout;
+    auto points=randomPoints(seed,layout);
+    auto ref=referenceHull(points);
+    Polygon hull(points);
+    auto fail=[&](const QString &what) {
+        error=QString("%1, %2 points: %3").arg(layout).arg(points.size()).arg(what);
+        return false;
+    };
+    if (hull.nbVertices()!=ref.size()) return fail(QString("%1 vertices instead of %2").arg(hull.nbVertices()).arg(ref.size()));
+    for (int i=0; i<ref.size(); i++) {
+        if (hull[i]!=ref[i]) return fail(QString("vertex %1 %2 instead of %3").arg(i).arg(toString(hull[i]),toString(ref[i])));
+    }
+    return true;
+}
+
+/**
+ * @brief randomSimplePolygon : star-shaped polygon (CCW vertices at increasing angles around a center),
+ * convex or not, with some vertices in the middle of an edge (flat angles)
+ */
+QVector<Vector2D> randomSimplePolygon(QRandomGenerator &rnd,QString &shape) {
+    int n=3+rnd.bounded(40);
+    bool convex=rnd.bounded(4)==0;
+    bool flat=rnd.bounded(3)==0;
+    shape=QString("%1%2 polygon, %3 vertices").arg(convex?"convex":"star").arg(flat?" flat":"").arg(n);
+    // the center is in the kernel when the angles between consecutive vertices are below 180 degrees
+    QVector<int> angles;
+    auto maxGap=[&angles]() {
+        int gap=angles.first()+3600-angles.last();
+        for (int i=1; i<angles.size(); i++) gap=qMax(gap,angles[i]-angles[i-1]);
+        return gap;
+    };
+    do {
+        QSet<int> used;
+        angles.clear();
+        while (angles.size()<n) {
+            int a=rnd.bounded(3600);
+            if (!used.contains(a)) {
+                used.insert(a);
+                angles.push_back(a);
+            }
+        }
+        std::sort(angles.begin(),angles.end());
+    } while (maxGap()>=1800);
+    QVector<Vector2D> res;
+    for (int a:angles) {
+        double r=convex?300:50+rnd.bounded(350);
+        Vector2D p(500+r*cos(a*M_PI/1800),500+r*sin(a*M_PI/1800));
+        if (flat && !res.isEmpty() && rnd.bounded(2)==0) res.push_back(0.5*(res.last()+p));
+        res.push_back(p);
+    }
+    return res;
+}
+
+bool checkTriangulation(quint32 seed,QString &error) {
+    QRandomGenerator rnd(seed);
+    QString shape;
+    auto pts=randomSimplePolygon(rnd,shape);
+    auto fail=[&](const QString &what) {
+        error=QString("%1: %2").arg(shape,what);
+        return false;
+    };
+    Polygon poly;
+    for (auto &p:pts) poly.addVertex(p);
+    Polygon prepared=poly;
+    poly.triangulate();
+    double ref=shoelace(pts),area=0;
+    auto triangles=poly.getTriangles();
+    for (int t=0; t<triangles.size(); t++) {
+        const Triangle &tri=triangles[t];
+        double o=orient(tri[0],tri[1],tri[2]);
+        if (o<0) return fail(QString("triangle %1 is not CCW").arg(t));
+        area+=0.5*o;
+        // the centroid of a sliver (float flat vertex) can not be classified, its area is negligible
+        double l2=qMax(tri[0].distance2(tri[1]),qMax(tri[1].distance2(tri[2]),tri[2].distance2(tri[0])));
+        Vector2D center=(1.0/3)*(tri[0]+tri[1]+tri[2]);
+        if (o>1e-4*l2 && !referenceContains(pts,center)) return fail(QString("triangle %1 is outside").arg(t));
+    }
+    if (std::fabs(area-ref)>1e-6*ref) return fail(QString("area of the triangles %1 instead of %2").arg(area).arg(ref));
+    // contains() of the prepared polygon, points close to the boundary are ambiguous
+    prepared.prepare();
+    for (int i=0; i<200; i++) {
+        Vector2D p(rnd.bounded(window.width()*10)/10.0,rnd.bounded(window.height()*10)/10.0);
+        double d=std::numeric_limits<double>::infinity();
+        for (int k=0; k<pts.size(); k++) d=qMin(d,segmentDistance(p,pts[k],pts[(k+1)%pts.size()]));
+        if (d<1e-2) continue;
+        if (prepared.contains(p)!=referenceContains(pts,p)) return fail(QString("contains%1 is %2").arg(toString(p)).arg(prepared.contains(p)));
+    }
+    return true;
+}
+
+bool checkClip(quint32 seed,QString &error) {
+    QRandomGenerator rnd(seed);
+    auto randomConvex=[&rnd]() {
+        QVector<Vector2D> pts;
+        int n=3+rnd.bounded(20);
+        for (int i=0; i<n; i++) pts.push_back(Vector2D(rnd.bounded(window.width()),rnd.bounded(window.height())));
+        return Polygon(pts);
+    };
+    Polygon subject=randomConvex();
+    while (subject.nbVertices()<3) subject=randomConvex();
+    QVector<HalfPlane> planes;
+    auto subjectPts=vertices(subject);
+    for (int i=0; i<subjectPts.size(); i++) planes.push_back(HalfPlane::left(subjectPts[i],subjectPts[(i+1)%subjectPts.size()]));
+    Polygon res=subject;
+    QString mode;
+    switch (seed%3) {
+    case 0 : {
+        int x0=rnd.bounded(800),y0=rnd.bounded(800);
+        int x1=x0+1+rnd.bounded(600),y1=y0+1+rnd.bounded(600);
+        mode=QString("box [%1,%2]x[%3,%4]").arg(x0).arg(x1).arg(y0).arg(y1);
+        planes << HalfPlane(1,0,-x0) << HalfPlane(-1,0,x1) << HalfPlane(0,1,-y0) << HalfPlane(0,-1,y1);
+        res.clip(x0,y0,x1,y1);
+        break;
+    }
+    case 1 : {
+        Polygon w=randomConvex();
+        while (w.nbVertices()<3) w=randomConvex();
+        mode=QString("window of %1 vertices").arg(w.nbVertices());
+        auto wPts=vertices(w);
+        for (int i=0; i<wPts.size(); i++) planes.push_back(HalfPlane::left(wPts[i],wPts[(i+1)%wPts.size()]));
+        res.clip(w);
+        break;
+    }
+    default : {
+        double angle=rnd.generateDouble()*2*M_PI;
+        double a=cos(angle),b=sin(angle);
+        double c=-(a*rnd.bounded(window.width())+b*rnd.bounded(window.height()));
+        // axis-aligned lines are a special case of clipHalfPlane
+        if (rnd.bounded(4)==0) {
+            a=(a>0)?1:-1;
+            b=0;
+            c=-a*rnd.bounded(window.width());
+        }
+        mode=QString("half-plane %1x+%2y+%3>=0").arg(a).arg(b).arg(c);
+        planes << HalfPlane(a,b,c);
+        res.clipHalfPlane(a,b,c);
+        break;
+    }
+    }
+    auto fail=[&](const QString &what) {
+        error=QString("convex polygon of %1 vertices, %2: %3").arg(subject.nbVertices()).arg(mode,what);
+        return false;
+    };
+    // float coordinates: errors in O(perimeter*ulp)
+    const double tolerance=1e-2;
+    auto ref=referenceIntersection(planes);
+    double refArea=ref.size()<3?0:shoelace(ref);
+    auto resPts=vertices(res);
+    double resArea=resPts.size()<3?0:shoelace(resPts);
+    if (std::fabs(resArea-refArea)>1.0+1e-6*shoelace(subjectPts)) return fail(QString("area %1 instead of %2").arg(resArea).arg(refArea));
+    for (auto &p:resPts) {
+        for (auto &h:planes) {
+            if (h.value(p)<-tolerance) return fail(QString("vertex %1 is outside").arg(toString(p)));
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief referenceCell : the window clipped by the bisectors of the server and all the others
+ */
+QVector<QPointF> referenceCell(const QVector<Vector2D> &points,int i) {
+    QVector<HalfPlane> planes;
+    planes << HalfPlane(1,0,-window.left()) << HalfPlane(-1,0,window.left()+window.width())
+           << HalfPlane(0,1,-window.top()) << HalfPlane(0,-1,window.top()+window.height());
+    const Vector2D &p=points[i];
+    for (auto &q:points) {
+        if (q==p) continue;
+        planes << HalfPlane(double(p.x)-q.x,double(p.y)-q.y,0.5*((double(q.x)*q.x+double(q.y)*q.y)-(double(p.x)*p.x+double(p.y)*p.y)));
+    }
+    return referenceIntersection(planes);
+}
+
+bool checkVoronoiCells(quint32 seed,QString &error) {
+    QString layout;
+    auto points=randomPoints(seed,layout);
+    QList<Server> servers=toServers(points);
+    VoronoiCells cells;
+    cells.build(servers,window.topLeft(),window.size());
+    QVector<Link> links;
+    MapBuilder::createServersLinks(servers,cells,links);
+    int n=points.size();
+    auto fail=[&](const QString &what) {
+        error=QString("%1, %2 points: %3").arg(layout).arg(n).arg(what);
+        return false;
+    };
+    QVector<QVector<QPointF>> ref(n);
+    for (int i=0; i<n; i++) {
+        ref[i]=referenceCell(points,i);
+        auto cell=vertices(*cells.cell(i));
+        double refArea=shoelace(ref[i]),area=cell.size()<3?0:shoelace(cell);
+        if (std::fabs(area-refArea)>1.0+1e-4*refArea) return fail(QString("cell %1 area %2 instead of %3").arg(i).arg(area).arg(refArea));
+        auto &box=cells.bounds(i);
+        for (auto &p:ref[i]) {
+            if (p.x()<box.first.x-0.01 || p.y()<box.first.y-0.01 || p.x()>box.second.x+0.01 || p.y()>box.second.y+0.01) {
+                return fail(QString("vertex (%1,%2) of cell %3 is out of its bounds").arg(p.x()).arg(p.y()).arg(i));
+            }
+        }
+    }
+    QRandomGenerator rnd(seed);
+    for (int k=0; k<100; k++) {
+        Vector2D p(rnd.bounded(window.width()*10)/10.0,rnd.bounded(window.height()*10)/10.0);
+        ServerId s=cells.locate(p,rnd.bounded(n));
+        double best=std::numeric_limits<double>::infinity();
+        for (auto &q:points) best=qMin(best,distance2(p,q));
+        if (s==invalidId || distance2(p,points[s])>best) return fail(QString("locate%1 gives %2").arg(toString(p)).arg(s));
+    }
+    // a link for each common edge of the reference cells (the ambiguous lengths are not tested)
+    QSet<qint64> linked; ///< i*n+j for i<j
+    for (auto &l:links) linked.insert(qint64(qMin(l.getNode1(),l.getNode2()))*n+qMax(l.getNode1(),l.getNode2()));
+    for (int i=0; i<n; i++) {
+        for (int j=i+1; j<n; j++) {
+            if (points[i]==points[j]) continue;
+            const Vector2D &p=points[i],&q=points[j];
+            double length=0;
+            for (int k=0; k<ref[i].size(); k++) {
+                const QPointF &a=ref[i][k],&b=ref[i][(k+1)%ref[i].size()];
+                auto onBisector=[&p,&q](const QPointF &x) {
+                    double dx=double(p.x)-q.x,dy=double(p.y)-q.y;
+                    return std::fabs((x.x()-0.5*(p.x+q.x))*dx+(x.y()-0.5*(p.y+q.y))*dy)<1e-6*std::sqrt(dx*dx+dy*dy);
+                };
+                if (onBisector(a) && onBisector(b)) length+=std::hypot(a.x()-b.x(),a.y()-b.y());
+            }
+            bool link=linked.contains(qint64(i)*n+j);
+            if (length>1 && !link) return fail(QString("no link %1-%2, common edge of length %3").arg(i).arg(j).arg(length));
+            if (length<1e-3 && link) return fail(QString("link %1-%2 without common edge").arg(i).arg(j));
+        }
+    }
+    return true;
+}
+}
+
+/**
+ * @brief checkBarriers : no link crosses a barrier, no cell contains a point of a barrier
+ * in its interior (except the cells of the servers on the barrier), the cells are in their bounds,
+ * locate() gives a cell that contains the point when there is one (the cells leave small areas
+ * near the ends of the barriers) and never a server hidden from the point by a barrier
+ */
+bool checkBarriers(quint32 seed,QString &error) {
+    QString layout;
+    auto points=randomPoints(seed,layout);
+    int n=points.size();
+    auto barriers=randomSegments(seed,points);
+    QList<Server> servers=toServers(points);
+    VoronoiCells cells;
+    cells.build(servers,window.topLeft(),window.size(),barriers);
+    QVector<Link> links;
+    MapBuilder::createServersLinks(servers,cells,links);
+    auto fail=[&](const QString &what) {
+        error=QString("%1, %2 points, %3 barriers: %4").arg(layout).arg(n).arg(barriers.size()).arg(what);
+        return false;
+    };
+    // distance of p to the boundary of a CCW convex cell, negative outside
+    auto depth=[](const QVector<Vector2D> &cell,const Vector2D &p) {
+        double res=std::numeric_limits<double>::infinity();
+        for (int k=0; k<cell.size(); k++) {
+            const Vector2D &a=cell[k],&b=cell[(k+1)%cell.size()];
+            double l=std::sqrt(distance2(a,b));
+            if (l>0) res=qMin(res,orient(a,b,p)/l);
+        }
+        return cell.size()<3?-1.0:res;
+    };
+    for (auto &l:links) {
+        for (auto &b:barriers) {
+            if (crosses(points[l.getNode1()],points[l.getNode2()],points[b.first],points[b.second])) {
+                return fail(QString("link %1-%2 crosses the barrier %3-%4").arg(l.getNode1()).arg(l.getNode2()).arg(b.first).arg(b.second));
+            }
+        }
+    }
+    QVector<QVector<Vector2D>> cellVertices(n);
+    for (int i=0; i<n; i++) {
+        auto &cell=cellVertices[i];
+        cell=vertices(*cells.cell(i));
+        auto &box=cells.bounds(i);
+        for (auto &p:cell) {
+            if (p.x<box.first.x-0.01 || p.y<box.first.y-0.01 || p.x>box.second.x+0.01 || p.y>box.second.y+0.01) {
+                return fail(QString("vertex %1 of cell %2 is out of its bounds").arg(toString(p)).arg(i));
+            }
+        }
+        for (auto &b:barriers) {
+            const Vector2D &A=points[b.first],&B=points[b.second];
+            if (orient(A,B,points[i])==0 && onSegment(A,B,points[i])) continue;
+            for (int k=1; k<10; k++) {
+                Vector2D p=A+(k/10.0)*(B-A);
+                if (depth(cell,p)>0.01) {
+                    return fail(QString("cell %1 contains the point %2 of the barrier %3-%4").arg(i).arg(toString(p)).arg(b.first).arg(b.second));
+                }
+            }
+        }
+    }
+    QRandomGenerator rnd(seed);
+    for (int k=0; k<100; k++) {
+        Vector2D p(rnd.bounded(window.width()*10)/10.0,rnd.bounded(window.height()*10)/10.0);
+        ServerId s=cells.locate(p,rnd.bounded(n));
+        if (s==invalidId) return fail(QString("locate%1 gives no server").arg(toString(p)));
+        for (auto &b:barriers) {
+            if (crosses(points[s],p,points[b.first],points[b.second])) {
+                return fail(QString("locate%1 gives %2 hidden by the barrier %3-%4").arg(toString(p)).arg(s).arg(b.first).arg(b.second));
+            }
+        }
+        if (depth(cellVertices[s],p)>=-0.01) continue;
+        for (int i=0; i<n; i++) {
+            if (depth(cellVertices[i],p)>0.01) return fail(QString("locate%1 gives %2 instead of %3").arg(toString(p)).arg(s).arg(i));
+        }
+    }
+    return true;
+}
+
+bool sameSamples(const QVector<DroneSample> &a,const QVector<DroneSample> &b) {
+    if (a.size()!=b.size()) return false;
+    for (int i=0; i<a.size(); i++) {
+        if (a[i].x!=b[i].x || a[i].y!=b[i].y || a[i].azimut!=b[i].azimut ||
+            a[i].connected!=b[i].connected || a[i].target!=b[i].target) return false;
+    }
+    return true;
+}
+
+bool checkTelemetry(quint32 seed,QString &error) {
+    QRandomGenerator rnd(seed);
+    const int nbDrones=1+rnd.bounded(20),nbServers=1+rnd.bounded(50);
+    const int nbFrames=1+rnd.bounded(4*telemetryKeyframeInterval);
+    const QString fileName=QDir::tempPath()+QString("/crosscheck-%1.drtl").arg(seed);
+    auto fail=[&](const QString &what) {
+        error=QString("%1 drones, %2 frames: %3").arg(nbDrones).arg(nbFrames).arg(what);
+        QFile::remove(fileName);
+        return false;
+    };
+    // recorded frames and their reference samples (a removed drone keeps its last state)
+    QList<Drone> drones;
+    for (int i=0; i<nbDrones; i++) drones.append(Drone());
+    QVector<qint64> times;
+    QVector<QVector<DroneSample>> frames;
+    QVector<DroneSample> state(nbDrones);
+    TelemetryRecorder recorder;
+    if (!recorder.open(fileName,nbDrones,nbServers)) return fail("cannot create "+fileName);
+    qint64 time=rnd.bounded(1000);
+    for (int f=0; f<nbFrames; f++) {
+        time+=1+rnd.bounded(100);
+        for (auto &d:drones) {
+            if (rnd.bounded(20)==0) {
+                d.position=Vector2D(rnd.generateDouble()*2000-1000,rnd.generateDouble()*2000-1000);
+            } else {
+                d.position=d.position+Vector2D(rnd.generateDouble()*4-2,rnd.generateDouble()*4-2);
+            }
+            d.setAzimut(rnd.generateDouble()*360);
+            d.connectTo(rnd.bounded(nbServers+1)-1);
+            d.target=rnd.bounded(nbServers+1)-1;
+        }
+        // fewer drones than recorded in some frames
+        int nbPresent=(rnd.bounded(4)==0)?rnd.bounded(nbDrones+1):nbDrones;
+        QList<Drone> present;
+        for (int i=0; i<nbPresent; i++) present.append(drones[i]);
+        for (int i=0; i<nbPresent; i++) {
+            DroneSample &s=state[i];
+            s.x=std::llround(qreal(present[i].position.x)*telemetryPositionScale);
+            s.y=std::llround(qreal(present[i].position.y)*telemetryPositionScale);
+            s.azimut=std::llround(present[i].azimut*telemetryAzimutScale);
+            s.connected=present[i].getConnectedTo();
+            s.target=present[i].target;
+        }
+        recorder.record(time,present);
+        times.append(time);
+        frames.append(state);
+    }
+    recorder.close();
+
+    TelemetryReader reader;
+    if (!reader.open(fileName)) return fail("cannot open the log");
+    if (reader.nbDrones()!=nbDrones || reader.nbServers()!=nbServers) {
+        return fail(QString("header gives %1 drones and %2 servers").arg(reader.nbDrones()).arg(reader.nbServers()));
+    }
+    int nbChunks=(nbFrames+telemetryKeyframeInterval-1)/telemetryKeyframeInterval;
+    if (reader.nbKeyframes()!=nbChunks) return fail(QString("%1 keyframes instead of %2").arg(reader.nbKeyframes()).arg(nbChunks));
+    for (int f=0; f<nbFrames; f++) {
+        if (!reader.next()) return fail(QString("next() stops at frame %1").arg(f));
+        if (reader.time()!=times[f] || !sameSamples(reader.samples(),frames[f])) return fail(QString("next() decodes frame %1 wrong").arg(f));
+    }
+    if (reader.next()) return fail("next() decodes a frame after the end");
+    // last frame at or before a time (the first frame before the start)
+    auto frameAt=[&times](qint64 t) {
+        return qMax(0,int(std::upper_bound(times.begin(),times.end(),t)-times.begin())-1);
+    };
+    for (int k=0; k<20; k++) {
+        qint64 t=times.first()-50+rnd.bounded(int(times.last()-times.first())+100);
+        if (!reader.seek(t)) return fail(QString("seek(%1) fails").arg(t));
+        int f=frameAt(t);
+        if (reader.time()!=times[f] || !sameSamples(reader.samples(),frames[f])) return fail(QString("seek(%1) decodes frame %2 wrong").arg(t).arg(f));
+        t+=rnd.bounded(300);
+        bool hasNext=reader.advanceTo(t);
+        f=qMax(f,frameAt(t));
+        if (reader.time()!=times[f] || !sameSamples(reader.samples(),frames[f])) return fail(QString("advanceTo(%1) decodes frame %2 wrong").arg(t).arg(f));
+        if (hasNext!=(f+1<nbFrames)) return fail(QString("advanceTo(%1) returns %2 at frame %3").arg(t).arg(hasNext).arg(f));
+    }
+    reader.close();
+
+    // a drone count that cannot fit in the chunks is rejected (header: "DRTL" version nbDrones...)
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) return fail("cannot read the log");
+    QByteArray data=file.readAll();
+    file.close();
+    QByteArray corrupted=data.mid(0,5);
+    for (quint64 v=100000000; ; v>>=7) {
+        corrupted.append(char(v>=0x80?(v&0x7f)|0x80:v));
+        if (v<0x80) break;
+    }
+    corrupted.append(data.mid(6));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return fail("cannot write the log");
+    file.write(corrupted);
+    file.close();
+    // the rejected file is reported with a warning, not printed by the check
+    QtMessageHandler handler=qInstallMessageHandler([](QtMsgType,const QMessageLogContext&,const QString&) {});
+    bool opened=reader.open(fileName);
+    qInstallMessageHandler(handler);
+    reader.close();
+    QFile::remove(fileName);
+    if (opened) return fail("a header with 100000000 drones is accepted");
+    return true;
+}
+
+void addCrossChecks(CrossCheckSuite &suite) {
+    suite.add("TriangleMesh",checkTriangleMesh);
+    suite.add("TriangleMesh/constrained",checkConstrainedMesh);
+    suite.add("Polygon::hull",checkConvexHull);
+    suite.add("Polygon::triangulate",checkTriangulation);
+    suite.add("Polygon::clip",checkClip);
+    suite.add("VoronoiCells",checkVoronoiCells);
+    suite.add("VoronoiCells/barriers",checkBarriers);
+    suite.add("Telemetry",checkTelemetry);
+}
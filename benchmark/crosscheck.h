@@ -0,0 +1,45 @@
+#ifndef CROSSCHECK_H
+#define CROSSCHECK_H
+
+#include <QString>
+#include <QVector>
+#include <functional>
+
+/**
+ * @brief The CrossCheckSuite class compares the optimized geometry with brute-force reference
+ * implementations on random inputs: a check is run once per seed and describes the first
+ * difference it finds. The inputs of a seed are reproducible (benchmark --check --seed=n).
+ */
+class CrossCheckSuite {
+public:
+    /**
+     * @brief Check : run the check on the input of a seed
+     * @param error description of the difference (input and failed property)
+     * @return false if the optimized path differs from the reference
+     */
+    typedef std::function<bool(quint32 seed,QString &error)> Check;
+    void add(const QString &name,Check check) {
+        checks.push_back({name,check});
+    }
+    /**
+     * @brief run : run the checks whose name contains filter on nbSeeds seeds
+     * @return the number of failed runs
+     */
+    int run(const QString &filter,quint32 firstSeed,int nbSeeds);
+private:
+    struct Entry {
+        QString name;
+        Check check;
+    };
+    QVector<Entry> checks;
+};
+
+/**
+ * @brief addCrossChecks : TriangleMesh (Delaunay property, 2n-h-2 triangles, covering of the hull),
+ * constrained TriangleMesh (segments are chains of edges, Delaunay across the other edges),
+ * convex hull, triangulation and contains() of polygons, clipping, VoronoiCells (with barriers),
+ * telemetry round trip (sequential decoding, seek and advanceTo against the recorded frames)
+ */
+void addCrossChecks(CrossCheckSuite &suite);
+
+#endif // CROSSCHECK_H
@@ -0,0 +1,782 @@
+#include <QFile>
+#include <cstdio>
+#include "benchmark.h"
+#include "crosscheck.h"
+#include <scenariogenerator.h>
+#include <mapbuilder.h>
+#include <trianglemesh.h>
+#include <dronegrid.h>
+#include <predicates.h>
+#include <determinant.h>
+#include <navigationgraph.h>
+#include <hittest.h>
+#include <rtree.h>
+
+/**
+ * Benchmarks of the geometry, routing and simulation stages on synthetic scenarios.
+ * usage: benchmark [--filter=text] [--out=results.json] [--min-time=seconds] [--seed=n]
+ * benchmark --baseline=results.json [--max-slowdown=x] fails when a case is slower than x times the baseline.
+ * benchmark --check[=seeds] compares the optimized geometry with brute-force references (see CrossCheckSuite).
+ * benchmark --scenario=layout,servers,drones[,rooms],file.json writes a generated scenario for the application.
+ * The exit code is 1 when a check fails or a case regresses.
+ */
+
+namespace {
+const QRect window(0,0,10000,10000);
+const ScenarioGenerator::Layout layouts[]={ScenarioGenerator::Uniform,ScenarioGenerator::Clustered,
+                                           ScenarioGenerator::Grid,ScenarioGenerator::Collinear};
+quint32 seed=1;
+const MotionParameters motion;
+
+/**
+ * @brief circle : n vertices on a circle (CCW)
+ */
+QVector<Vector2D> circle(int n,const Vector2D &center,qreal radius) {
+    QVector<Vector2D> pts;
+    for (int i=0; i<n; i++) {
+        pts.push_back(center+radius*Vector2D(cos(2*M_PI*i/n),sin(2*M_PI*i/n)));
+    }
+    return pts;
+}
+
+/**
+ * @brief star : non-convex polygon with n vertices, alternating two radiuses (CCW)
+ */
+Polygon star(int n,const Vector2D &center,qreal r0,qreal r1) {
+    Polygon poly;
+    for (int i=0; i<n; i++) {
+        qreal r=(i%2==0)?r0:r1;
+        poly.addVertex(center+r*Vector2D(cos(2*M_PI*i/n),sin(2*M_PI*i/n)));
+    }
+    return poly;
+}
+
+/**
+ * @brief The Map struct is a complete map (cells, links, router) built by MapBuilder.
+ */
+struct Map {
+    QList<Server> servers;
+    VoronoiCells cells;
+    QVector<Link> links;
+    Router *router=nullptr;
+    Map(ScenarioGenerator::Layout layout,int n) {
+        ScenarioGenerator gen(seed);
+        servers=gen.servers(layout,n,window);
+        MapBuilder::createVoronoiMap(servers,QVector<MeshEdge>(),cells,window.topLeft(),window.size());
+        MapBuilder::createServersLinks(servers,cells,links);
+        router=MapBuilder::createRouter(servers,links);
+    }
+    ~Map() {
+        delete router;
+    }
+};
+
+void addGeometryCases(BenchmarkSuite &suite) {
+    for (auto layout:layouts) {
+        for (int n:{100,200,10000,40000}) {
+            QString name=QString("TriangleMesh/%1/%2").arg(ScenarioGenerator::layoutName(layout)).arg(n);
+            suite.add(name,[layout,n](BenchmarkState &state) {
+                ScenarioGenerator gen(seed);
+                auto servers=gen.servers(layout,n,window);
+                state.setItemsPerIteration(n);
+                while (state.keepRunning()) {
+                    TriangleMesh mesh(servers);
+                }
+            });
+        }
+        for (int n:{100,200}) {
+            QString name=QString("VoronoiMap/%1/%2").arg(ScenarioGenerator::layoutName(layout)).arg(n);
+            suite.add(name,[layout,n](BenchmarkState &state) {
+                ScenarioGenerator gen(seed);
+                auto servers=gen.servers(layout,n,window);
+                VoronoiCells cells;
+                state.setItemsPerIteration(n);
+                while (state.keepRunning()) {
+                    MapBuilder::createVoronoiMap(servers,QVector<MeshEdge>(),cells,window.topLeft(),window.size());
+                }
+            });
+        }
+        for (int n:{100,200,10000,40000}) {
+            // x-monotone barriers through a quarter of the servers, across the whole map:
+            // one per horizontal band of 200 servers (2450 segments for 10000 servers)
+            QString name=QString("TriangleMesh/constrained/%1/%2").arg(ScenarioGenerator::layoutName(layout)).arg(n);
+            suite.add(name,[layout,n](BenchmarkState &state) {
+                ScenarioGenerator gen(seed);
+                auto servers=gen.servers(layout,n,window);
+                const int nbBands=qMax(1,n/200);
+                QVector<QVector<int>> bands(nbBands);
+                for (int i=0; i<n; i+=4) {
+                    int band=int((servers[i].position.y()-window.top())*nbBands/window.height());
+                    bands[qBound(0,band,nbBands-1)].push_back(i);
+                }
+                QVector<MeshEdge> barrier;
+                for (auto &order:bands) {
+                    std::sort(order.begin(),order.end(),[&servers](int a,int b) {
+                        const QPointF &A=servers[a].position,&B=servers[b].position;
+                        return A.x()<B.x() || (A.x()==B.x() && A.y()<B.y());
+                    });
+                    for (int i=1; i<order.size(); i++) barrier.push_back({order[i-1],order[i]});
+                }
+                state.setItemsPerIteration(n);
+                while (state.keepRunning()) {
+                    TriangleMesh mesh(servers,barrier);
+                }
+            });
+        }
+        for (int n:{1000,10000}) {
+            QString name=QString("ConvexHull/%1/%2").arg(ScenarioGenerator::layoutName(layout)).arg(n);
+            suite.add(name,[layout,n](BenchmarkState &state) {
+                ScenarioGenerator gen(seed);
+                QVector<Vector2D> pts;
+                for (auto &p:gen.positions(layout,n,window)) pts.push_back(Vector2D(p.x(),p.y()));
+                state.setItemsPerIteration(n);
+                while (state.keepRunning()) {
+                    Polygon hull(pts);
+                }
+            });
+        }
+    }
+    for (int n:{16,64,256}) {
+        suite.add(QString("Polygon::triangulate/convex/%1").arg(n),[n](BenchmarkState &state) {
+            Polygon poly;
+            for (auto &p:circle(n,Vector2D(0,0),100)) poly.addVertex(p);
+            state.setItemsPerIteration(n);
+            while (state.keepRunning()) {
+                Polygon tmp(poly);
+                tmp.triangulate();
+            }
+        });
+        suite.add(QString("Polygon::triangulate/star/%1").arg(n),[n](BenchmarkState &state) {
+            Polygon poly=star(n,Vector2D(0,0),100,40);
+            state.setItemsPerIteration(n);
+            while (state.keepRunning()) {
+                Polygon tmp(poly);
+                tmp.triangulate();
+            }
+        });
+        suite.add(QString("Polygon::clip/%1").arg(n),[n](BenchmarkState &state) {
+            Polygon poly;
+            for (auto &p:circle(n,Vector2D(0,0),100)) poly.addVertex(p);
+            state.setItemsPerIteration(n);
+            while (state.keepRunning()) {
+                Polygon tmp(poly);
+                tmp.clip(-80,-70,75,90);
+            }
+        });
+        suite.add(QString("Polygon::clip/window/%1").arg(n),[n](BenchmarkState &state) {
+            Polygon poly,window;
+            for (auto &p:circle(n,Vector2D(0,0),100)) poly.addVertex(p);
+            for (auto &p:circle(6,Vector2D(20,-10),90)) window.addVertex(p);
+            state.setItemsPerIteration(n);
+            while (state.keepRunning()) {
+                Polygon tmp(poly);
+                tmp.clip(window);
+            }
+        });
+        suite.add(QString("Polygon::contains/%1").arg(n),[n](BenchmarkState &state) {
+            Polygon poly;
+            for (auto &p:circle(n,Vector2D(0,0),100)) poly.addVertex(p);
+            poly.triangulate();
+            QRandomGenerator rnd(seed);
+            QVector<Vector2D> pts;
+            for (int i=0; i<1000; i++) pts.push_back(Vector2D(rnd.generateDouble()*240-120,rnd.generateDouble()*240-120));
+            state.setItemsPerIteration(pts.size());
+            int inside=0;
+            while (state.keepRunning()) {
+                for (auto &p:pts) inside+=poly.contains(p);
+            }
+            Q_UNUSED(inside);
+        });
+        suite.add(QString("Polygon::contains/convex/%1").arg(n),[n](BenchmarkState &state) {
+            Polygon poly;
+            for (auto &p:circle(n,Vector2D(0,0),100)) poly.addVertex(p);
+            poly.prepare();
+            QRandomGenerator rnd(seed);
+            QVector<Vector2D> pts;
+            for (int i=0; i<1000; i++) pts.push_back(Vector2D(rnd.generateDouble()*240-120,rnd.generateDouble()*240-120));
+            state.setItemsPerIteration(pts.size());
+            while (state.keepRunning()) {
+                for (auto &p:pts) doNotOptimize(poly.contains(p));
+            }
+        });
+        // reference: one Triangle::contains per triangle
+        suite.add(QString("Triangle::contains/%1").arg(n),[n](BenchmarkState &state) {
+            Polygon poly;
+            for (auto &p:circle(n,Vector2D(0,0),100)) poly.addVertex(p);
+            poly.triangulate();
+            auto triangles=poly.getTriangles();
+            QRandomGenerator rnd(seed);
+            QVector<Vector2D> pts;
+            for (int i=0; i<1000; i++) pts.push_back(Vector2D(rnd.generateDouble()*240-120,rnd.generateDouble()*240-120));
+            state.setItemsPerIteration(pts.size());
+            doNotOptimize(triangles.data());
+            while (state.keepRunning()) {
+                for (auto &p:pts) {
+                    auto t=triangles.begin();
+                    while (t!=triangles.end() && !t->contains(p)) t++;
+                    doNotOptimize(t);
+                }
+                clobberMemory();
+            }
+        });
+    }
+}
+
+/**
+ * @brief oldIncircle : in-circle test through Matrix33 and the cofactor expansion (former Triangle::circleContains)
+ */
+float oldIncircle(const Vector2D &A,const Vector2D &B,const Vector2D &C,const Vector2D &M) {
+    Matrix33 mat;
+    mat.m[0][0] = (A.x - M.x);
+    mat.m[0][1] = (A.y - M.y);
+    mat.m[0][2] = (A.x*A.x-M.x*M.x)+(A.y*A.y-M.y*M.y);
+    mat.m[1][0] = (B.x - M.x);
+    mat.m[1][1] = (B.y - M.y);
+    mat.m[1][2] = (B.x*B.x-M.x*M.x)+(B.y*B.y-M.y*M.y);
+    mat.m[2][0] = (C.x - M.x);
+    mat.m[2][1] = (C.y - M.y);
+    mat.m[2][2] = (C.x*C.x-M.x*M.x)+(C.y*C.y-M.y*M.y);
+    return mat.cofactorDeterminant();
+}
+
+void addPredicateCases(BenchmarkSuite &suite) {
+    const int n=1024;
+    // random matrices and points, the same for all the cases
+    auto randomValues=[](int nb) {
+        QRandomGenerator rnd(seed);
+        QVector<float> v;
+        for (int i=0; i<nb; i++) v.push_back(float(rnd.generateDouble()*200-100));
+        return v;
+    };
+    suite.add("Matrix33/cofactor",[=](BenchmarkState &state) {
+        auto v=randomValues(9*n);
+        QVector<Matrix33> mats(n);
+        for (int i=0; i<n; i++) memcpy(mats[i].m,v.data()+9*i,sizeof(mats[i].m));
+        state.setItemsPerIteration(n);
+        doNotOptimize(mats.data());
+        while (state.keepRunning()) {
+            for (auto &m:mats) doNotOptimize(m.cofactorDeterminant());
+            clobberMemory();
+        }
+    });
+    suite.add("Matrix33/closed",[=](BenchmarkState &state) {
+        auto v=randomValues(9*n);
+        QVector<Matrix33> mats(n);
+        for (int i=0; i<n; i++) memcpy(mats[i].m,v.data()+9*i,sizeof(mats[i].m));
+        state.setItemsPerIteration(n);
+        doNotOptimize(mats.data());
+        while (state.keepRunning()) {
+            for (auto &m:mats) doNotOptimize(m.determinant());
+            clobberMemory();
+        }
+    });
+    suite.add("Matrix44/cofactor",[=](BenchmarkState &state) {
+        auto v=randomValues(16*n);
+        QVector<Matrix44> mats(n);
+        for (int i=0; i<n; i++) memcpy(mats[i].m,v.data()+16*i,sizeof(mats[i].m));
+        state.setItemsPerIteration(n);
+        doNotOptimize(mats.data());
+        while (state.keepRunning()) {
+            for (auto &m:mats) doNotOptimize(m.cofactorDeterminant());
+            clobberMemory();
+        }
+    });
+    suite.add("Matrix44/closed",[=](BenchmarkState &state) {
+        auto v=randomValues(16*n);
+        QVector<Matrix44> mats(n);
+        for (int i=0; i<n; i++) memcpy(mats[i].m,v.data()+16*i,sizeof(mats[i].m));
+        state.setItemsPerIteration(n);
+        doNotOptimize(mats.data());
+        while (state.keepRunning()) {
+            for (auto &m:mats) doNotOptimize(m.determinant());
+            clobberMemory();
+        }
+    });
+    // one triangle against n points far from its circumcircle (no early exit of the batch)
+    const Vector2D A(-1,-1),B(1,-1),C(0,1);
+    auto farPoints=[=]() {
+        QVector<Vector2D> pts;
+        auto v=randomValues(2*n);
+        for (int i=0; i<n; i++) pts.push_back(Vector2D(v[2*i]>=0?v[2*i]+10:v[2*i]-10,v[2*i+1]));
+        return pts;
+    };
+    suite.add("Incircle/cofactor",[=](BenchmarkState &state) {
+        auto pts=farPoints();
+        state.setItemsPerIteration(n);
+        doNotOptimize(pts.data());
+        while (state.keepRunning()) {
+            for (auto &p:pts) doNotOptimize(oldIncircle(A,B,C,p)>0);
+            clobberMemory();
+        }
+    });
+    suite.add("Incircle/closed",[=](BenchmarkState &state) {
+        auto pts=farPoints();
+        Triangle tri(A,B,C);
+        state.setItemsPerIteration(n);
+        doNotOptimize(pts.data());
+        while (state.keepRunning()) {
+            for (auto &p:pts) doNotOptimize(tri.circleContains(p));
+            clobberMemory();
+        }
+    });
+    suite.add("Incircle/batch",[=](BenchmarkState &state) {
+        auto pts=farPoints();
+        QVector<double> px,py;
+        for (auto &p:pts) {
+            px.push_back(p.x);
+            py.push_back(p.y);
+        }
+        state.setItemsPerIteration(n);
+        doNotOptimize(px.data());
+        doNotOptimize(py.data());
+        while (state.keepRunning()) {
+            doNotOptimize(firstInsideCircle(A.x,A.y,B.x,B.y,C.x,C.y,px.data(),py.data(),n));
+            clobberMemory();
+        }
+    });
+    // orientation of random triples (filter only) and of collinear triples (exact evaluation)
+    auto triples=[=](bool collinear) {
+        QVector<double> v;
+        QRandomGenerator rnd(seed);
+        for (int i=0; i<n; i++) {
+            double ax=rnd.bounded(10000),ay=rnd.bounded(10000),bx=rnd.bounded(10000),by=rnd.bounded(10000);
+            double t=rnd.generateDouble();
+            v << ax << ay << bx << by;
+            if (collinear) v << ax+t*(bx-ax) << ay+t*(by-ay);
+            else v << rnd.bounded(10000) << rnd.bounded(10000);
+        }
+        return v;
+    };
+    suite.add("orient2d/random",[=](BenchmarkState &state) {
+        auto v=triples(false);
+        state.setItemsPerIteration(n);
+        doNotOptimize(v.data());
+        while (state.keepRunning()) {
+            for (int i=0; i<6*n; i+=6) doNotOptimize(orient2d(v[i],v[i+1],v[i+2],v[i+3],v[i+4],v[i+5]));
+            clobberMemory();
+        }
+    });
+    suite.add("orient2d/collinear",[=](BenchmarkState &state) {
+        auto v=triples(true);
+        state.setItemsPerIteration(n);
+        doNotOptimize(v.data());
+        while (state.keepRunning()) {
+            for (int i=0; i<6*n; i+=6) doNotOptimize(orient2d(v[i],v[i+1],v[i+2],v[i+3],v[i+4],v[i+5]));
+            clobberMemory();
+        }
+    });
+    // in-circle test of the points of a grid for a triangle of the grid (many cocircular points)
+    suite.add("Incircle/cocircular",[=](BenchmarkState &state) {
+        QVector<double> px,py;
+        for (int i=0; i<32; i++) {
+            for (int j=0; j<32; j++) {
+                px.push_back(i*100);
+                py.push_back(j*100);
+            }
+        }
+        state.setItemsPerIteration(px.size());
+        doNotOptimize(px.data());
+        doNotOptimize(py.data());
+        while (state.keepRunning()) {
+            for (int i=0; i<px.size(); i++) doNotOptimize(incircle(0,0,100,0,0,100,px[i],py[i]));
+            clobberMemory();
+        }
+    });
+}
+
+void addRoutingCases(BenchmarkSuite &suite) {
+    for (int n:{100,200}) {
+        suite.add(QString("Router/flat/%1").arg(n),[n](BenchmarkState &state) {
+            Map map(ScenarioGenerator::Uniform,n);
+            state.setItemsPerIteration(n);
+            while (state.keepRunning()) {
+                delete MapBuilder::createRouter(map.servers,map.links); // n<flatRoutingMaxServers
+            }
+        });
+        suite.add(QString("Router/hierarchical/build/%1").arg(n),[n](BenchmarkState &state) {
+            Map map(ScenarioGenerator::Uniform,n);
+            state.setItemsPerIteration(n);
+            while (state.keepRunning()) {
+                HierarchicalRouter router(map.servers,map.links);
+            }
+        });
+        suite.add(QString("Router/hierarchical/query/%1").arg(n),[n](BenchmarkState &state) {
+            Map map(ScenarioGenerator::Uniform,n);
+            HierarchicalRouter router(map.servers,map.links);
+            QRandomGenerator rnd(seed);
+            state.setItemsPerIteration(1000);
+            qreal sum=0;
+            while (state.keepRunning()) {
+                for (int i=0; i<1000; i++) {
+                    sum+=router.bestDistance(rnd.bounded(n),rnd.bounded(n)).second;
+                }
+            }
+            Q_UNUSED(sum);
+        });
+    }
+}
+
+void addDroneCases(BenchmarkSuite &suite) {
+    suite.add("Drone::findArea/200",[](BenchmarkState &state) {
+        Map map(ScenarioGenerator::Uniform,200);
+        ScenarioGenerator gen(seed);
+        QList<Drone> drones=gen.drones(10000,map.servers,window);
+        state.setItemsPerIteration(drones.size());
+        while (state.keepRunning()) {
+            for (auto &d:drones) doNotOptimize(d.findArea(map.cells));
+        }
+    });
+    suite.add("Drone::move/10000",[](BenchmarkState &state) {
+        ScenarioGenerator gen(seed);
+        QList<Server> servers=gen.servers(ScenarioGenerator::Uniform,10,window);
+        QList<Drone> drones=gen.drones(10000,servers,window);
+        for (auto &d:drones) {
+            d.setRoute({Vector2D(servers[d.target].position.x(),servers[d.target].position.y())});
+        }
+        state.setItemsPerIteration(drones.size());
+        while (state.keepRunning()) {
+            for (auto &d:drones) d.move(0.1,motion);
+        }
+    });
+    // reference: the former per drone computation of Drone::move (normalization and atan branches)
+    suite.add("Azimut/atan/10000",[](BenchmarkState &state) {
+        QRandomGenerator rnd(seed);
+        QVector<Vector2D> speeds;
+        for (int i=0; i<10000; i++) speeds.push_back(Vector2D(rnd.bounded(2.0)-1.0,rnd.bounded(2.0)-1.0));
+        QVector<qreal> azimuts(speeds.size());
+        state.setItemsPerIteration(speeds.size());
+        while (state.keepRunning()) {
+            for (int i=0; i<speeds.size(); i++) {
+                Vector2D Vn=(1.0/speeds[i].length())*speeds[i];
+                if (Vn.y==0) {
+                    azimuts[i]=(Vn.x>0)?-90.0:90.0;
+                } else if (Vn.y>0) {
+                    azimuts[i]=180.0-180.0*atan(Vn.x/Vn.y)/M_PI;
+                } else {
+                    azimuts[i]=-180.0*atan(Vn.x/Vn.y)/M_PI;
+                }
+            }
+            doNotOptimize(azimuts[0]);
+        }
+    });
+    suite.add("Drone::updateAzimuts/10000",[](BenchmarkState &state) {
+        ScenarioGenerator gen(seed);
+        QList<Server> servers=gen.servers(ScenarioGenerator::Uniform,10,window);
+        QList<Drone> drones=gen.drones(10000,servers,window);
+        for (auto &d:drones) {
+            d.setRoute({Vector2D(servers[d.target].position.x(),servers[d.target].position.y())});
+        }
+        state.setItemsPerIteration(drones.size());
+        while (state.keepRunning()) {
+            state.pauseTiming();
+            for (auto &d:drones) d.move(0.1,motion);
+            state.resumeTiming();
+            Drone::updateAzimuts(drones);
+        }
+    });
+    for (int n:{10000,100000,1000000}) {
+        // mean distance between drones about motion.minDistance
+        int side=int(sqrt(qreal(n))*motion.minDistance);
+        suite.add(QString("DroneGrid::build/%1").arg(n),[n,side](BenchmarkState &state) {
+            ScenarioGenerator gen(seed);
+            QList<Server> servers;
+            QList<Drone> drones=gen.drones(n,servers,QRect(0,0,side,side));
+            DroneGrid grid;
+            state.setItemsPerIteration(n);
+            while (state.keepRunning()) {
+                grid.build(drones,motion.minDistance);
+            }
+        });
+        suite.add(QString("DroneGrid::separate/%1").arg(n),[n,side](BenchmarkState &state) {
+            ScenarioGenerator gen(seed);
+            QList<Server> servers;
+            QList<Drone> drones=gen.drones(n,servers,QRect(0,0,side,side));
+            DroneGrid grid;
+            state.setItemsPerIteration(n);
+            while (state.keepRunning()) {
+                grid.separate(drones,motion.minDistance);
+            }
+        });
+    }
+}
+
+/**
+ * @brief addViewCases : search of the cells and drones of a view of 1/8 of the window width
+ * (the canvas zoomed on a region of a large map)
+ */
+void addViewCases(BenchmarkSuite &suite) {
+    const Vector2D viewMin(window.width()*0.4,window.height()*0.4);
+    const Vector2D viewMax(window.width()*0.525,window.height()*0.525);
+    for (int n:{10000,100000}) {
+        // boxes of cells of a uniform map of n servers
+        QRandomGenerator rnd(seed);
+        QVector<QPair<Vector2D,Vector2D>> boxes;
+        float half=window.width()/sqrt(qreal(n));
+        for (int i=0; i<n; i++) {
+            Vector2D p(rnd.bounded(window.width()),rnd.bounded(window.height()));
+            boxes.push_back({p-Vector2D(half,half),p+Vector2D(half,half)});
+        }
+        // reference: test of every box
+        suite.add(QString("View/cells/scan/%1").arg(n),[boxes,viewMin,viewMax](BenchmarkState &state) {
+            while (state.keepRunning()) {
+                int count=0;
+                for (auto &b:boxes) {
+                    if (b.first.x<=viewMax.x && b.second.x>=viewMin.x && b.first.y<=viewMax.y && b.second.y>=viewMin.y) count++;
+                }
+                doNotOptimize(count);
+            }
+        });
+        suite.add(QString("View/cells/rtree/%1").arg(n),[boxes,viewMin,viewMax](BenchmarkState &state) {
+            RTree tree;
+            tree.build(boxes);
+            while (state.keepRunning()) {
+                int count=0;
+                tree.query(viewMin,viewMax,[&count](int) { count++; });
+                doNotOptimize(count);
+            }
+        });
+    }
+    suite.add("RTree::build/100000",[](BenchmarkState &state) {
+        QRandomGenerator rnd(seed);
+        QVector<QPair<Vector2D,Vector2D>> boxes;
+        for (int i=0; i<100000; i++) {
+            Vector2D p(rnd.bounded(window.width()),rnd.bounded(window.height()));
+            boxes.push_back({p,p+Vector2D(30,30)});
+        }
+        state.setItemsPerIteration(boxes.size());
+        while (state.keepRunning()) {
+            RTree tree;
+            tree.build(boxes);
+            doNotOptimize(tree.size());
+        }
+    });
+    suite.add("View/drones/grid/1000000",[viewMin,viewMax](BenchmarkState &state) {
+        ScenarioGenerator gen(seed);
+        QList<Server> servers;
+        QList<Drone> drones=gen.drones(1000000,servers,window);
+        DroneGrid grid;
+        grid.build(drones,motion.minDistance);
+        while (state.keepRunning()) {
+            int count=0;
+            grid.forEachInRect(viewMin,viewMax,[&count](int) { count++; });
+            doNotOptimize(count);
+        }
+    });
+}
+}
+
+/**
+ * @brief The GridMap struct is a map of side x side square cells with links between neighbors,
+ * indexed like the canvas (large maps without the cost of the Delaunay triangulation:
+ * two triangles per square of servers).
+ */
+struct GridMap {
+    QList<Server> servers;
+    VoronoiCells cells;
+    QVector<Link> links;
+    RTree index;
+    GridMap(int side) {
+        float w=float(window.width())/side;
+        for (int j=0; j<side; j++) {
+            for (int i=0; i<side; i++) {
+                Server s;
+                s.id=servers.size();
+                s.name=QString("S%1").arg(s.id);
+                s.position=QPointF((i+0.5)*w,(j+0.5)*w);
+                servers.append(s);
+            }
+        }
+        QVector<MeshTriangle> triangles;
+        for (int j=0; j+1<side; j++) {
+            for (int i=0; i+1<side; i++) {
+                int s=j*side+i;
+                triangles.push_back({{s,s+1,s+side+1}});
+                triangles.push_back({{s,s+side+1,s+side}});
+            }
+        }
+        cells.build(servers,triangles,window.topLeft(),window.size());
+        for (int j=0; j<side; j++) {
+            for (int i=0; i<side; i++) {
+                int s=j*side+i;
+                if (i+1<side) addLink(s,s+1,{Vector2D((i+1)*w,j*w),Vector2D((i+1)*w,(j+1)*w)});
+                if (j+1<side) addLink(s,s+side,{Vector2D(i*w,(j+1)*w),Vector2D((i+1)*w,(j+1)*w)});
+            }
+        }
+        QVector<QPair<Vector2D,Vector2D>> boxes;
+        for (int i=0; i<servers.size(); i++) boxes.push_back(cells.bounds(i));
+        index.build(boxes);
+    }
+    void addLink(ServerId a,ServerId b,const QPair<Vector2D,Vector2D> &edge) {
+        LinkId l=links.size();
+        links.push_back(Link(servers[a],servers[b],edge));
+        servers[a].links.push_back(l);
+        servers[b].links.push_back(l);
+    }
+};
+
+void addHitTestCases(BenchmarkSuite &suite) {
+    // 1000 picks per iteration at random points of a map of 100k cells
+    const int side=316;
+    suite.add("HitTest::serverAt/100000",[](BenchmarkState &state) {
+        GridMap map(side);
+        QRandomGenerator rnd(seed);
+        state.setItemsPerIteration(1000);
+        while (state.keepRunning()) {
+            for (int i=0; i<1000; i++) {
+                Vector2D p(rnd.bounded(window.width()),rnd.bounded(window.height()));
+                doNotOptimize(HitTest::serverAt(map.servers,map.cells,map.index,p,25));
+            }
+        }
+    });
+    suite.add("HitTest::linkAt/100000",[](BenchmarkState &state) {
+        GridMap map(side);
+        QRandomGenerator rnd(seed);
+        state.setItemsPerIteration(1000);
+        while (state.keepRunning()) {
+            for (int i=0; i<1000; i++) {
+                Vector2D p(rnd.bounded(window.width()),rnd.bounded(window.height()));
+                doNotOptimize(HitTest::linkAt(map.servers,map.links,map.index,p,5));
+            }
+        }
+    });
+    suite.add("VoronoiCells::cell/100000",[](BenchmarkState &state) {
+        // random cells of a huge map: most of them are evicted before they are used again
+        GridMap map(side);
+        map.cells.setCacheSize(lazyCellsCacheSize);
+        QRandomGenerator rnd(seed);
+        state.setItemsPerIteration(1000);
+        while (state.keepRunning()) {
+            for (int i=0; i<1000; i++) {
+                doNotOptimize(map.cells.cell(rnd.bounded(map.servers.size()))->nbVertices());
+            }
+        }
+    });
+    suite.add("HitTest::droneAt/100000",[](BenchmarkState &state) {
+        ScenarioGenerator gen(seed);
+        QList<Server> servers;
+        QList<Drone> drones=gen.drones(100000,servers,window);
+        DroneGrid grid;
+        grid.build(drones,motion.minDistance);
+        QRandomGenerator rnd(seed);
+        state.setItemsPerIteration(1000);
+        while (state.keepRunning()) {
+            for (int i=0; i<1000; i++) {
+                Vector2D p(rnd.bounded(window.width()),rnd.bounded(window.height()));
+                doNotOptimize(HitTest::droneAt(drones,grid,p,32));
+            }
+        }
+    });
+}
+
+void addNavigationCases(BenchmarkSuite &suite) {
+    for (int n:{16,64}) {
+        suite.add(QString("NavigationGraph::build/%1").arg(n),[n](BenchmarkState &state) {
+            ScenarioGenerator gen(seed);
+            auto rooms=gen.rooms(n,window);
+            while (state.keepRunning()) {
+                NavigationGraph graph;
+                graph.build(rooms,motion.slowDownDistance);
+                doNotOptimize(graph.nbNodes());
+            }
+        });
+        suite.add(QString("NavigationGraph::findPath/%1").arg(n),[n](BenchmarkState &state) {
+            ScenarioGenerator gen(seed);
+            NavigationGraph graph;
+            graph.build(gen.rooms(n,window),motion.slowDownDistance);
+            // replanning of 1000 drones toward a few shared waypoints (cached trees)
+            QRandomGenerator rnd(seed);
+            QVector<Vector2D> starts,goals;
+            for (int i=0; i<1000; i++) starts.push_back(Vector2D(rnd.bounded(window.width()),rnd.bounded(window.height())));
+            for (int i=0; i<8; i++) goals.push_back(Vector2D(rnd.bounded(window.width()),rnd.bounded(window.height())));
+            state.setItemsPerIteration(starts.size());
+            while (state.keepRunning()) {
+                for (int i=0; i<starts.size(); i++) {
+                    doNotOptimize(graph.findPath(starts[i],goals[i%goals.size()]));
+                }
+            }
+        });
+    }
+}
+
+/**
+ * @brief writeScenario : write the scenario described by "layout,servers,drones[,rooms],file.json"
+ */
+bool writeScenario(const QString &desc) {
+    auto parts=desc.split(',');
+    if (parts.size()!=4 && parts.size()!=5) return false;
+    int layout=0;
+    while (layout<=ScenarioGenerator::Collinear &&
+           ScenarioGenerator::layoutName(ScenarioGenerator::Layout(layout))!=parts[0]) layout++;
+    if (layout>ScenarioGenerator::Collinear) return false;
+    ScenarioGenerator gen(seed);
+    QList<Server> servers=gen.servers(ScenarioGenerator::Layout(layout),parts[1].toInt(),window);
+    QList<Drone> drones=gen.drones(parts[2].toInt(),servers,window);
+    QVector<Room> rooms=gen.rooms(parts.size()==5?parts[3].toInt():0,window);
+    QFile file(parts.last());
+    if (!file.open(QIODevice::WriteOnly)) {
+        printf("can not write %s\n",qPrintable(parts.last()));
+        return false;
+    }
+    file.write(ScenarioGenerator::toJson(window,servers,drones,rooms).toJson());
+    return true;
+}
+
+int main(int argc,char *argv[]) {
+    QString filter,out,scenario,baseline;
+    qreal minTime=0.5;
+    qreal maxSlowdown=1.25;
+    int checkSeeds=0;
+    for (int i=1; i<argc; i++) {
+        QString arg(argv[i]);
+        if (arg.startsWith("--filter=")) filter=arg.mid(9);
+        else if (arg.startsWith("--out=")) out=arg.mid(6);
+        else if (arg.startsWith("--min-time=")) minTime=arg.mid(11).toDouble();
+        else if (arg.startsWith("--seed=")) seed=arg.mid(7).toUInt();
+        else if (arg.startsWith("--scenario=")) scenario=arg.mid(11);
+        else if (arg.startsWith("--baseline=")) baseline=arg.mid(11);
+        else if (arg.startsWith("--max-slowdown=")) maxSlowdown=arg.mid(15).toDouble();
+        else if (arg=="--check") checkSeeds=1000;
+        else if (arg.startsWith("--check=")) checkSeeds=arg.mid(8).toInt();
+        else {
+            printf("usage: %s [--filter=text] [--out=results.json] [--min-time=seconds] [--seed=n]\n"
+                   "          [--baseline=results.json] [--max-slowdown=x]\n"
+                   "       %s [--filter=text] [--seed=n] --check[=seeds]\n"
+                   "       %s [--seed=n] --scenario=uniform|clustered|grid|collinear,servers,drones[,rooms],file.json\n",argv[0],argv[0],argv[0]);
+            return 1;
+        }
+    }
+    if (!scenario.isEmpty()) {
+        return writeScenario(scenario)?0:1;
+    }
+    if (checkSeeds>0) {
+        CrossCheckSuite checks;
+        addCrossChecks(checks);
+        return checks.run(filter,seed,checkSeeds)==0?0:1;
+    }
+    BenchmarkSuite suite;
+    addGeometryCases(suite);
+    addPredicateCases(suite);
+    addRoutingCases(suite);
+    addDroneCases(suite);
+    addViewCases(suite);
+    addHitTestCases(suite);
+    addNavigationCases(suite);
+    auto results=suite.run(filter,qint64(minTime*1e9),seed);
+    if (!out.isEmpty()) {
+        QFile file(out);
+        if (!file.open(QIODevice::WriteOnly)) {
+            printf("can not write %s\n",qPrintable(out));
+            return 1;
+        }
+        file.write(results.toJson());
+    }
+    if (!baseline.isEmpty()) {
+        QFile file(baseline);
+        if (!file.open(QIODevice::ReadOnly)) {
+            printf("can not read %s\n",qPrintable(baseline));
+            return 1;
+        }
+        if (BenchmarkSuite::compare(results,QJsonDocument::fromJson(file.readAll()),maxSlowdown)>0) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,12 @@
+#ifndef BUILDPROGRESS_H
+#define BUILDPROGRESS_H
+
+#include <functional>
+
+/**
+ * @brief BuildProgress : called by a stage with the number of steps done (cells, servers...),
+ * the stage stops when it returns false (the results are then incomplete)
+ */
+typedef std::function<bool(int)> BuildProgress;
+
+#endif // BUILDPROGRESS_H
@@ -1,5 +1,11 @@
 #include "canvas.h"
 #include <QPainter>
+#include <QWheelEvent>
+#include <profiler.h>
+#include <hittest.h>
+#include <mapbuilder.h>
+#include <algorithm>
+#include <cmath>
 
 Canvas::Canvas(QWidget *parent) : QWidget{parent} {
     setMouseTracking(true);
@@ -11,8 +17,12 @@ Canvas::Canvas(QWidget *parent) : QWidget{parent} {
 }
 
 void Canvas::paintEvent(QPaintEvent *) {
+    PROFILE_SCOPE("Canvas::paintEvent");
     const QRect rect(-droneIconSize/2,-droneIconSize/2,droneIconSize,droneIconSize);
 
+    const ServerMap &map=*fleet.getMap();
+    const QList<Server> &servers=map.servers;
+    QList<Drone> &drones=fleet.drones;
     QPainter painter(this);
     QBrush whiteBrush(Qt::SolidPattern);
     QPen serverPen(Qt::black);
@@ -29,14 +39,28 @@ void Canvas::paintEvent(QPaintEvent *) {
 
     painter.save(); // drawing area coordinate system
     painter.scale(windowScale.width(),windowScale.height());
-    painter.translate(-windowOrigin);
+    painter.translate(-view.topLeft());
+    // the view enlarged by the size of the icons
+    const Vector2D viewMin(view.left()-droneIconSize,view.top()-droneIconSize);
+    const Vector2D viewMax(view.right()+droneIconSize,view.bottom()+droneIconSize);
 
+    // servers of the visible cells, in the order of the list
+    visibleServers.clear();
+    if (cellIndex.size()==servers.size()) {
+        cellIndex.query(viewMin,viewMax,[this](int i) { visibleServers.append(i); });
+        std::sort(visibleServers.begin(),visibleServers.end());
+    } else {
+        for (int i=0; i<servers.size(); i++) visibleServers.append(i);
+    }
 
-    // drawing the servers
+    // drawing the servers, the cells are built when they are first drawn: a zoomed out view of
+    // a huge map would evict the cells it draws, the cells are only drawn when they fit in the cache
+    const bool drawCells=map.cells.size()==servers.size() && visibleServers.size()<=lazyCellsCacheSize;
     QRect r;
-    for (auto &s:servers) {
+    for (int i:visibleServers) {
+        const Server &s=servers[i];
         painter.setBrush(s.color);
-        s.area.draw(painter);
+        if (drawCells) map.cells.cell(i)->draw(painter);
 
         painter.save();
         painter.translate(s.position);
@@ -55,17 +79,44 @@ void Canvas::paintEvent(QPaintEvent *) {
         painter.restore();
     }
 
+    // drawing the walls
+    if (roomIndex.size()==map.rooms.size()) {
+        roomIndex.query(viewMin,viewMax,[&](int i) { map.rooms[i].draw(painter); });
+    } else {
+        for (auto &room:map.rooms) room.draw(painter);
+    }
+    // drawing the barriers between servers
+    QPen barrierPen(Qt::darkRed);
+    barrierPen.setWidth(6);
+    painter.setPen(barrierPen);
+    for (auto &barrier:map.barriers) {
+        const QPointF &A=servers[barrier.first].position,&B=servers[barrier.second].position;
+        if (qMin(A.x(),B.x())>viewMax.x || qMax(A.x(),B.x())<viewMin.x || qMin(A.y(),B.y())>viewMax.y || qMax(A.y(),B.y())<viewMin.y) continue;
+        painter.drawLine(A,B);
+    }
+
     if (showGraph) {
-        // drawing the links
+        // drawing the links of the visible servers, once
         painter.setPen(penLink);
-        for (auto &l:links ) {
-            l->draw(painter);
+        for (int i:visibleServers) {
+            for (LinkId l:servers[i].links) {
+                ServerId other=map.links[l].getOther(i);
+                if (other<i && std::binary_search(visibleServers.begin(),visibleServers.end(),other)) continue;
+                map.links[l].draw(painter,servers);
+            }
         }
+        map.navigation.draw(painter,viewMin,viewMax);
     }
 
-    // drawing the drones
+    // drawing the drones of the view, in the order of the list
+    if (fleet.grid.nbDrones()!=drones.size()) fleet.grid.build(drones,fleet.motion.minDistance);
+    visibleDrones.clear();
+    fleet.grid.forEachInRect(viewMin,viewMax,[this](int i) { visibleDrones.append(i); });
+    std::sort(visibleDrones.begin(),visibleDrones.end());
+    Drone::updateAzimuts(drones,visibleDrones);
     painter.setPen(Qt::white);
-    for (auto &d:drones) {
+    for (int i:visibleDrones) {
+        const Drone &d=drones[i];
         painter.save();
         // place and orient the drone
         painter.translate(d.position.x,d.position.y);
@@ -79,9 +130,148 @@ void Canvas::paintEvent(QPaintEvent *) {
 
         painter.restore();
     }
+    // object under the cursor and selected object
+    QPen hoverPen(QColor(255,128,0));
+    hoverPen.setWidth(3);
+    hoverPen.setCosmetic(true);
+    QPen selectPen(Qt::red);
+    selectPen.setWidth(4);
+    selectPen.setCosmetic(true);
+    if (hovered!=selected) drawPick(painter,hovered,hoverPen);
+    drawPick(painter,selected,selectPen);
+    painter.restore();
+    if (!selected.isEmpty()) drawInspection(painter);
+    if (!preview.isEmpty()) drawPreview(painter);
+#ifdef DRONES_PROFILING
+    if (showProfiler) drawProfiler(painter);
+#endif
+}
+
+void Canvas::drawPick(QPainter &painter,const Pick &pick,const QPen &pen) {
+    if (pick.isEmpty()) return;
+    painter.save();
+    painter.setPen(pen);
+    painter.setBrush(Qt::NoBrush);
+    if (pick.drone!=-1) {
+        const Drone &d=fleet.drones[pick.drone];
+        painter.drawEllipse(QPointF(d.position.x,d.position.y),droneIconSize/2,droneIconSize/2);
+    } else if (pick.link!=invalidId) {
+        fleet.getMap()->links[pick.link].draw(painter,fleet.servers());
+    } else {
+        const Server &s=fleet.servers()[pick.server];
+        auto area=fleet.getMap()->cells.cell(pick.server);
+        QPolygonF cell;
+        for (int i=0; i<area->nbVertices(); i++) {
+            cell.append(QPointF((*area)[i].x,(*area)[i].y));
+        }
+        painter.drawPolygon(cell);
+        painter.drawEllipse(s.position,25,25);
+    }
+    painter.restore();
+}
+
+void Canvas::drawInspection(QPainter &painter) {
+    const Router *router=fleet.planner.getRouter();
+    const QList<Server> &servers=fleet.servers();
+    const QVector<Link> &links=fleet.getMap()->links;
+    const QList<Drone> &drones=fleet.drones;
+    QStringList lines;
+    if (selected.drone!=-1) {
+        const Drone &d=drones[selected.drone];
+        ServerId from=d.getConnectedTo();
+        lines << QString("Drone %1 (%2, %3)").arg(d.name).arg(d.position.x,0,'f',0).arg(d.position.y,0,'f',0);
+        lines << QString("connected to %1").arg(from!=invalidId?servers[from].name:"-");
+        if (d.hasTarget()) {
+            lines << QString("target %1").arg(servers[d.target].name);
+            if (from!=invalidId && router!=nullptr) {
+                auto best=router->bestDistance(from,d.target);
+                lines << QString("distance %1").arg(best.second,0,'f',0);
+            }
+        }
+    } else if (selected.link!=invalidId) {
+        const Link &l=links[selected.link];
+        lines << QString("Link %1 - %2").arg(servers[l.getNode1()].name,servers[l.getNode2()].name);
+        lines << QString("length %1").arg(l.getDistance(),0,'f',0);
+        lines << QString("cost %1").arg(l.getCost(fleet.loads),0,'f',0);
+    } else {
+        const Server &s=servers[selected.server];
+        lines << QString("Server %1 (#%2)").arg(s.name).arg(s.id);
+        const ServerLoad &load=fleet.loads[s.id];
+        lines << QString("capacity %1, connected %2, queue %3").arg(load.capacity).arg(load.nbConnected).arg(load.queueLength());
+        lines << QString("links:");
+        for (LinkId id:s.links) {
+            const Link &l=links[id];
+            lines << QString("  %1 length %2 cost %3").arg(servers[l.getOther(s.id)].name).arg(l.getDistance(),0,'f',0).arg(l.getCost(fleet.loads),0,'f',0);
+        }
+        lines << selectedRoutes;
+        auto connected=HitTest::connectedDrones(drones,fleet.grid,fleet.getMap()->cells,s.id);
+        QStringList names;
+        for (int i=0; i<qMin(int(connected.size()),maxInspectedRows); i++) names << drones[connected[i]].name;
+        if (connected.size()>maxInspectedRows) names << "...";
+        lines << QString("drones (%1): %2").arg(connected.size()).arg(names.join(" "));
+    }
+    QFont font("Courier",10);
+    QFontMetrics fm(font);
+    int lh=fm.height();
+    int w=0;
+    for (auto &line:lines) w=qMax(w,fm.horizontalAdvance(line));
+    QRect r(width()-w-20,10,w+10,lh*lines.size()+10);
+    painter.setFont(font);
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(QColor(0,0,0,160));
+    painter.drawRect(r);
+    painter.setPen(Qt::white);
+    int y=r.top()+5+fm.ascent();
+    for (auto &line:lines) {
+        painter.drawText(r.left()+5,y,line);
+        y+=lh;
+    }
+}
+
+void Canvas::drawPreview(QPainter &painter) {
+    painter.save();
+    // the new map may have another window
+    painter.scale(qreal(width())/preview.size.width(),qreal(height())/preview.size.height());
+    painter.translate(-preview.origin);
+    QPen cellPen(Qt::darkGray);
+    cellPen.setWidth(2);
+    painter.setPen(cellPen);
+    for (int i=0; i<preview.cells.size(); i++) {
+        QColor c=preview.colors[i];
+        c.setAlpha(96);
+        painter.setBrush(c);
+        painter.drawPolygon(preview.cells[i]);
+    }
+    painter.setPen(Qt::black);
+    for (int i=0; i<preview.servers.size(); i++) {
+        painter.setBrush(preview.colors[i]);
+        painter.drawEllipse(preview.servers[i],10,10);
+    }
     painter.restore();
+}
 
+#ifdef DRONES_PROFILING
+void Canvas::drawProfiler(QPainter &painter) {
+    auto stages=Profiler::instance().stageTimings();
+    QFont font("Courier",10);
+    QFontMetrics fm(font);
+    int lh=fm.height();
+    QRect r(10,10,fm.horizontalAdvance("MainWindow::update  999.99 ms (999.99)")+10,lh*(stages.size()+2)+10);
+    painter.setFont(font);
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(QColor(0,0,0,160));
+    painter.drawRect(r);
+    painter.setPen(Qt::white);
+    int y=r.top()+5+fm.ascent();
+    painter.drawText(r.left()+5,y,QString("FPS %1").arg(Profiler::instance().fps(),0,'f',1));
+    y+=lh;
+    painter.drawText(r.left()+5,y,"stage  last ms (mean)");
+    for (auto &st:stages) {
+        y+=lh;
+        painter.drawText(r.left()+5,y,QString("%1 %2 (%3)").arg(st.name,-20).arg(st.lastMs,7,'f',2).arg(st.meanMs,0,'f',2));
+    }
 }
+#endif
 
 void Canvas::resizeEvent(QResizeEvent *event) {
     int w = event->size().width();
@@ -104,13 +294,119 @@ void Canvas::resizeEvent(QResizeEvent *event) {
 
     QWidget::resizeEvent(event);
 
-    windowScale={qreal(width())/windowSize.width(),
-                   qreal(height())/windowSize.height()};
+    updateScale();
 }
 
+void Canvas::buildIndex() {
+    const QList<Server> &servers=fleet.servers();
+    const VoronoiCells &cells=fleet.getMap()->cells;
+    QVector<QPair<Vector2D,Vector2D>> boxes;
+    boxes.reserve(servers.size());
+    // the icon and the name are drawn around the position
+    const float iconRadius=100;
+    for (auto &s:servers) {
+        Vector2D pos(s.position.x(),s.position.y());
+        QPair<Vector2D,Vector2D> box={pos-Vector2D(iconRadius,iconRadius),pos+Vector2D(iconRadius,iconRadius)};
+        if (s.id<cells.size()) {
+            auto &cell=cells.bounds(s.id);
+            box.first={qMin(box.first.x,cell.first.x),qMin(box.first.y,cell.first.y)};
+            box.second={qMax(box.second.x,cell.second.x),qMax(box.second.y,cell.second.y)};
+        }
+        boxes.append(box);
+    }
+    cellIndex.build(boxes);
+    boxes.clear();
+    for (auto &room:fleet.getMap()->rooms) boxes.append(room.outline.getBoundingBox());
+    roomIndex.build(boxes);
+}
+
+Pick Canvas::pickAt(const QPointF &pos) const {
+    QPointF q=toWindow(pos);
+    Vector2D p(q.x(),q.y());
+    const QList<Server> &servers=fleet.servers();
+    Pick pick;
+    if (fleet.grid.nbDrones()==fleet.drones.size()) {
+        pick.drone=HitTest::droneAt(fleet.drones,fleet.grid,p,droneIconSize/2);
+        if (pick.drone!=-1) return pick;
+    }
+    if (cellIndex.size()!=servers.size()) return pick;
+    if (showGraph) {
+        // a few pixels around the lines
+        pick.link=HitTest::linkAt(servers,fleet.getMap()->links,cellIndex,p,4.0/windowScale.width());
+        if (pick.link!=invalidId) return pick;
+    }
+    pick.server=HitTest::serverAt(servers,fleet.getMap()->cells,cellIndex,p,25);
+    return pick;
+}
+
+void Canvas::select(const Pick &pick) {
+    selected=pick;
+    selectedRoutes.clear();
+    const Router *router=fleet.planner.getRouter();
+    if (pick.server==-1 || router==nullptr || cellIndex.size()!=fleet.servers().size()) return;
+    // routing row restricted to the nearest servers (the router is by length: the row does not change)
+    const QList<Server> &servers=fleet.servers();
+    const QVector<Link> &links=fleet.getMap()->links;
+    const Server &s=servers[pick.server];
+    const float diagonal=std::hypot(windowSize.width(),windowSize.height());
+    QVector<QPair<qreal,QString>> row;
+    for (int i:HitTest::nearestServers(servers,cellIndex,Vector2D(s.position.x(),s.position.y()),maxInspectedRows+1,diagonal)) {
+        if (i==pick.server) continue;
+        auto best=router->bestDistance(s.id,i);
+        if (best.first==invalidId) continue;
+        ServerId next=links[best.first].getOther(s.id);
+        row.append({best.second,QString("  %1 via %2 distance %3").arg(servers[i].name,servers[next].name).arg(best.second,0,'f',0)});
+    }
+    std::sort(row.begin(),row.end(),[](const QPair<qreal,QString> &a,const QPair<qreal,QString> &b) { return a.first<b.first; });
+    selectedRoutes << QString("routes to the %1 nearest servers:").arg(row.size());
+    for (auto &r:row) selectedRoutes << r.second;
+}
 
 void Canvas::mousePressEvent(QMouseEvent *event) {
+    lastMousePos=event->position();
+    pressMousePos=event->position();
+}
+
+void Canvas::mouseReleaseEvent(QMouseEvent *event) {
+    // a few pixels of motion are a click, a longer drag only moves the view
+    const qreal clickDistance=4;
+    if (event->button()!=Qt::LeftButton) return;
+    QPointF delta=event->position()-pressMousePos;
+    if (delta.x()*delta.x()+delta.y()*delta.y()>clickDistance*clickDistance) return;
+    select(pickAt(event->position()));
+    update();
+}
+
+void Canvas::mouseMoveEvent(QMouseEvent *event) {
+    if (!(event->buttons() & Qt::LeftButton)) {
+        Pick pick=pickAt(event->position());
+        if (pick!=hovered) {
+            hovered=pick;
+            update();
+        }
+        return;
+    }
+    // drag the view
+    QPointF delta=event->position()-lastMousePos;
+    lastMousePos=event->position();
+    view.translate(-delta.x()/windowScale.width(),-delta.y()/windowScale.height());
+    update();
+}
+
+void Canvas::mouseDoubleClickEvent(QMouseEvent *) {
+    resetView();
+    update();
+}
 
-    repaint();
+void Canvas::wheelEvent(QWheelEvent *event) {
+    // zoom around the point under the cursor, from 1/4 to 64 times the window
+    qreal factor=std::pow(1.2,event->angleDelta().y()/120.0);
+    qreal w=qBound(windowSize.width()/64.0,view.width()/factor,windowSize.width()*4.0);
+    qreal h=w*view.height()/view.width();
+    QPointF p=toWindow(event->position());
+    qreal kx=(p.x()-view.left())/view.width(),ky=(p.y()-view.top())/view.height();
+    view=QRectF(p.x()-kx*w,p.y()-ky*h,w,h);
+    updateScale();
+    update();
 }
 
@@ -4,45 +4,115 @@
 #include <QWidget>
 #include <QMouseEvent>
 #include <QPaintEvent>
-#include <serveranddrone.h>
+#include <fleet.h>
+#include <maploader.h>
+#include <rtree.h>
 
+/**
+ * @brief The Pick struct : object of the map under a point, at most one of the three is set
+ */
+struct Pick {
+    int server=-1; ///< index of the server of the cell
+    int drone=-1; ///< index of the drone
+    LinkId link=invalidId; ///< index of the link
+    bool isEmpty() const { return server==-1 && drone==-1 && link==invalidId; }
+    bool operator==(const Pick &p) const { return server==p.server && drone==p.drone && link==p.link; }
+    bool operator!=(const Pick &p) const { return !(*this==p); }
+};
+
+/**
+ * @brief The Canvas class draws the map in a view of its window: the view is moved by
+ * dragging with the left button, zoomed with the wheel and reset by a double click.
+ * Only the cells (R-tree of their boxes) and drones (DroneGrid) of the view are drawn.
+ * The object under the cursor is highlighted, a click shows its details (HitTest uses the same indexes).
+ * The map and the drones are those of the fleet.
+ */
 class Canvas : public QWidget {
     Q_OBJECT
 public:
+    static const int maxInspectedRows=10; ///< lines of the lists of the details of a server
     explicit Canvas(QWidget *parent = nullptr);
     ~Canvas() {
         clear();
     }
 
     void clear() {
-        for (auto &l:links) {
-            delete l;
-        }
-        links.clear();
-        drones.clear();
-        servers.clear();
+        fleet.clear();
+        cellIndex.clear();
+        roomIndex.clear();
+        hovered=selected=Pick();
+        selectedRoutes.clear();
     }
     void setWindow(const QPoint &origin, const QSize &size) {
         windowOrigin=origin;
         windowSize=size;
-        windowScale={qreal(width())/windowSize.width(),qreal(height())/windowSize.height()};
+        resetView();
+    }
+    /**
+     * @brief resetView : show the whole window
+     */
+    void resetView() {
+        view=QRectF(windowOrigin.x(),windowOrigin.y(),windowSize.width(),windowSize.height());
+        updateScale();
     }
+    /**
+     * @brief buildIndex : index the boxes of the cells and server icons and of the rooms, must be called when the map changes
+     */
+    void buildIndex();
+    /**
+     * @brief pickAt : drone, link (if the graph is shown) or server cell under a point of the widget
+     */
+    Pick pickAt(const QPointF &pos) const;
     QPoint getOrigin() { return windowOrigin; }
     QSize getSize() { return windowSize; }
     void paintEvent(QPaintEvent*) override;
     void resizeEvent(QResizeEvent *event) override;
     void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
 
-    QList<Server> servers;
-    QList<Drone> drones;
-    QList<Link*> links;
+    Fleet fleet; ///< drones flying over the shared map
+    MapPreview preview; ///< map being loaded, drawn over the current one
     bool showGraph=false;
+#ifdef DRONES_PROFILING
+    bool showProfiler=false; ///< overlay with the time spent in each stage
+#endif
 signals:
 
 private:
+    void drawPreview(QPainter &painter);
+    void drawPick(QPainter &painter,const Pick &pick,const QPen &pen);
+    /**
+     * @brief drawInspection : details of the selected object (refreshed at each frame, except selectedRoutes)
+     */
+    void drawInspection(QPainter &painter);
+    /**
+     * @brief select : set the selected object and compute its routing rows
+     */
+    void select(const Pick &pick);
+#ifdef DRONES_PROFILING
+    void drawProfiler(QPainter &painter);
+#endif
+    void updateScale() {
+        windowScale={qreal(width())/view.width(),qreal(height())/view.height()};
+    }
+    QPointF toWindow(const QPointF &p) const {
+        return {view.left()+p.x()/windowScale.width(),view.top()+p.y()/windowScale.height()};
+    }
     QPoint windowOrigin;
     QSize windowSize;
-    QSizeF windowScale;
+    QRectF view; ///< visible part of the window
+    QSizeF windowScale; ///< pixels per unit of the view
+    QPointF lastMousePos;
+    QPointF pressMousePos; ///< a release close to the press is a click (select), otherwise the end of a drag
+    RTree cellIndex; ///< boxes of the cells and icons of the servers
+    RTree roomIndex; ///< boxes of the room outlines
+    QVector<int> visibleServers,visibleDrones; ///< drawn in the last frame
+    Pick hovered; ///< object under the cursor
+    Pick selected; ///< object clicked, its details are shown
+    QStringList selectedRoutes; ///< routes from the selected server to its maxInspectedRows nearest servers (computed by select)
     qreal droneIconSize;
     QImage droneImg; ///< picture representing the drone in the canvas
 };
@@ -35,7 +35,7 @@ void Matrix33::get3x3From4x4(const Matrix44 &mat44,int shadowLin, int shadowCol)
     }
 }
 
-float Matrix33::determinant() {
+float Matrix33::cofactorDeterminant() {
     Matrix22 mat22;
     float det=0;
 
@@ -49,14 +49,14 @@ float Matrix33::determinant() {
 }
 
 
-float  Matrix44::determinant() {
+float  Matrix44::cofactorDeterminant() {
     Matrix33 mat33;
     float det=0;
 
     float sign=1;
     for (int i=0; i<4; i++) {
         mat33.get3x3From4x4(*this,i,0);
-        det += sign*m[i][0]*mat33.determinant();
+        det += sign*m[i][0]*mat33.cofactorDeterminant();
         sign = -sign;
     }
     return det;
@@ -8,6 +8,21 @@
 class Matrix33;
 class Matrix44;
 
+/**
+ * Closed-form determinants (no copy of the minors), in double to keep the
+ * products of coordinates exact as long as possible.
+ */
+constexpr double det2(double a,double b,
+                      double c,double d) {
+    return a*d-b*c;
+}
+
+constexpr double det3(double a,double b,double c,
+                      double d,double e,double f,
+                      double g,double h,double i) {
+    return a*det2(e,f,h,i)-b*det2(d,f,g,i)+c*det2(d,e,g,h);
+}
+
 class Matrix22 {
 public:
     float m[2][2];
@@ -23,14 +38,45 @@ public:
     float m[3][3];
 
     void get3x3From4x4(const Matrix44 &mat44,int shadowLin, int shadowCol);
-    float determinant();
+    inline float determinant() const {
+        return float(det3(m[0][0],m[0][1],m[0][2],
+                          m[1][0],m[1][1],m[1][2],
+                          m[2][0],m[2][1],m[2][2]));
+    }
+    /**
+     * @brief cofactorDeterminant : expansion along the first column with copies of the minors,
+     * reference implementation kept for the benchmarks.
+     */
+    float cofactorDeterminant();
 };
 
 class Matrix44 {
 public:
     float m[4][4];
 
-    float determinant();
+    /**
+     * @brief determinant : Laplace expansion along the two first columns (products of 2x2 minors)
+     */
+    inline float determinant() const {
+        double s0=det2(m[0][0],m[0][1],m[1][0],m[1][1]);
+        double s1=det2(m[0][0],m[0][1],m[2][0],m[2][1]);
+        double s2=det2(m[0][0],m[0][1],m[3][0],m[3][1]);
+        double s3=det2(m[1][0],m[1][1],m[2][0],m[2][1]);
+        double s4=det2(m[1][0],m[1][1],m[3][0],m[3][1]);
+        double s5=det2(m[2][0],m[2][1],m[3][0],m[3][1]);
+        double c5=det2(m[2][2],m[2][3],m[3][2],m[3][3]);
+        double c4=det2(m[1][2],m[1][3],m[3][2],m[3][3]);
+        double c3=det2(m[1][2],m[1][3],m[2][2],m[2][3]);
+        double c2=det2(m[0][2],m[0][3],m[2][2],m[2][3]);
+        double c1=det2(m[0][2],m[0][3],m[3][2],m[3][3]);
+        double c0=det2(m[0][2],m[0][3],m[1][2],m[1][3]);
+        return float(s0*c5-s1*c4+s2*c3+s3*c1-s4*c2+s5*c0);
+    }
+    /**
+     * @brief cofactorDeterminant : expansion along the first column with copies of the minors,
+     * reference implementation kept for the benchmarks.
+     */
+    float cofactorDeterminant();
 };
 
 
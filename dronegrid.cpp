@@ -0,0 +1,96 @@
+#include "dronegrid.h"
+
+void DroneGrid::build(const QList<Drone> &drones,qreal size) {
+    cellSize=size;
+    invCellSize=1.0/size;
+    int n=drones.size();
+    // power of 2 number of buckets, about 2 buckets per drone
+    unsigned nb=1;
+    while (nb<unsigned(2*n)) nb<<=1;
+    mask=nb-1;
+
+    // counting sort of the drones by bucket
+    bucketStart.fill(0,nb+1);
+    droneBucket.resize(n);
+    for (int i=0; i<n; i++) {
+        int b=bucket(cellCoord(drones[i].position.x),cellCoord(drones[i].position.y));
+        droneBucket[i]=b;
+        bucketStart[b+1]++;
+    }
+    for (unsigned b=0; b<nb; b++) {
+        bucketStart[b+1]+=bucketStart[b];
+    }
+    sortedDrones.resize(n);
+    sortedX.resize(n);
+    sortedY.resize(n);
+    // droneBucket becomes the insertion position of each drone
+    for (int i=0; i<n; i++) {
+        int pos=bucketStart[droneBucket[i]+1]-1;
+        bucketStart[droneBucket[i]+1]=pos;
+        droneBucket[i]=pos;
+    }
+    for (int i=0; i<n; i++) {
+        int pos=droneBucket[i];
+        sortedDrones[pos]=i;
+        sortedX[pos]=drones[i].position.x;
+        sortedY[pos]=drones[i].position.y;
+    }
+    // bucketStart[b+1] has been decreased to the start of bucket b, shift back
+    for (unsigned b=0; b<nb; b++) {
+        bucketStart[b]=bucketStart[b+1];
+    }
+    bucketStart[nb]=n;
+}
+
+int DroneGrid::collectBuckets(const Vector2D &p,int *tab) const {
+    int ix=cellCoord(p.x);
+    int iy=cellCoord(p.y);
+    int n=0;
+    for (int dy=-1; dy<=1; dy++) {
+        for (int dx=-1; dx<=1; dx++) {
+            int b=bucket(ix+dx,iy+dy);
+            // two cells may share a bucket: visit it once
+            int k=0;
+            while (k<n && tab[k]!=b) k++;
+            if (k==n) tab[n++]=b;
+        }
+    }
+    return n;
+}
+
+void DroneGrid::separate(QList<Drone> &drones,qreal minDist) {
+    build(drones,minDist);
+    int n=drones.size();
+    corrections.fill(Vector2D(0,0),n);
+    const float minDist2=minDist*minDist;
+    int tab[9];
+    for (int s=0; s<n; s++) {
+        int i=sortedDrones[s];
+        float x=sortedX[s];
+        float y=sortedY[s];
+        int nb=collectBuckets(drones[i].position,tab);
+        for (int k=0; k<nb; k++) {
+            for (int t=bucketStart[tab[k]]; t<bucketStart[tab[k]+1]; t++) {
+                int j=sortedDrones[t];
+                if (j<=i) continue; // each pair once
+                float dx=x-sortedX[t];
+                float dy=y-sortedY[t];
+                float d2=dx*dx+dy*dy;
+                if (d2>=minDist2) continue;
+                Vector2D dir;
+                float d=sqrt(d2);
+                if (d>1e-6) {
+                    dir.set(dx/d,dy/d);
+                } else { // same position: deterministic direction from the index
+                    dir.set(cos(i*2.39996),sin(i*2.39996));
+                }
+                Vector2D push=(0.5*(minDist-d))*dir;
+                corrections[i]+=push;
+                corrections[j]+=-push;
+            }
+        }
+    }
+    for (int i=0; i<n; i++) {
+        drones[i].position+=corrections[i];
+    }
+}
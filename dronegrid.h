@@ -0,0 +1,89 @@
+#ifndef DRONEGRID_H
+#define DRONEGRID_H
+
+#include <QVector>
+#include <serveranddrone.h>
+
+/**
+ * @brief The DroneGrid class is a spatial hash of the drone positions.
+ * Space is divided in square cells of size cellSize, each cell is hashed in a bucket
+ * and the drones are sorted by bucket with a counting sort (O(n) rebuild per tick).
+ * The drones close to a point are found in the 3x3 cells around it.
+ */
+class DroneGrid {
+public:
+    /**
+     * @brief build : sort the drones in the buckets
+     * @param drones list of drones
+     * @param size size of a cell, must be greater than the search radius
+     */
+    void build(const QList<Drone> &drones,qreal size);
+    /**
+     * @brief forEachNeighbor : call f(i) for each drone i of the 3x3 cells around p
+     * @warning f is also called for drones of far cells that share a bucket, the distance must be checked.
+     */
+    template<class F> void forEachNeighbor(const Vector2D &p,F f) const;
+    /**
+     * @brief forEachInRect : call f(i) once for each drone i of the cells that intersect the box (min,max)
+     * @warning the drones of these cells can be a little outside of the box.
+     */
+    template<class F> void forEachInRect(const Vector2D &min,const Vector2D &max,F f) const;
+    /**
+     * @brief separate : move the drones closer than minDist away from each other
+     * (each drone of a pair makes half of the correction).
+     * @param drones list of drones
+     * @param minDist minimal distance between two drones
+     */
+    void separate(QList<Drone> &drones,qreal minDist);
+    int nbDrones() const { return sortedDrones.size(); }
+private:
+    int cellCoord(float v) const { return int(floor(v*invCellSize)); }
+    int bucket(int ix,int iy) const {
+        return int((unsigned(ix)*73856093u ^ unsigned(iy)*19349663u) & mask);
+    }
+    int collectBuckets(const Vector2D &p,int *tab) const;
+
+    float cellSize=1;
+    float invCellSize=1;
+    unsigned mask=0;
+    QVector<int> bucketStart; ///< drones of bucket b are in [bucketStart[b],bucketStart[b+1][
+    QVector<int> sortedDrones; ///< indices of the drones sorted by bucket
+    QVector<float> sortedX,sortedY; ///< positions in the same order (contiguous scans)
+    QVector<int> droneBucket;
+    QVector<Vector2D> corrections;
+};
+
+template<class F> void DroneGrid::forEachNeighbor(const Vector2D &p,F f) const {
+    if (sortedDrones.isEmpty()) return;
+    int tab[9];
+    int n=collectBuckets(p,tab);
+    for (int k=0; k<n; k++) {
+        for (int i=bucketStart[tab[k]]; i<bucketStart[tab[k]+1]; i++) {
+            f(sortedDrones[i]);
+        }
+    }
+}
+
+template<class F> void DroneGrid::forEachInRect(const Vector2D &min,const Vector2D &max,F f) const {
+    if (sortedDrones.isEmpty()) return;
+    int ix0=cellCoord(min.x),ix1=cellCoord(max.x);
+    int iy0=cellCoord(min.y),iy1=cellCoord(max.y);
+    if (qint64(ix1-ix0+1)*(iy1-iy0+1)>qint64(mask)+1) {
+        // more cells than buckets: scan the positions
+        for (int i=0; i<sortedDrones.size(); i++) {
+            if (sortedX[i]>=min.x && sortedX[i]<=max.x && sortedY[i]>=min.y && sortedY[i]<=max.y) f(sortedDrones[i]);
+        }
+        return;
+    }
+    for (int iy=iy0; iy<=iy1; iy++) {
+        for (int ix=ix0; ix<=ix1; ix++) {
+            int b=bucket(ix,iy);
+            for (int i=bucketStart[b]; i<bucketStart[b+1]; i++) {
+                // cells that share the bucket
+                if (cellCoord(sortedX[i])==ix && cellCoord(sortedY[i])==iy) f(sortedDrones[i]);
+            }
+        }
+    }
+}
+
+#endif // DRONEGRID_H
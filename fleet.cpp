@@ -0,0 +1,101 @@
+#include "fleet.h"
+#include <QThreadPool>
+#include <profiler.h>
+
+Fleet::Fleet():map(new ServerMap) {
+    planner.setMap(map.data());
+}
+
+void Fleet::reset(const ServerMapPtr &p_map,const QList<Drone> &p_drones) {
+    map=p_map;
+    drones=p_drones;
+    loads.fill(ServerLoad(),map->servers.size());
+    for (auto &s:map->servers) {
+        loads[s.id].capacity=s.capacity;
+    }
+    planner.setMap(map.data());
+    planner.setRouter(map->router);
+    routeJob.reset(); // a running job ends on its own copy of the previous map
+    updateRoutes();
+}
+
+void Fleet::clear() {
+    reset(ServerMapPtr(new ServerMap),QList<Drone>());
+}
+
+void Fleet::step(qreal dt) {
+    PROFILE_SCOPE("Fleet::step");
+    // update positions of drones
+    for (auto &drone:drones) {
+        drone.move(dt,motion);
+    }
+    // keep drones at minDistance from each other
+    grid.separate(drones,motion.minDistance);
+    // handoffs of the step, routes are updated when the congestion changes
+    handoffs.collect(drones,map->cells);
+    congestionChanged=handoffs.apply(drones,loads,dt) || congestionChanged;
+    sinceRoutes+=dt;
+    if (routeJob!=nullptr) {
+        if (!routeJob->done.loadAcquire()) return;
+        planner=routeJob->planner;
+        routedOverloads=routeJob->overloads;
+        routeJob.reset();
+        setRoutes();
+    }
+    if (congestionChanged && sinceRoutes>=rerouteInterval) {
+        congestionChanged=false;
+        // overloads that ended and started again in the interval do not change the routes
+        QVector<ServerId> overloads=overloadedServers();
+        if (overloads==routedOverloads) return;
+        if (asyncRoutes) {
+            startRouteJob(overloads);
+        } else {
+            updateRoutes();
+        }
+    }
+}
+
+void Fleet::updateRoutes() {
+    routedOverloads=overloadedServers();
+    planner.setCongestion(routedOverloads.isEmpty()?QVector<ServerLoad>():loads);
+    setRoutes();
+}
+
+QVector<ServerId> Fleet::overloadedServers() const {
+    QVector<ServerId> overloads;
+    for (int i=0; i<loads.size(); i++) {
+        if (loads[i].isOverloaded()) overloads.push_back(i);
+    }
+    return overloads;
+}
+
+void Fleet::startRouteJob(const QVector<ServerId> &overloads) {
+    routeJob.reset(new RouteJob);
+    routeJob->map=map;
+    routeJob->planner=planner;
+    routeJob->planner.setCongestion(overloads.isEmpty()?QVector<ServerLoad>():loads);
+    routeJob->overloads=overloads;
+    for (auto &drone:drones) {
+        if (drone.hasTarget() && drone.getConnectedTo()!=invalidId) {
+            routeJob->pairs.push_back({drone.getConnectedTo(),drone.target});
+        }
+    }
+    QSharedPointer<RouteJob> job=routeJob;
+    QThreadPool::globalInstance()->start([job]() {
+        for (auto &p:job->pairs) {
+            job->planner.getRoute(p.first,p.second);
+        }
+        job->done.storeRelease(1);
+    });
+}
+
+void Fleet::setRoutes() {
+    sinceRoutes=0;
+    for (auto &drone:drones) {
+        ServerId start=drone.overflownArea(map->cells);
+        if (!drone.hasTarget()) continue;
+        // straight to the target if the drone is outside of the cells
+        drone.setRoute(planner.getRoute(drone.position,start,drone.target));
+    }
+    handoffs.reset(drones,loads);
+}
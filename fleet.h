@@ -0,0 +1,89 @@
+#ifndef FLEET_H
+#define FLEET_H
+
+#include <QList>
+#include <QVector>
+#include <QAtomicInt>
+#include <servermap.h>
+#include <routeplanner.h>
+#include <dronegrid.h>
+#include <handoffbatch.h>
+
+/// minimal time (s) between two updates of the routes for the congestion
+const qreal rerouteInterval=1.0;
+
+/**
+ * @brief The Fleet class is the state of a simulation over a shared ServerMap: the drones,
+ * the loads of the servers and the routes. Many fleets can fly over the same map, the memory
+ * of a fleet depends on its drones (and one ServerLoad per server), not on the geometry.
+ * The fleet always uses the router of the map: while a server is overloaded, the planner
+ * searches the paths around the congestion of the fleet from the lengths of the router.
+ */
+class Fleet {
+public:
+    Fleet();
+    /**
+     * @brief reset : fly the drones over the map, the loads are cleared and the routes computed
+     * @param drones drones whose targets are servers of map
+     */
+    void reset(const ServerMapPtr &map,const QList<Drone> &drones);
+    /**
+     * @brief clear : no drones over an empty map
+     */
+    void clear();
+    const ServerMapPtr& getMap() const { return map; }
+    const QList<Server>& servers() const { return map->servers; }
+    /**
+     * @brief step : move the drones, keep them at motion.minDistance from each other,
+     * apply the handoffs and update the routes when the set of overloaded servers changed,
+     * at most once per rerouteInterval
+     * @param dt duration of the step (s)
+     */
+    void step(qreal dt);
+    /**
+     * @brief updateRoutes : route of each drone from its cell to its target with the current congestion
+     */
+    void updateRoutes();
+    /**
+     * @brief recountLoads : number of drones connected to each server, after the connections were set
+     */
+    void recountLoads() { handoffs.reset(drones,loads); }
+
+    QList<Drone> drones;
+    QVector<ServerLoad> loads; ///< loads[i] is the load of servers()[i]
+    RoutePlanner planner; ///< waypoint chains shared by the drones
+    DroneGrid grid; ///< spatial hash of the drones, rebuilt at each step
+    MotionParameters motion; ///< motion of the drones
+    /**
+     * @brief asyncRoutes : the paths around the congestion are searched in the global thread pool
+     * and the drones get their new routes at the first step after the search (GUI).
+     * Otherwise the routes are updated during the step, the runs are reproducible (BatchRunner).
+     */
+    bool asyncRoutes=false;
+private:
+    /**
+     * @brief The RouteJob struct : chains of the drones for a congestion, computed in the thread pool
+     */
+    struct RouteJob {
+        ServerMapPtr map; ///< the map stays alive until the end of the job
+        RoutePlanner planner;
+        QVector<ServerId> overloads;
+        QVector<QPair<ServerId,ServerId>> pairs; ///< (cell, target) of the drones
+        QAtomicInt done;
+    };
+    QVector<ServerId> overloadedServers() const;
+    void startRouteJob(const QVector<ServerId> &overloads);
+    /**
+     * @brief setRoutes : route of each drone with the planner (its chains are already computed after a job)
+     */
+    void setRoutes();
+
+    ServerMapPtr map;
+    HandoffBatch handoffs; ///< drones changing of cell during a step
+    bool congestionChanged=false; ///< an overload started or ended since the last update of the routes
+    qreal sinceRoutes=0; ///< time (s) since the last update of the routes
+    QVector<ServerId> routedOverloads; ///< overloaded servers of the congestion used by the routes
+    QSharedPointer<RouteJob> routeJob; ///< search running in the thread pool
+};
+
+#endif // FLEET_H
@@ -0,0 +1,57 @@
+#include "handoffbatch.h"
+
+/// time constant (s) of the moving average of the throughput
+const qreal throughputSmoothing=5.0;
+
+void HandoffBatch::reset(const QList<Drone> &drones,QVector<ServerLoad> &loads) {
+    pending.clear();
+    for (auto &l:loads) {
+        l.nbConnected=0;
+    }
+    for (auto &d:drones) {
+        if (d.getConnectedTo()!=invalidId) loads[d.getConnectedTo()].nbConnected++;
+    }
+}
+
+void HandoffBatch::collect(const QList<Drone> &drones,const VoronoiCells &cells) {
+    for (int i=0; i<drones.size(); i++) {
+        ServerId area=drones[i].findArea(cells);
+        if (area!=drones[i].getConnectedTo()) {
+            pending.push_back({i,drones[i].getConnectedTo(),area});
+        }
+    }
+}
+
+bool HandoffBatch::apply(QList<Drone> &drones,QVector<ServerLoad> &loads,qreal dt) {
+    QVector<bool> wasOverloaded(loads.size());
+    for (int i=0; i<loads.size(); i++) {
+        wasOverloaded[i]=loads[i].isOverloaded();
+        loads[i].stepHandoffs=0;
+    }
+    for (auto &h:pending) {
+        if (h.from!=invalidId) {
+            ServerLoad &from=loads[h.from];
+            from.nbConnected--;
+            from.handoffsOut++;
+        }
+        if (h.to!=invalidId) {
+            ServerLoad &to=loads[h.to];
+            to.nbConnected++;
+            to.handoffsIn++;
+            to.stepHandoffs++;
+        }
+        drones[h.drone].connectTo(h.to);
+    }
+    pending.clear();
+
+    bool changed=false;
+    qreal alpha=dt>0?qMin(1.0,dt/throughputSmoothing):0;
+    for (int i=0; i<loads.size(); i++) {
+        ServerLoad &s=loads[i];
+        s.maxConnected=qMax(s.maxConnected,s.nbConnected);
+        s.maxQueueLength=qMax(s.maxQueueLength,s.queueLength());
+        if (dt>0) s.throughput+=alpha*(s.stepHandoffs/dt-s.throughput);
+        changed=changed || (s.isOverloaded()!=wasOverloaded[i]);
+    }
+    return changed;
+}
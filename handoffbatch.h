@@ -0,0 +1,39 @@
+#ifndef HANDOFFBATCH_H
+#define HANDOFFBATCH_H
+
+#include <QVector>
+#include <voronoicells.h>
+
+/**
+ * @brief The HandoffBatch class collects the drones that change of cell during a step
+ * and applies all the handoffs at the end of the step: connection counts, metrics of the servers
+ * (in the loads of the fleet, loads[i] is the load of the server of id i).
+ */
+class HandoffBatch {
+public:
+    /**
+     * @brief reset : recount the drones connected to each server and clear the pending handoffs
+     */
+    void reset(const QList<Drone> &drones,QVector<ServerLoad> &loads);
+    /**
+     * @brief collect : find the drones that left their cell
+     */
+    void collect(const QList<Drone> &drones,const VoronoiCells &cells);
+    /**
+     * @brief apply : process the pending handoffs and update the server metrics
+     * @param drones drones given to the last collect()
+     * @param dt duration of the step (s)
+     * @return true if a server went over or back under its capacity
+     */
+    bool apply(QList<Drone> &drones,QVector<ServerLoad> &loads,qreal dt);
+    int size() const { return pending.size(); }
+private:
+    struct Handoff {
+        int drone; ///< index of the drone
+        ServerId from;
+        ServerId to;
+    };
+    QVector<Handoff> pending;
+};
+
+#endif // HANDOFFBATCH_H
@@ -0,0 +1,84 @@
+#include "hittest.h"
+#include <algorithm>
+
+int HitTest::serverAt(const QList<Server> &servers,const VoronoiCells &cells,const RTree &index,const Vector2D &p,float iconRadius) {
+    int res=-1,hint=-1;
+    index.query(p,p,[&](int i) {
+        if (res!=-1) return;
+        if (hint==-1) hint=i;
+        const Server &s=servers[i];
+        Vector2D pos(s.position.x(),s.position.y());
+        if ((p-pos).length()<=iconRadius) res=i;
+    });
+    // the walk starts from a server whose cell box contains p: it is only a few steps
+    if (res==-1 && hint!=-1) res=cells.locate(p,hint);
+    return res;
+}
+
+int HitTest::droneAt(const QList<Drone> &drones,const DroneGrid &grid,const Vector2D &p,float radius) {
+    int res=-1;
+    float best=radius*radius;
+    grid.forEachInRect(p-Vector2D(radius,radius),p+Vector2D(radius,radius),[&](int i) {
+        float dx=drones[i].position.x-p.x,dy=drones[i].position.y-p.y;
+        float d2=dx*dx+dy*dy;
+        if (d2<=best) {
+            best=d2;
+            res=i;
+        }
+    });
+    return res;
+}
+
+float HitTest::segmentDistance(const Vector2D &p,const Vector2D &a,const Vector2D &b) {
+    Vector2D ab=b-a;
+    double l2=ab*ab;
+    double t=(l2>0)?qBound(0.0,((p-a)*ab)/l2,1.0):0.0;
+    return (p-(a+t*ab)).length();
+}
+
+LinkId HitTest::linkAt(const QList<Server> &servers,const QVector<Link> &links,const RTree &index,const Vector2D &p,float tolerance) {
+    // the half of a link on the side of a server is in its cell
+    LinkId res=invalidId;
+    float best=tolerance;
+    index.query(p-Vector2D(tolerance,tolerance),p+Vector2D(tolerance,tolerance),[&](int i) {
+        const Server &s=servers[i];
+        Vector2D pos(s.position.x(),s.position.y());
+        for (LinkId l:s.links) {
+            float d=segmentDistance(p,pos,links[l].getEdgeCenter());
+            if (d<=best) {
+                best=d;
+                res=l;
+            }
+        }
+    });
+    return res;
+}
+
+QVector<int> HitTest::connectedDrones(const QList<Drone> &drones,const DroneGrid &grid,const VoronoiCells &cells,ServerId server) {
+    QVector<int> res;
+    if (server<0 || server>=cells.size()) return res;
+    auto &box=cells.bounds(server);
+    grid.forEachInRect(box.first,box.second,[&](int i) {
+        if (drones[i].getConnectedTo()==server) res.append(i);
+    });
+    std::sort(res.begin(),res.end());
+    return res;
+}
+
+QVector<int> HitTest::nearestServers(const QList<Server> &servers,const RTree &index,const Vector2D &p,int k,float maxRadius) {
+    QVector<QPair<float,int>> found;
+    // the box grows until it holds k servers in its inscribed circle (or all the servers, or the whole map)
+    for (float r=100; ; r*=2) {
+        found.clear();
+        index.query(p-Vector2D(r,r),p+Vector2D(r,r),[&](int i) {
+            Vector2D pos(servers[i].position.x(),servers[i].position.y());
+            float d=(pos-p).length();
+            if (d<=r) found.append({d,i});
+        });
+        if (found.size()>=k || found.size()==servers.size() || r>=maxRadius) break;
+    }
+    std::sort(found.begin(),found.end());
+    QVector<int> res;
+    for (int i=0; i<qMin(k,int(found.size())); i++) res.append(found[i].second);
+    return res;
+}
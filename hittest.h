@@ -0,0 +1,52 @@
+#ifndef HITTEST_H
+#define HITTEST_H
+
+#include <QList>
+#include <QVector>
+#include <voronoicells.h>
+#include <dronegrid.h>
+#include <rtree.h>
+
+/**
+ * @brief The HitTest class finds the objects under a point of the map with the spatial indexes
+ * of the canvas: the R-tree of the cell boxes for the servers and the links, the DroneGrid for
+ * the drones. Only the objects of the index entries around the point are tested, the cells
+ * are located on the Delaunay triangulation (see VoronoiCells) so that no polygon is built.
+ * @warning box i of the R-tree must be the box of the cell of servers[i] (see Canvas::buildIndex).
+ */
+class HitTest {
+public:
+    /**
+     * @brief serverAt : server of the icon under p, or of the cell that contains p
+     * @param iconRadius radius of the icon of the servers
+     * @return index of the server, -1 if none
+     */
+    static int serverAt(const QList<Server> &servers,const VoronoiCells &cells,const RTree &index,const Vector2D &p,float iconRadius);
+    /**
+     * @brief droneAt : closest drone to p
+     * @param radius maximal distance to p
+     * @return index of the drone, -1 if none
+     */
+    static int droneAt(const QList<Drone> &drones,const DroneGrid &grid,const Vector2D &p,float radius);
+    /**
+     * @brief linkAt : closest link to p (a link is drawn from each server to the center of the common edge)
+     * @param tolerance maximal distance to p
+     * @return the link, invalidId if none
+     */
+    static LinkId linkAt(const QList<Server> &servers,const QVector<Link> &links,const RTree &index,const Vector2D &p,float tolerance);
+    /**
+     * @brief connectedDrones : drones connected to the server, searched in the grid cells of the box of its cell
+     * @return indices of the drones, in the order of the list
+     */
+    static QVector<int> connectedDrones(const QList<Drone> &drones,const DroneGrid &grid,const VoronoiCells &cells,ServerId server);
+    /**
+     * @brief nearestServers : the k servers closest to p, searched in R-tree boxes of growing size
+     * @param maxRadius distance from p beyond which there is no server (the diagonal of the window)
+     * @return indices of the servers, closest first
+     */
+    static QVector<int> nearestServers(const QList<Server> &servers,const RTree &index,const Vector2D &p,int k,float maxRadius);
+private:
+    static float segmentDistance(const Vector2D &p,const Vector2D &a,const Vector2D &b);
+};
+
+#endif // HITTEST_H
@@ -1,9 +1,18 @@
 #include "mainwindow.h"
 
 #include <QApplication>
+#include <batchrunner.h>
 
 int main(int argc, char *argv[])
 {
+    // parameter sweeps without GUI, see BatchRunner
+    for (int i=1; i<argc; i++) {
+        if (QString(argv[i]).startsWith("--batch")) {
+            QCoreApplication a(argc, argv);
+            BatchRunner runner;
+            return runner.exec(a.arguments());
+        }
+    }
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
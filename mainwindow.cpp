@@ -1,277 +1,267 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include <canvas.h>
-#include <QJsonDocument>
-#include <QJsonArray>
-#include <QJsonObject>
 #include <QFile>
 #include <QFileDialog>
 #include <QMessageBox>
-#include <trianglemesh.h>
+#include <QTextStream>
+#include <profiler.h>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
+    loadingBar=new QProgressBar(this);
+    loadingBar->setRange(0,100);
+    loadingBar->setMaximumWidth(200);
+    loadingBar->setVisible(false);
+    ui->statusbar->addPermanentWidget(loadingBar);
+    ui->actionCancel_loading->setEnabled(false);
+    // the paths around the congestion are searched out of the GUI thread
+    ui->canvas->fleet.asyncRoutes=true;
     // load initial simple case
-    loadJson("../../json/simple.json");
-    //loadJson("../../json/arcane.json");
+    startLoading("../../json/simple.json");
+    //startLoading("../../json/arcane.json");
 }
 
 MainWindow::~MainWindow()
 {
+    delete loader; // stops at its next progress step
     delete ui;
 }
 
-bool MainWindow::loadJson(const QString& title) {
-    QFile file(title);
-    if (!file.open(QIODevice::ReadOnly)) {
-        qWarning() << "Impossible d'ouvrir le fichier:" << title;
-        return false;
+void MainWindow::startLoading(const QString &fileName) {
+    // a new file replaces the one being loaded: it stops at its next progress step
+    // and is deleted when its thread ends, the GUI does not wait for it
+    if (loader!=nullptr) {
+        loader->cancel();
+        connect(loader,SIGNAL(finished()),loader,SLOT(deleteLater()));
+        if (loader->isFinished()) loader->deleteLater();
     }
+    loader=new MapLoader(fileName,ui->canvas->getOrigin(),ui->canvas->getSize(),this);
+    connect(loader,SIGNAL(progressChanged(int,QString)),this,SLOT(loadingProgress(int,QString)));
+    connect(loader,SIGNAL(finished()),this,SLOT(loadingFinished()));
+    loadingBar->setValue(0);
+    loadingBar->setVisible(true);
+    ui->actionCancel_loading->setEnabled(true);
+    loader->start();
+}
 
-    QByteArray data = file.readAll();
-    file.close();
+void MainWindow::loadingProgress(int percent,const QString &stage) {
+    if (loader==nullptr || sender()!=loader) return; // signal of a replaced loader
+    loadingBar->setValue(percent);
+    ui->statusbar->showMessage(QString("Loading %1: %2").arg(loader->getFileName(),stage));
+    ui->canvas->preview=loader->preview();
+    ui->canvas->update();
+}
 
-    QJsonParseError error;
-    QJsonDocument doc = QJsonDocument::fromJson(data, &error);
-    if (error.error != QJsonParseError::NoError) {
-        qWarning() << "Erreur JSON:" << error.errorString();
-        return false;
-    }
-    if (!doc.isObject()) {
-        qWarning() << "Le document JSON n'est pas un objet.";
-        return false;
+void MainWindow::loadingFinished() {
+    if (loader==nullptr || sender()!=loader) return;
+    MapData *map=loader->takeMap();
+    QString fileName=loader->getFileName();
+    loader->deleteLater();
+    loader=nullptr;
+    loadingBar->setVisible(false);
+    ui->actionCancel_loading->setEnabled(false);
+    ui->canvas->preview=MapPreview();
+    if (map==nullptr) {
+        ui->statusbar->showMessage(QString("Loading of %1 cancelled or failed").arg(fileName),5000);
+        ui->canvas->update();
+        return;
     }
+    installMap(map);
+    delete map;
+    ui->statusbar->showMessage(QString("%1 loaded").arg(fileName),5000);
+}
 
-    QJsonObject root = doc.object();
-
-    // --- Window ---
-    if (root.contains("window") && root["window"].isObject()) {
-        QJsonObject win = root["window"].toObject();
+void MainWindow::installMap(MapData *map) {
+    recorder.close();
+    ui->actionRecord_telemetry->setChecked(false);
+    replay.close();
+    Canvas *canvas=ui->canvas;
+    canvas->clear();
+    // the map is shared, not copied: the drones point to its servers
+    canvas->setWindow(map->map->origin,map->map->size);
+    canvas->fleet.reset(map->map,map->drones);
+    canvas->buildIndex();
+    canvas->update();
+}
 
-        auto origin = win.value("origine").toString().split(",");
-        auto size   = win.value("size").toString().split(",");
-        QPoint wOrigin={origin[0].toInt(),origin[1].toInt()};
-        QSize wSize={size[0].toInt(),size[1].toInt()};
-        qDebug() << "Window.origine =" << wOrigin;
-        qDebug() << "Window.size    =" << wSize;
-        ui->canvas->setWindow(wOrigin,wSize);
-    }
+void MainWindow::on_actionCancel_loading_triggered() {
+    if (loader!=nullptr) loader->cancel();
+}
 
-    // --- Servers ---
-    if (root.contains("servers") && root["servers"].isArray()) {
-        int num=0;
-        QJsonArray arr = root["servers"].toArray();
-        for (const QJsonValue &v : arr) {
-            if (!v.isObject()) continue;
-            QJsonObject obj = v.toObject();
-            Server s;
-            s.name = obj.value("name").toString();
-            QString pos = obj.value("position").toString();
-            auto parts = pos.split(',');
-            if (parts.size() == 2)
-                s.position = QPoint(parts[0].toInt(), parts[1].toInt());
-            s.color = QColor(obj.value("color").toString());
-            s.id=num++;
-            ui->canvas->servers.append(s);
-            qDebug() << "Server:" << s.id << "," << s.name << s.position << s.color;
+void MainWindow::update() {
+    PROFILE_SCOPE("MainWindow::update");
+    static int last=elapsedTimer.elapsed();
+    int current=elapsedTimer.elapsed();
+    int dt=current-last;
+    last=current;
+    Fleet &fleet=ui->canvas->fleet;
+    if (replay.isOpen()) {
+        replayTime+=qint64(dt*replaySpeed);
+        if (!replay.advanceTo(replayTime)) {
+            replayTime=replay.time(); // end of the log: stay on the last frame
         }
+        replay.apply(fleet.drones,fleet.servers(),fleet.loads);
+        // the grid is used to find the drones to draw
+        fleet.grid.build(fleet.drones,fleet.motion.minDistance);
+        ui->canvas->repaint();
+        return;
     }
+    fleet.step(dt/1000.0);
+    if (recorder.isRecording()) {
+        recordTime+=dt;
+        recorder.record(recordTime,fleet.drones);
+    }
+    ui->canvas->repaint();
+}
 
-    // --- Drones ---
-    if (root.contains("drones") && root["drones"].isArray()) {
-        QJsonArray arr = root["drones"].toArray();
+void MainWindow::startAnimation() {
+    if (timer!=nullptr) return;
+    timer = new QTimer(this);
+    timer->setInterval(100);
+    connect(timer,SIGNAL(timeout()),this,SLOT(update()));
+    timer->start();
 
-        for (const QJsonValue &v : arr) {
-            if (!v.isObject()) continue;
-            QJsonObject obj = v.toObject();
-           Drone d;
-            d.name = obj.value("name").toString();
-            QString pos = obj.value("position").toString();
-            auto parts = pos.split(',');
-            if (parts.size() == 2)
-                d.position = Vector2D(parts[0].toInt(), parts[1].toInt());
-            QString name = obj.value("target").toString();
-            // search name in server list
-            d.target=nullptr;
-            auto it=ui->canvas->servers.begin();
-            while (it!=ui->canvas->servers.end() && it->name!=name) it++;
-            if (it!=ui->canvas->servers.end()) {
-                d.target=&(*it);
-                qDebug() << "Drone:" << d.name << "(" << d.position.x << "," << d.position.y << ") →" << d.target->name;
-            } else {
-                qDebug() << "error in JsonFile: bad destination name: " << name;
-            }
-            ui->canvas->drones.append(d);
-        }
-    }
+    elapsedTimer.start();
+}
 
-    createVoronoiMap();
-    createServersLinks();
-    fillDistanceArray();
-    return true;
+void MainWindow::on_actionShow_graph_triggered(bool checked) {
+    ui->canvas->showGraph=checked;
+    ui->canvas->repaint();
 }
 
-void MainWindow::createVoronoiMap() {
-    TriangleMesh mesh(ui->canvas->servers);
-    mesh.setBox(ui->canvas->getOrigin(),ui->canvas->getSize());
 
-    auto triangles = mesh.getTriangles();
-    auto m_servor = ui->canvas->servers.begin();
-    QVector<const Triangle*> tabTri;
-    while (m_servor!=ui->canvas->servers.end()) {
-        // for all vertices of the mesh
-        const Vector2D vert((*m_servor).position.x(),(*m_servor).position.y());
-        auto mt_it = triangles->begin();
-        tabTri.clear(); // tabTri: list of triangles containing m_vert
-        while (mt_it!=triangles->end()) {
-            if ((*mt_it).hasVertex(vert)) {
-                tabTri.push_back(&(*mt_it));
-            }
-            mt_it++;
-        }
-        // find left border
-        auto first = tabTri.begin();
-        auto tt_it = tabTri.begin();
-        bool found=false;
-        while (tt_it!=tabTri.end() && !found) {
-            auto comp_it = tabTri.begin();
-            while (comp_it!=tabTri.end() && (*tt_it)->getNextVertex(vert)!=(*comp_it)->getPrevVertex(vert)) {
-                comp_it++;
-            }
-            if (comp_it==tabTri.end()) {
-                first=tt_it;
-                found=true;
-            }
-            tt_it++;
-        }
-        // create polygon
+void MainWindow::on_actionMove_drones_triggered() {
+    replay.close();
+    startAnimation();
+}
 
-        //poly->setColor((*m_servor)->color);
-        tt_it=first;
-        if (found && mesh.isInWindow((*tt_it)->getCenter().x,(*tt_it)->getCenter().y)) { // add a point for the left border
-            Vector2D V = (*first)->nextEdgeNormal(vert);
-            float k;
-            if (V.x > 0) { // (circumCenter+k V).x=width
-                k = (mesh.getWindowXmax() - (*first)->getCenter().x) / float(V.x);
-            } else {
-                k = (mesh.getWindowXmin()-(*first)->getCenter().x) / float(V.x);
-            }
-            if (V.y > 0) { // (circumCenter+k V).y=height
-                k = fmin(k, (mesh.getWindowYmax() - (*first)->getCenter().y) / float(V.y));
-            } else {
-                k = fmin(k, (mesh.getWindowYmin()-(*first)->getCenter().y) / float(V.y));
-            }
-            m_servor->area.addVertex(Vector2D((*first)->getCenter() + k * V));
-            Vector2D pt = (*first)->getCenter() + k * V;
-        }
-        auto comp_it = first;
-        do {
-            m_servor->area.addVertex((*tt_it)->getCenter());
-            // search triangle on right of tt_it
-            comp_it = tabTri.begin();
-            while (comp_it!=tabTri.end() && (*tt_it)->getPrevVertex(vert)!=(*comp_it)->getNextVertex(vert)) {
-                comp_it++;
-            }
-            if (comp_it!=tabTri.end()) tt_it = comp_it;
-        } while (tt_it!=first && comp_it!=tabTri.end());
-        if (found && mesh.isInWindow((*tt_it)->getCenter())) { // add a point for the right border
-            Vector2D V = (*tt_it)->previousEdgeNormal(vert);
-            float k;
-            if (V.x > 0) { // (circumCenter+k V).x=width
-                k = (mesh.getWindowXmax() - (*tt_it)->getCenter().x) / float(V.x);
-            } else {
-                k = (mesh.getWindowXmin()-(*tt_it)->getCenter().x) / float(V.x);
-            }
-            if (V.y > 0) { // (circumCenter+k V).y=height
-                k = fmin(k, (mesh.getWindowYmax() - (*tt_it)->getCenter().y) / float(V.y));
-            } else {
-                k = fmin(k, (mesh.getWindowYmin()-(*tt_it)->getCenter().y) / float(V.y));
-            }
-            m_servor->area.addVertex(Vector2D((*tt_it)->getCenter() + k * V));
-            Vector2D pt = (*tt_it)->getCenter() + k * V;
-        }
-        qDebug() << m_servor->name;
-        m_servor->area.clip(mesh.getWindowXmin(),mesh.getWindowYmin(),mesh.getWindowXmax(),mesh.getWindowYmax());
-        m_servor->area.triangulate();
 
-        m_servor++;
-    }
+void MainWindow::on_actionQuit_triggered() {
+    QApplication::quit();
 }
 
-void MainWindow::createServersLinks() {
-    // for each polygon, if it exists a common edge with another
-    // polygon, add a link between the servers.
-
 
+void MainWindow::on_actionCredits_triggered() {
+    QMessageBox::information(this,"About DroneAndRooms program",
+                             "My tiny project.\nCredit Benoît Piranda");
 }
 
-void MainWindow::fillDistanceArray() {
-    // define a nServers x nServers array
-    int nServers = ui->canvas->servers.size();
-    distanceArray.resize(nServers);
-    for (int i=0; i<nServers; i++) {
-        distanceArray[i].resize(nServers);
+
+void MainWindow::on_actionExport_metrics_triggered() {
+    auto fileName = QFileDialog::getSaveFileName(this,tr("Export server metrics"), "metrics.csv", tr("CSV Files (*.csv)"));
+    if (fileName.isEmpty()) return;
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qWarning() << "Impossible d'ouvrir le fichier:" << fileName;
+        return;
     }
-    // init Servers distanceArray
-    for (auto &s:ui->canvas->servers) {
-        s.bestDistance.resize(nServers);
-        for (int i=0; i<nServers; i++) {
-            s.bestDistance[i]={nullptr,0};
-        }
+    QTextStream out(&file);
+    out << "server,capacity,connected,maxConnected,queueLength,maxQueueLength,handoffsIn,handoffsOut,throughput\n";
+    const Fleet &fleet=ui->canvas->fleet;
+    for (auto &s:fleet.servers()) {
+        const ServerLoad &l=fleet.loads[s.id];
+        out << s.name << "," << l.capacity << "," << l.nbConnected << "," << l.maxConnected << ","
+            << l.queueLength() << "," << l.maxQueueLength << "," << l.handoffsIn << ","
+            << l.handoffsOut << "," << l.throughput << "\n";
     }
-
-    /* Write here the code to compute the distance array for all servers */
-
-    // set first step Destinations
 }
 
-void MainWindow::update() {
-    static int last=elapsedTimer.elapsed();
-    int current=elapsedTimer.elapsed();
-    int dt=current-last;
-    // update positions of drones
-    for (auto &drone:ui->canvas->drones) {
-        drone.move(dt/1000.0);
-    }
+void MainWindow::on_actionShow_profiler_triggered(bool checked) {
+#ifdef DRONES_PROFILING
+    ui->canvas->showProfiler=checked;
     ui->canvas->repaint();
+#else
+    Q_UNUSED(checked);
+    QMessageBox::information(this,"Profiler","Profiling is disabled, build with CONFIG+=profiling.");
+#endif
 }
 
-void MainWindow::on_actionShow_graph_triggered(bool checked) {
-    ui->canvas->showGraph=checked;
-    ui->canvas->repaint();
+void MainWindow::on_actionExport_trace_triggered() {
+#ifdef DRONES_PROFILING
+    auto fileName = QFileDialog::getSaveFileName(this,tr("Export Chrome trace"), "trace.json", tr("JSON Files (*.json)"));
+    if (!fileName.isEmpty() && !Profiler::instance().exportChromeTrace(fileName)) {
+        qWarning() << "Impossible d'ouvrir le fichier:" << fileName;
+    }
+#else
+    QMessageBox::information(this,"Profiler","Profiling is disabled, build with CONFIG+=profiling.");
+#endif
 }
 
+void MainWindow::on_actionRecord_telemetry_triggered(bool checked) {
+    if (!checked) {
+        recorder.close();
+        return;
+    }
+    auto fileName = QFileDialog::getSaveFileName(this,tr("Record telemetry"), "run.drtl", tr("Telemetry Files (*.drtl)"));
+    if (fileName.isEmpty() || !recorder.open(fileName,ui->canvas->fleet.drones.size(),ui->canvas->fleet.servers().size())) {
+        if (!fileName.isEmpty()) qWarning() << "Impossible d'ouvrir le fichier:" << fileName;
+        ui->actionRecord_telemetry->setChecked(false);
+        return;
+    }
+    recordTime=0;
+}
 
-void MainWindow::on_actionMove_drones_triggered() {
-    timer = new QTimer(this);
-    timer->setInterval(100);
-    connect(timer,SIGNAL(timeout()),this,SLOT(update()));
-    timer->start();
-
-    elapsedTimer.start();
+void MainWindow::on_actionReplay_telemetry_triggered() {
+    auto fileName = QFileDialog::getOpenFileName(this,tr("Replay telemetry"), ".", tr("Telemetry Files (*.drtl)"));
+    if (fileName.isEmpty()) return;
+    if (!replay.open(fileName)) {
+        qWarning() << "Impossible d'ouvrir le fichier:" << fileName;
+        return;
+    }
+    // the log only stores indices: it must be replayed on the scenario that was recorded
+    if (replay.nbDrones()!=ui->canvas->fleet.drones.size() || replay.nbServers()!=ui->canvas->fleet.servers().size()) {
+        QMessageBox::warning(this,"Telemetry",QString("The log was recorded with %1 drones and %2 servers, load the same scenario first.")
+                             .arg(replay.nbDrones()).arg(replay.nbServers()));
+        replay.close();
+        return;
+    }
+    replaySpeed=1.0;
+    seekReplay(0);
+    startAnimation();
 }
 
+void MainWindow::seekReplay(qint64 timeMs) {
+    if (!replay.isOpen() || !replay.seek(timeMs)) return;
+    replayTime=replay.time();
+    Fleet &fleet=ui->canvas->fleet;
+    replay.apply(fleet.drones,fleet.servers(),fleet.loads);
+    fleet.grid.build(fleet.drones,fleet.motion.minDistance);
+    ui->statusbar->showMessage(QString("Replay %1 s, speed x%2").arg(replayTime/1000.0).arg(replaySpeed));
+    ui->canvas->repaint();
+}
 
-void MainWindow::on_actionQuit_triggered() {
-    QApplication::quit();
+void MainWindow::on_actionReplay_faster_triggered() {
+    replaySpeed*=2.0;
+    ui->statusbar->showMessage(QString("Replay speed x%1").arg(replaySpeed));
 }
 
+void MainWindow::on_actionReplay_slower_triggered() {
+    replaySpeed/=2.0;
+    ui->statusbar->showMessage(QString("Replay speed x%1").arg(replaySpeed));
+}
 
-void MainWindow::on_actionCredits_triggered() {
-    QMessageBox::information(this,"About DroneAndRooms program",
-                             "My tiny project.\nCredit Benoît Piranda");
+void MainWindow::on_actionPrevious_keyframe_triggered() {
+    if (!replay.isOpen() || replay.nbKeyframes()==0) return;
+    int k=replay.keyframeIndex(replayTime);
+    // from a keyframe, go to the previous one
+    if (k>0 && replayTime==replay.keyframeTime(k)) k--;
+    seekReplay(replay.keyframeTime(k));
 }
 
+void MainWindow::on_actionNext_keyframe_triggered() {
+    if (!replay.isOpen() || replay.nbKeyframes()==0) return;
+    int k=replay.keyframeIndex(replayTime);
+    if (k+1<replay.nbKeyframes()) seekReplay(replay.keyframeTime(k+1));
+}
 
 void MainWindow::on_actionLoad_triggered() {
     auto fileName = QFileDialog::getOpenFileName(this,tr("Open json description file"), "../../data", tr("JSON Files (*.json)"));
     if (!fileName.isEmpty()) {
-        ui->canvas->clear();
-        loadJson(fileName);
-        ui->canvas->update();
+        startLoading(fileName);
     }
 }
 
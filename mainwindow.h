@@ -4,6 +4,9 @@
 #include <QMainWindow>
 #include <QTimer>
 #include <QElapsedTimer>
+#include <QProgressBar>
+#include <telemetry.h>
+#include <maploader.h>
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -32,22 +35,59 @@ private slots:
 
     void on_actionLoad_triggered();
 
+    void on_actionExport_metrics_triggered();
+
+    void on_actionShow_profiler_triggered(bool checked);
+
+    void on_actionExport_trace_triggered();
+
+    void on_actionRecord_telemetry_triggered(bool checked);
+
+    void on_actionReplay_telemetry_triggered();
+
+    void on_actionReplay_faster_triggered();
+
+    void on_actionReplay_slower_triggered();
+
+    void on_actionPrevious_keyframe_triggered();
+
+    void on_actionNext_keyframe_triggered();
+
+    void on_actionCancel_loading_triggered();
+
+    void loadingProgress(int percent,const QString &stage);
+
+    void loadingFinished();
+
 private:
     /**
-     * @brief loadJson
-     * @param title
-     * @return
+     * @brief startLoading : read and build a map in a MapLoader thread,
+     * the current map stays live until the new one is ready
+     * @param fileName json description of the map
+     */
+    void startLoading(const QString &fileName);
+    /**
+     * @brief installMap : replace the map of the canvas by map
+     */
+    void installMap(MapData *map);
+    void startAnimation();
+    /**
+     * @brief seekReplay : show the frame of the log at timeMs
      */
-    bool loadJson(const QString& title);
-    void createVoronoiMap();
-    void createServersLinks();
-    void fillDistanceArray();
+    void seekReplay(qint64 timeMs);
 
     Ui::MainWindow *ui;
-    QVector<QVector<float>> distanceArray;
+    MapLoader *loader=nullptr; ///< map being loaded
+    QProgressBar *loadingBar;
 
     // to animate drones
-    QTimer *timer;
+    QTimer *timer=nullptr;
     QElapsedTimer elapsedTimer;
+
+    TelemetryRecorder recorder;
+    qint64 recordTime=0; ///< time of the last recorded frame (ms)
+    TelemetryReader replay; ///< when open, the drones are moved by the log
+    qint64 replayTime=0;
+    qreal replaySpeed=1.0;
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,97 @@
+#include "mapbuilder.h"
+#include <profiler.h>
+#include <limits>
+#include <algorithm>
+
+void MapBuilder::createVoronoiMap(const QList<Server> &servers,const QVector<MeshEdge> &barriers,VoronoiCells &cells,
+                                  const QPoint &origin,const QSize &size,const BuildProgress &progress) {
+    PROFILE_SCOPE("createVoronoiMap");
+    cells.build(servers,origin,size,barriers);
+    if (servers.size()>=lazyCellsMinServers) {
+        cells.setCacheSize(lazyCellsCacheSize);
+        if (progress) progress(servers.size());
+        return;
+    }
+    cells.setCacheSize(0);
+    for (int i=0; i<servers.size(); i++) {
+        cells.cell(i);
+        if (progress && !progress(i+1)) return;
+    }
+}
+
+void MapBuilder::createServersLinks(QList<Server> &servers,const VoronoiCells &cells,QVector<Link> &links,
+                                    const BuildProgress &progress) {
+    // a link for each pair of Delaunay neighbors whose cells share an edge (each pair once:
+    // a server in no triangle has all the others as neighbors)
+    for (int i=0; i<servers.size(); i++) {
+        cells.forEachNeighbor(i,[&](int j) {
+            if (j<i && cells.isNeighbor(j,i)) return;
+            QPair<Vector2D,Vector2D> edge;
+            if (cells.commonEdge(i,j,edge)) {
+                LinkId link=links.size();
+                links.push_back(Link(servers[i],servers[j],edge));
+                servers[i].links.push_back(link);
+                servers[j].links.push_back(link);
+            }
+        });
+        if (progress && !progress(i+1)) return;
+    }
+}
+
+Router* MapBuilder::createRouter(const QList<Server> &servers,const QVector<Link> &links,
+                                const BuildProgress &progress) {
+    PROFILE_SCOPE("fillDistanceArray");
+    int nServers = servers.size();
+    if (nServers>flatRoutingMaxServers) {
+        // the nServers x nServers tables do not fit in memory
+        HierarchicalRouter *router=new HierarchicalRouter(servers,links,progress);
+        if (!router->isBuilt()) {
+            delete router;
+            return nullptr;
+        }
+        return router;
+    }
+    // define a nServers x nServers array
+    QVector<QVector<float>> distanceArray(nServers);
+    for (int i=0; i<nServers; i++) {
+        distanceArray[i].resize(nServers);
+    }
+
+    /* Write here the code to compute the distance array for all servers */
+    // Floyd-Warshall algorithm, nextLink[i][j] is the first link of the best path from i to j
+    const float inf=std::numeric_limits<float>::infinity();
+    QVector<QVector<LinkId>> nextLink(nServers,QVector<LinkId>(nServers,invalidId));
+    for (int i=0; i<nServers; i++) {
+        distanceArray[i].fill(inf);
+        distanceArray[i][i]=0;
+    }
+    for (LinkId l=0; l<links.size(); l++) {
+        int i=links[l].getNode1();
+        int j=links[l].getNode2();
+        float cost=links[l].getDistance();
+        if (cost<distanceArray[i][j]) {
+            distanceArray[i][j]=distanceArray[j][i]=cost;
+            nextLink[i][j]=nextLink[j][i]=l;
+        }
+    }
+    for (int k=0; k<nServers; k++) {
+        for (int i=0; i<nServers; i++) {
+            if (distanceArray[i][k]==inf) continue;
+            for (int j=0; j<nServers; j++) {
+                float d=distanceArray[i][k]+distanceArray[k][j];
+                if (d<distanceArray[i][j]) {
+                    distanceArray[i][j]=d;
+                    nextLink[i][j]=nextLink[i][k];
+                }
+            }
+        }
+        if (progress && !progress(k+1)) return nullptr;
+    }
+    FlatRouter *router=new FlatRouter(nServers);
+    for (int i=0; i<nServers; i++) {
+        for (int j=0; j<nServers; j++) {
+            router->set(i,j,nextLink[i][j],distanceArray[i][j]);
+        }
+    }
+    return router;
+}
@@ -0,0 +1,58 @@
+#ifndef MAPBUILDER_H
+#define MAPBUILDER_H
+
+#include <QPoint>
+#include <QSize>
+#include <buildprogress.h>
+#include <serveranddrone.h>
+#include <router.h>
+#include <voronoicells.h>
+
+/// above this number of servers, routing uses a contraction hierarchy instead of the full table
+const int flatRoutingMaxServers=2000;
+/// from this number of servers, the cells are built when they are first used (see VoronoiCells)
+const int lazyCellsMinServers=5000;
+/// number of cells kept in memory when they are built lazily
+const int lazyCellsCacheSize=20000;
+
+/**
+ * @brief The MapBuilder class groups the stages that build a map from the server positions,
+ * independently of the GUI (used by MainWindow and by the benchmark).
+ */
+class MapBuilder {
+public:
+    /**
+     * @brief createVoronoiMap : Delaunay triangulation of the servers and their cells
+     * (the window clipped by the bisectors of the server and its Delaunay neighbors).
+     * The barriers are constraints of the triangulation, the cells and the links do not cross them.
+     * Under lazyCellsMinServers servers all the cells are built, otherwise only the triangulation:
+     * the cells are built when they are first drawn and at most lazyCellsCacheSize are kept.
+     * @param servers list of servers
+     * @param barriers segments between servers that the drones cannot cross
+     * @param cells the cells of the servers
+     * @param origin,size window of the map, the cells are clipped in it
+     * @param progress called after each cell (once for the lazy cells)
+     */
+    static void createVoronoiMap(const QList<Server> &servers,const QVector<MeshEdge> &barriers,VoronoiCells &cells,
+                                 const QPoint &origin,const QSize &size,const BuildProgress &progress=nullptr);
+    /**
+     * @brief createServersLinks : create a link between servers with a common cell edge,
+     * computed from the Delaunay neighbors without building the cells (no link crosses a barrier)
+     * @param servers list of servers
+     * @param cells the cells of the servers (createVoronoiMap)
+     * @param links the new links are added at the end of this table, the servers get their indices
+     * @param progress called after the links of each server
+     */
+    static void createServersLinks(QList<Server> &servers,const VoronoiCells &cells,QVector<Link> &links,
+                                   const BuildProgress &progress=nullptr);
+    /**
+     * @brief createRouter : compute the routing table for small maps
+     * or a contraction hierarchy above flatRoutingMaxServers
+     * @param progress called after each intermediate server of the table or each contracted server of the hierarchy
+     * @return the router to use (owned by the caller), nullptr if stopped by progress
+     */
+    static Router* createRouter(const QList<Server> &servers,const QVector<Link> &links,
+                                const BuildProgress &progress=nullptr);
+};
+
+#endif // MAPBUILDER_H
@@ -0,0 +1,244 @@
+#include "maploader.h"
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QFile>
+#include <mapbuilder.h>
+#include <profiler.h>
+
+MapLoader::MapLoader(const QString &p_fileName,const QPoint &origin,const QSize &size,QObject *parent)
+    : QThread(parent),fileName(p_fileName),defaultOrigin(origin),defaultSize(size) {
+}
+
+MapLoader::~MapLoader() {
+    cancel();
+    wait();
+    delete map;
+}
+
+MapData* MapLoader::takeMap() {
+    MapData *res=map;
+    map=nullptr;
+    return res;
+}
+
+MapPreview MapLoader::preview() const {
+    QMutexLocker lock(&mutex);
+    return previewData;
+}
+
+bool MapLoader::setProgress(const QString &stage,int first,int last,int done,int total) {
+    int p=first+(total>0?(last-first)*done/total:0);
+    if (p!=percent) {
+        percent=p;
+        emit progressChanged(percent,stage);
+    }
+    return !isInterruptionRequested();
+}
+
+void MapLoader::run() {
+    PROFILE_SCOPE("MapLoader::run");
+    MapData *data=new MapData;
+    setProgress("Reading",0,0,0,0);
+    if (!readJson(fileName,*data) || isInterruptionRequested()) {
+        delete data;
+        return;
+    }
+    ServerMap &m=*data->map;
+    if (!data->hasWindow) {
+        m.origin=defaultOrigin;
+        m.size=defaultSize;
+    }
+    // the servers are shown as soon as they are parsed
+    mutex.lock();
+    previewData.origin=m.origin;
+    previewData.size=m.size;
+    for (auto &s:m.servers) {
+        previewData.servers.append(s.position);
+        previewData.colors.append(s.color);
+    }
+    previewData.cells.reserve(m.servers.size());
+    mutex.unlock();
+    int n=m.servers.size();
+    setProgress("Cells",10,60,0,n);
+
+    bool ok=true;
+    MapBuilder::createVoronoiMap(m.servers,m.barriers,m.cells,m.origin,m.size,[this,&m,n,&ok](int done) {
+        // cells are built in the order of the servers (huge maps: only the triangulation, no preview of the cells)
+        if (n<lazyCellsMinServers) {
+            QPolygonF cell;
+            auto area=m.cells.cell(done-1);
+            for (int i=0; i<area->nbVertices(); i++) {
+                cell.append(QPointF((*area)[i].x,(*area)[i].y));
+            }
+            mutex.lock();
+            previewData.cells.append(cell);
+            mutex.unlock();
+        }
+        return ok=setProgress("Cells",10,60,done,n);
+    });
+    if (ok) {
+        MapBuilder::createServersLinks(m.servers,m.cells,m.links,[this,n,&ok](int done) {
+            return ok=setProgress("Links",60,75,done,n);
+        });
+    }
+    if (ok) {
+        setProgress("Navigation",75,80,0,1);
+        m.navigation.build(m.rooms,m.wallClearance,[this,&m,&ok](int done) {
+            return ok=setProgress("Navigation",75,80,done,m.navigation.nbNodes());
+        });
+    }
+    if (ok) {
+        ok=setProgress("Routing",80,100,0,n);
+    }
+    if (ok) {
+        m.router.reset(MapBuilder::createRouter(m.servers,m.links,[this,n](int done) {
+            return setProgress("Routing",80,100,done,n);
+        }));
+        ok=!m.router.isNull();
+    }
+    if (!ok || isInterruptionRequested()) {
+        delete data;
+        return;
+    }
+    setProgress("Ready",100,100,0,0);
+    map=data;
+}
+
+bool MapLoader::readJson(const QString &fileName,MapData &map) {
+    PROFILE_SCOPE("loadJson");
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Impossible d'ouvrir le fichier:" << fileName;
+        return false;
+    }
+
+    QByteArray data = file.readAll();
+    file.close();
+
+    QJsonParseError error;
+    QJsonDocument doc = QJsonDocument::fromJson(data, &error);
+    if (error.error != QJsonParseError::NoError) {
+        qWarning() << "Erreur JSON:" << error.errorString();
+        return false;
+    }
+    if (!doc.isObject()) {
+        qWarning() << "Le document JSON n'est pas un objet.";
+        return false;
+    }
+
+    QJsonObject root = doc.object();
+
+    // --- Window ---
+    if (root.contains("window") && root["window"].isObject()) {
+        QJsonObject win = root["window"].toObject();
+
+        auto origin = win.value("origine").toString().split(",");
+        auto size   = win.value("size").toString().split(",");
+        map.map->origin={origin[0].toInt(),origin[1].toInt()};
+        map.map->size={size[0].toInt(),size[1].toInt()};
+        map.hasWindow=true;
+        qDebug() << "Window.origine =" << map.map->origin;
+        qDebug() << "Window.size    =" << map.map->size;
+    }
+
+    // --- Servers ---
+    if (root.contains("servers") && root["servers"].isArray()) {
+        int num=0;
+        QJsonArray arr = root["servers"].toArray();
+        for (const QJsonValue &v : arr) {
+            if (!v.isObject()) continue;
+            QJsonObject obj = v.toObject();
+            Server s;
+            s.name = obj.value("name").toString();
+            QString pos = obj.value("position").toString();
+            auto parts = pos.split(',');
+            if (parts.size() == 2)
+                s.position = QPoint(parts[0].toInt(), parts[1].toInt());
+            s.color = QColor(obj.value("color").toString());
+            if (obj.contains("capacity")) s.capacity = obj.value("capacity").toInt(defaultServerCapacity);
+            s.id=num++;
+            map.map->servers.append(s);
+            qDebug() << "Server:" << s.id << "," << s.name << s.position << s.color;
+        }
+    }
+
+    // --- Drones ---
+    if (root.contains("drones") && root["drones"].isArray()) {
+        QJsonArray arr = root["drones"].toArray();
+
+        for (const QJsonValue &v : arr) {
+            if (!v.isObject()) continue;
+            QJsonObject obj = v.toObject();
+           Drone d;
+            d.name = obj.value("name").toString();
+            QString pos = obj.value("position").toString();
+            auto parts = pos.split(',');
+            if (parts.size() == 2)
+                d.position = Vector2D(parts[0].toInt(), parts[1].toInt());
+            QString name = obj.value("target").toString();
+            // search name in server list
+            d.target=invalidId;
+            const QList<Server> &servers=map.map->servers;
+            int i=0;
+            while (i<servers.size() && servers[i].name!=name) i++;
+            if (i<servers.size()) {
+                d.target=i;
+                qDebug() << "Drone:" << d.name << "(" << d.position.x << "," << d.position.y << ") →" << servers[i].name;
+            } else {
+                qDebug() << "error in JsonFile: bad destination name: " << name;
+            }
+            map.drones.append(d);
+        }
+    }
+
+    // --- Rooms ---
+    if (root.contains("rooms") && root["rooms"].isArray()) {
+        QJsonArray arr = root["rooms"].toArray();
+        for (const QJsonValue &v : arr) {
+            if (!v.isObject()) continue;
+            QJsonObject obj = v.toObject();
+            Room room;
+            room.name = obj.value("name").toString();
+            for (const QJsonValue &pos : obj.value("vertices").toArray()) {
+                auto parts = pos.toString().split(',');
+                if (parts.size() == 2)
+                    room.outline.addVertex(parts[0].toFloat(), parts[1].toFloat());
+            }
+            for (const QJsonValue &pos : obj.value("doors").toArray()) {
+                auto parts = pos.toString().split(',');
+                if (parts.size() == 2)
+                    room.doors.append(Vector2D(parts[0].toFloat(), parts[1].toFloat()));
+            }
+            if (obj.contains("doorWidth")) room.doorWidth = obj.value("doorWidth").toDouble(defaultDoorWidth);
+            if (room.outline.nbVertices()<3) {
+                qDebug() << "error in JsonFile: room with less than 3 vertices: " << room.name;
+                continue;
+            }
+            map.map->rooms.append(room);
+            qDebug() << "Room:" << room.name << room.outline.nbVertices() << "vertices," << room.doors.size() << "doors";
+        }
+    }
+
+    // --- Barriers : lines through servers ---
+    if (root.contains("barriers") && root["barriers"].isArray()) {
+        const QList<Server> &servers=map.map->servers;
+        QJsonArray arr = root["barriers"].toArray();
+        for (const QJsonValue &v : arr) {
+            ServerId previous=invalidId;
+            for (const QJsonValue &name : v.toArray()) {
+                int i=0;
+                while (i<servers.size() && servers[i].name!=name.toString()) i++;
+                if (i==servers.size()) {
+                    qDebug() << "error in JsonFile: bad server name in barrier: " << name.toString();
+                    previous=invalidId;
+                    continue;
+                }
+                if (previous!=invalidId && previous!=i) map.map->barriers.append(qMakePair(previous,i));
+                previous=i;
+            }
+        }
+        qDebug() << "Barriers:" << map.map->barriers.size() << "segments";
+    }
+    return true;
+}
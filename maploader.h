@@ -0,0 +1,91 @@
+#ifndef MAPLOADER_H
+#define MAPLOADER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QPolygonF>
+#include <servermap.h>
+
+/**
+ * @brief The MapData struct : a map read from a json file and built out of the GUI thread,
+ * then given to the fleet of the canvas (the drones point to the servers of the map).
+ */
+struct MapData {
+    bool hasWindow=false; ///< the file gives the window
+    QSharedPointer<ServerMap> map{new ServerMap}; ///< only read once built
+    QList<Drone> drones;
+};
+
+/**
+ * @brief The MapPreview struct : the part of the map already built, drawn over the current map
+ */
+struct MapPreview {
+    QPoint origin;
+    QSize size;
+    QVector<QPointF> servers;
+    QVector<QColor> colors;
+    QVector<QPolygonF> cells; ///< in the order of the servers
+    bool isEmpty() const { return servers.isEmpty(); }
+};
+
+/**
+ * @brief The MapLoader class reads a json file and builds the map (cells, links, navigation graph,
+ * routing table) in its own thread. progressChanged() is emitted when the percentage changes,
+ * the map is taken with takeMap() after finished().
+ */
+class MapLoader : public QThread {
+    Q_OBJECT
+public:
+    /**
+     * @param fileName json description of the map
+     * @param origin,size window used when the file does not give one
+     */
+    MapLoader(const QString &fileName,const QPoint &origin,const QSize &size,QObject *parent=nullptr);
+    ~MapLoader();
+    /**
+     * @brief cancel : stop at the next step, takeMap() will return nullptr
+     */
+    void cancel() { requestInterruption(); }
+    QString getFileName() const { return fileName; }
+    /**
+     * @brief takeMap
+     * @return the map (owned by the caller), nullptr if the loading failed or was cancelled
+     */
+    MapData* takeMap();
+    /**
+     * @brief preview : copy of the servers and cells built so far (thread safe)
+     */
+    MapPreview preview() const;
+    /**
+     * @brief readJson : parse a json description of a map
+     * @param fileName the file to read
+     * @param map the window, servers, drones, rooms and barriers (lines given by server names) are added to map
+     * @return false if the file cannot be read
+     */
+    static bool readJson(const QString &fileName,MapData &map);
+
+signals:
+    void progressChanged(int percent,const QString &stage);
+
+protected:
+    void run() override;
+
+private:
+    /**
+     * @brief setProgress : emit progressChanged when the percentage changes
+     * @param first,last range of percentages of the stage
+     * @param done,total steps of the stage
+     * @return false if the loading is cancelled
+     */
+    bool setProgress(const QString &stage,int first,int last,int done,int total);
+
+    QString fileName;
+    QPoint defaultOrigin;
+    QSize defaultSize;
+    MapData *map=nullptr;
+    int percent=-1;
+    mutable QMutex mutex; ///< protects previewData
+    MapPreview previewData;
+};
+
+#endif // MAPLOADER_H
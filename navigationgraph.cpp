@@ -0,0 +1,293 @@
+#include "navigationgraph.h"
+#include <QMap>
+#include <profiler.h>
+#include <predicates.h>
+#include <scratchbuffer.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <queue>
+
+namespace {
+const qreal infinity=std::numeric_limits<qreal>::infinity();
+const int maxGridCells=16; ///< above this number of cells, isVisible scans all the walls
+
+typedef QPair<qreal,int> QueueItem; ///< (distance,node)
+typedef std::priority_queue<QueueItem,std::vector<QueueItem>,std::greater<QueueItem>> MinQueue;
+
+/**
+ * @brief crosses : true if the segment [AB] crosses the wall W,
+ * passing through an end of the wall or along the wall blocks, touching the wall at A or B does not.
+ */
+bool crosses(const Vector2D &A,const Vector2D &B,const Wall &W) {
+    double o1=orient2d(A.x,A.y,B.x,B.y,W.A.x,W.A.y);
+    double o2=orient2d(A.x,A.y,B.x,B.y,W.B.x,W.B.y);
+    if ((o1>0 && o2>0) || (o1<0 && o2<0)) return false;
+    double o3=orient2d(W.A.x,W.A.y,W.B.x,W.B.y,A.x,A.y);
+    double o4=orient2d(W.A.x,W.A.y,W.B.x,W.B.y,B.x,B.y);
+    if ((o3>0 && o4>0) || (o3<0 && o4<0)) return false;
+    if (o1==0 && o2==0) {
+        // collinear: overlap of the projections on [AB]
+        Vector2D AB=B-A;
+        double t0=(W.A-A)*AB,t1=(W.B-A)*AB;
+        return qMax(t0,t1)>0 && qMin(t0,t1)<AB*AB;
+    }
+    return o3!=0 && o4!=0;
+}
+
+/**
+ * @brief distanceToSegment : distance between p and the segment [AB]
+ */
+double distanceToSegment(const Vector2D &p,const Vector2D &A,const Vector2D &B) {
+    Vector2D AB=B-A;
+    double l2=AB*AB;
+    double t=l2>0?qBound(0.0,((p-A)*AB)/l2,1.0):0.0;
+    return (A+t*AB-p).length();
+}
+}
+
+void NavigationGraph::clear() {
+    walls.clear();
+    for (auto &b:wallBoxes) b.clear();
+    nodes.clear();
+    adjacency.clear();
+    arcs.clear();
+    arcIndex.clear();
+    nodeIndex.clear();
+    trees.clear();
+}
+
+void NavigationGraph::build(const QVector<Room> &rooms,qreal p_clearance,const BuildProgress &progress) {
+    PROFILE_SCOPE("NavigationGraph::build");
+    clear();
+    clearance=p_clearance;
+    for (auto &room:rooms) {
+        walls+=room.walls();
+    }
+    for (auto &w:walls) {
+        wallBoxes[0].push_back(qMin(w.A.x,w.B.x));
+        wallBoxes[1].push_back(qMin(w.A.y,w.B.y));
+        wallBoxes[2].push_back(qMax(w.A.x,w.B.x));
+        wallBoxes[3].push_back(qMax(w.A.y,w.B.y));
+    }
+    buildGrid();
+    // directions of the walls from each wall end
+    QMap<QPair<float,float>,QVector<Vector2D>> ends;
+    for (auto &w:walls) {
+        Vector2D d=w.B-w.A;
+        if (d.length()==0) continue;
+        d.normalize();
+        ends[qMakePair(w.A.x,w.A.y)].push_back(d);
+        ends[qMakePair(w.B.x,w.B.y)].push_back(-d);
+    }
+    // nodes in the free angular sectors larger than 180°
+    QVector<Vector2D> candidates;
+    for (auto it=ends.constBegin(); it!=ends.constEnd(); it++) {
+        Vector2D P(it.key().first,it.key().second);
+        const QVector<Vector2D> &dirs=it.value();
+        if (dirs.size()==1) {
+            // free end: both sides of the end
+            Vector2D d=dirs[0],n(-d.y,d.x);
+            candidates.push_back(P+clearance*(n-d));
+            candidates.push_back(P-clearance*(n+d));
+            continue;
+        }
+        QVector<double> angles;
+        for (auto &d:dirs) angles.push_back(atan2(d.y,d.x));
+        std::sort(angles.begin(),angles.end());
+        for (int i=0; i<angles.size(); i++) {
+            double a0=angles[i];
+            double gap=(i+1<angles.size()?angles[i+1]:angles[0]+2*M_PI)-a0;
+            if (gap>M_PI+1e-6) {
+                double a=a0+0.5*gap;
+                candidates.push_back(P+clearance*Vector2D(cos(a),sin(a)));
+            }
+        }
+    }
+    // the nodes too close to another wall (narrow corridors) are removed
+    for (auto &c:candidates) {
+        bool free=true;
+        for (int i=0; i<walls.size() && free; i++) {
+            free=distanceToSegment(c,walls[i].A,walls[i].B)>=0.5*clearance;
+        }
+        if (free) nodes.push_back(c);
+    }
+    adjacency.resize(nodes.size());
+    for (int i=0; i<nodes.size(); i++) {
+        for (int j=i+1; j<nodes.size(); j++) {
+            if (isVisible(nodes[i],nodes[j])) {
+                qreal l=(nodes[j]-nodes[i]).length();
+                adjacency[i].push_back({j,l});
+                adjacency[j].push_back({i,l});
+            }
+        }
+        if (progress && !progress(i+1)) break;
+    }
+    buildIndex();
+}
+
+void NavigationGraph::buildIndex() {
+    QVector<QPair<Vector2D,Vector2D>> boxes;
+    for (int i=0; i<adjacency.size(); i++) {
+        for (auto &arc:adjacency[i]) {
+            if (arc.first<=i) continue;
+            const Vector2D &A=nodes[i],&B=nodes[arc.first];
+            arcs.push_back({i,arc.first});
+            boxes.push_back({Vector2D(qMin(A.x,B.x),qMin(A.y,B.y)),Vector2D(qMax(A.x,B.x),qMax(A.y,B.y))});
+        }
+    }
+    arcIndex.build(boxes);
+    boxes.clear();
+    for (auto &n:nodes) boxes.push_back({n,n});
+    nodeIndex.build(boxes);
+}
+
+void NavigationGraph::buildGrid() {
+    gridSize=0;
+    gridStart.clear();
+    gridWalls.clear();
+    if (walls.isEmpty()) return;
+    float xmin=*std::min_element(wallBoxes[0].begin(),wallBoxes[0].end());
+    float ymin=*std::min_element(wallBoxes[1].begin(),wallBoxes[1].end());
+    float xmax=*std::max_element(wallBoxes[2].begin(),wallBoxes[2].end());
+    float ymax=*std::max_element(wallBoxes[3].begin(),wallBoxes[3].end());
+    // about one wall per cell
+    gridSize=qMax(1,int(ceil(sqrt(double(walls.size())))));
+    gridOrigin=Vector2D(xmin,ymin);
+    invCellSize=gridSize/qMax(1.0f,qMax(xmax-xmin,ymax-ymin));
+    // counting sort of the (cell,wall) pairs
+    int nbCells=gridSize*gridSize;
+    gridStart.fill(0,nbCells+1);
+    QVector<int> cursor;
+    for (int pass=0; pass<2; pass++) {
+        if (pass==1) {
+            for (int c=0; c<nbCells; c++) gridStart[c+1]+=gridStart[c];
+            gridWalls.resize(gridStart[nbCells]);
+            cursor=gridStart;
+        }
+        for (int i=0; i<walls.size(); i++) {
+            for (int cy=cellY(wallBoxes[1][i]); cy<=cellY(wallBoxes[3][i]); cy++) {
+                for (int cx=cellX(wallBoxes[0][i]); cx<=cellX(wallBoxes[2][i]); cx++) {
+                    int c=cy*gridSize+cx;
+                    if (pass==0) gridStart[c+1]++;
+                    else gridWalls[cursor[c]++]=i;
+                }
+            }
+        }
+    }
+}
+
+bool NavigationGraph::isVisible(const Vector2D &A,const Vector2D &B) const {
+    float xmin=qMin(A.x,B.x),xmax=qMax(A.x,B.x);
+    float ymin=qMin(A.y,B.y),ymax=qMax(A.y,B.y);
+    int n=walls.size();
+    if (n==0) return true;
+    int cx0=cellX(xmin),cx1=cellX(xmax),cy0=cellY(ymin),cy1=cellY(ymax);
+    if ((cx1-cx0+1)*(cy1-cy0+1)<=maxGridCells) {
+        // short segment: walls of the cells of its bounding box (a wall can be tested several times)
+        for (int cy=cy0; cy<=cy1; cy++) {
+            for (int cx=cx0; cx<=cx1; cx++) {
+                int c=cy*gridSize+cx;
+                for (int k=gridStart[c]; k<gridStart[c+1]; k++) {
+                    if (crosses(A,B,walls[gridWalls[k]])) return false;
+                }
+            }
+        }
+        return true;
+    }
+    const float *x0=wallBoxes[0].constData(),*y0=wallBoxes[1].constData();
+    const float *x1=wallBoxes[2].constData(),*y1=wallBoxes[3].constData();
+    for (int i=0; i<n; i++) {
+        // bounding boxes first
+        if (x1[i]<xmin || x0[i]>xmax || y1[i]<ymin || y0[i]>ymax) continue;
+        if (crosses(A,B,walls[i])) return false;
+    }
+    return true;
+}
+
+quint64 NavigationGraph::key(const Vector2D &p) {
+    quint32 x,y;
+    memcpy(&x,&p.x,sizeof(x));
+    memcpy(&y,&p.y,sizeof(y));
+    return (quint64(x)<<32) | y;
+}
+
+NavigationGraph::Tree NavigationGraph::tree(const Vector2D &goal) const {
+    auto k=key(goal);
+    {
+        QMutexLocker lock(&treesMutex);
+        auto it=trees.constFind(k);
+        if (it!=trees.constEnd()) return it.value();
+    }
+
+    // Dijkstra from the goal, the first nodes are the ones visible from the goal
+    Tree t;
+    t.distance.fill(infinity,nodes.size());
+    t.next.fill(-1,nodes.size());
+    MinQueue queue;
+    for (int i=0; i<nodes.size(); i++) {
+        if (isVisible(nodes[i],goal)) {
+            t.distance[i]=(goal-nodes[i]).length();
+            queue.push({t.distance[i],i});
+        }
+    }
+    while (!queue.empty()) {
+        auto item=queue.top();
+        queue.pop();
+        int u=item.second;
+        if (item.first>t.distance[u]) continue;
+        for (auto &arc:adjacency[u]) {
+            qreal d=item.first+arc.second;
+            if (d<t.distance[arc.first]) {
+                t.distance[arc.first]=d;
+                t.next[arc.first]=u;
+                queue.push({d,arc.first});
+            }
+        }
+    }
+    QMutexLocker lock(&treesMutex);
+    trees.insert(k,t);
+    return t;
+}
+
+QVector<Vector2D> NavigationGraph::findPath(const Vector2D &from,const Vector2D &to) const {
+    if (isVisible(from,to)) return {to};
+    const Tree t=tree(to);
+    // candidates by increasing length of the path through them: the first visible one is the best
+    // (heap, only the first candidates are extracted)
+    ScratchBuffer<QueueItem> candidates;
+    for (int i=0; i<nodes.size(); i++) {
+        if (t.distance[i]<infinity) candidates->push_back({(nodes[i]-from).length()+t.distance[i],i});
+    }
+    auto heapBegin=candidates->begin(),heapEnd=candidates->end();
+    std::make_heap(heapBegin,heapEnd,std::greater<QueueItem>());
+    QVector<Vector2D> path;
+    while (heapBegin!=heapEnd) {
+        std::pop_heap(heapBegin,heapEnd,std::greater<QueueItem>());
+        heapEnd--;
+        int first=heapEnd->second;
+        if (!isVisible(from,nodes[first])) continue;
+        for (int n=first; n!=-1; n=t.next[n]) {
+            path.push_back(nodes[n]);
+        }
+        break;
+    }
+    path.push_back(to);
+    return path;
+}
+
+void NavigationGraph::draw(QPainter &painter,const Vector2D &min,const Vector2D &max) const {
+    QPen pen(Qt::DotLine);
+    pen.setColor(Qt::green);
+    pen.setWidth(1);
+    painter.setPen(pen);
+    arcIndex.query(min,max,[&](int a) {
+        const Vector2D &A=nodes[arcs[a].first],&B=nodes[arcs[a].second];
+        painter.drawLine(QPointF(A.x,A.y),QPointF(B.x,B.y));
+    });
+    painter.setBrush(Qt::green);
+    // the box is enlarged by the radius of the nodes
+    nodeIndex.query(min-Vector2D(4,4),max+Vector2D(4,4),[&](int i) {
+        painter.drawEllipse(QPointF(nodes[i].x,nodes[i].y),4,4);
+    });
+}
@@ -0,0 +1,85 @@
+#ifndef NAVIGATIONGRAPH_H
+#define NAVIGATIONGRAPH_H
+
+#include <QHash>
+#include <QVector>
+#include <QMutex>
+#include <QPainter>
+#include <room.h>
+#include <rtree.h>
+#include <serveranddrone.h>
+#include <buildprogress.h>
+
+/**
+ * @brief The NavigationGraph class is a visibility graph of the walls: its nodes are placed
+ * in front of the convex corners and of the wall ends (door jambs), two nodes are linked
+ * if no wall crosses the segment between them. The graph is built once per map in O(n² w).
+ * The shortest path trees toward the goals are cached, a query only searches the
+ * first node visible from the start in the order of the path lengths.
+ * The walls are stored in a uniform grid: the visibility of a short segment only tests the walls of its cells.
+ */
+class NavigationGraph {
+public:
+    /**
+     * @brief build : compute the walls, nodes and links of the graph
+     * @param clearance distance between the wall corners and the nodes: the drones turn at
+     * MotionParameters::slowDownDistance of a waypoint, it must be at least this distance
+     * @param progress called after the links of each node (nbNodes() is known at the first call),
+     * the build stops when it returns false and the graph is then incomplete
+     */
+    void build(const QVector<Room> &rooms,qreal clearance,const BuildProgress &progress=nullptr);
+    void clear();
+    bool isEmpty() const { return walls.isEmpty(); }
+    int nbNodes() const { return nodes.size(); }
+    /**
+     * @brief isVisible
+     * @return true if the segment [AB] does not cross a wall (touching a wall at A or B is allowed)
+     */
+    bool isVisible(const Vector2D &A,const Vector2D &B) const;
+    /**
+     * @brief findPath : shortest path from "from" to "to" avoiding the walls
+     * @return the waypoints after "from", the last one is "to" (straight line if no path exists)
+     */
+    QVector<Vector2D> findPath(const Vector2D &from,const Vector2D &to) const;
+    /**
+     * @brief draw : draw the links and nodes whose boxes intersect the box [min,max]
+     */
+    void draw(QPainter &painter,const Vector2D &min,const Vector2D &max) const;
+private:
+    /**
+     * @brief The Tree struct is the shortest path tree of a goal: distance to the goal
+     * and next node of the path (-1 if the goal is visible) for each node.
+     */
+    struct Tree {
+        QVector<qreal> distance;
+        QVector<int> next;
+    };
+    /**
+     * @brief tree : shortest path tree of a goal, from the cache (the trees are implicitly shared copies)
+     */
+    Tree tree(const Vector2D &goal) const;
+    static quint64 key(const Vector2D &p);
+    void buildGrid();
+    void buildIndex();
+    int cellX(float x) const { return qBound(0,int((x-gridOrigin.x)*invCellSize),gridSize-1); }
+    int cellY(float y) const { return qBound(0,int((y-gridOrigin.y)*invCellSize),gridSize-1); }
+
+    qreal clearance=0; ///< distance between the wall corners and the nodes
+    QVector<Wall> walls;
+    QVector<float> wallBoxes[4]; ///< xmin, ymin, xmax, ymax of the walls (contiguous scans)
+    // uniform grid of the walls, the walls of cell c are gridWalls[gridStart[c]..gridStart[c+1][
+    Vector2D gridOrigin;
+    float invCellSize=1;
+    int gridSize=0; ///< number of cells per row and column
+    QVector<int> gridStart;
+    QVector<int> gridWalls;
+    QVector<Vector2D> nodes;
+    QVector<QVector<QPair<int,qreal>>> adjacency; ///< (node,length) of the links of each node
+    QVector<QPair<int,int>> arcs; ///< links (i<j) in the order of arcIndex
+    RTree arcIndex; ///< boxes of the links, for the drawing
+    RTree nodeIndex; ///< positions of the nodes, for the drawing
+    mutable QHash<quint64,Tree> trees; ///< cache of the trees by goal
+    mutable QMutex treesMutex; ///< the graph is shared by the fleets of a map
+};
+
+#endif // NAVIGATIONGRAPH_H
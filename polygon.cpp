@@ -1,69 +1,52 @@
 #include "polygon.h"
 #include <QDebug>
 #include <QStack>
-
-bool polarComparison(Vector2D P1,Vector2D P2) {
-    double a1 = asin(P1.y/sqrt(P1.x*P1.x+P1.y*P1.y));
-    if (P1.x<0.0) a1=M_PI-a1;
-    double a2 = asin(P2.y/sqrt(P2.x*P2.x+P2.y*P2.y));
-    if (P2.x<0.0) a2=M_PI-a2;
-    return a1<a2;
-}
+#include <profiler.h>
+#include <scratchbuffer.h>
+#include <limits>
 
 Polygon::Polygon(QVector<Vector2D> &points) {
-    assert(points.size()>3);
-    auto p=points.begin();
-    auto pymin=points.begin();
+    assert(points.size()>=3);
+    QVector<Vector2D> sortedPoints(points);
+    auto p=sortedPoints.begin();
+    auto pymin=sortedPoints.begin();
 
-    // find point with minimal y and swap with first point
-    while (p!=points.end()) {
-        if (p->y<pymin->y) {
+    // find point with minimal y (minimal x for equal y) and swap with first point
+    while (p!=sortedPoints.end()) {
+        if (p->y<pymin->y || (p->y==pymin->y && p->x<pymin->x)) {
             pymin=p;
         }
         p++;
     }
     // swap
-    if (pymin!=points.begin()) std::iter_swap(points.begin(), pymin);
-
-    Vector2D origin(points.begin()->x,points.begin()->y);
-    // copy points in a set of points relative to points[0]
-    QVector<Vector2D> pointsRelative;
-    for (auto pOrig:points) {
-        pointsRelative.push_back(Vector2D(pOrig.x-origin.x,pOrig.y-origin.y));
-    }
-
-    // sorting point with angular criteria
-    std::sort(pointsRelative.begin()+1,
-              pointsRelative.end(),polarComparison);
+    if (pymin!=sortedPoints.begin()) std::iter_swap(sortedPoints.begin(), pymin);
 
-    QStack<Vector2D*> CHstack;
-    Vector2D *top_1,*top;
-    CHstack.push(&pointsRelative[0]);
-    CHstack.push(&pointsRelative[1]);
-    CHstack.push(&pointsRelative[2]);
+    // sorting points with angular criteria around the first one (exact orientation test),
+    // the nearest first for points in the same direction
+    const Vector2D origin=sortedPoints[0];
+    std::sort(sortedPoints.begin()+1,sortedPoints.end(),[&origin](const Vector2D &P1,const Vector2D &P2) {
+        double o=orient2d(origin.x,origin.y,P1.x,P1.y,P2.x,P2.y);
+        if (o!=0) return o>0;
+        return origin.distance2(P1)<origin.distance2(P2);
+    });
 
-    auto pi=pointsRelative.begin()+3;
-    while (pi!=pointsRelative.end()) {
-        top = CHstack.top();
-        CHstack.pop();
-        top_1 = CHstack.top();
-        CHstack.push(top);
-        while (!isOnTheLeft(&(*pi),top_1,top)) {
-            CHstack.pop();
-            // update values of top and top_1
-            top = CHstack.top();
+    // Graham scan, only strict left turns are kept (collinear points are not vertices of the hull)
+    QStack<const Vector2D*> CHstack;
+    CHstack.push(&sortedPoints[0]);
+    for (int i=1; i<sortedPoints.size(); i++) {
+        const Vector2D *pi=&sortedPoints[i];
+        while (CHstack.size()>=2) {
+            const Vector2D *top=CHstack.top();
+            const Vector2D *top_1=CHstack[CHstack.size()-2];
+            if (orient2d(top_1->x,top_1->y,top->x,top->y,pi->x,pi->y)>0) break;
             CHstack.pop();
-            top_1 = CHstack.top();
-            CHstack.push(top);
         }
-        CHstack.push(&(*pi));
-        pi++;
+        CHstack.push(pi);
     }
 
     // get stack points to create current polygon
-    while (!CHstack.empty()) {
-        tabPts.push_front(*(CHstack.top())+origin);
-        CHstack.pop();
+    for (auto pt:CHstack) {
+        tabPts.push_back(*pt);
     }
     tabPts.push_back(tabPts[0]);// polygon propriety (N+1 vertices with P_N=P_0)
     triangulate();
@@ -82,7 +65,6 @@ void Polygon::addVertex(float x, float y) {
     }
 }
 
-const float doorWidth=20.0;
 void Polygon::draw(QPainter &painter) const {
     if (tabPts.empty()) return;
 
@@ -90,17 +72,14 @@ void Polygon::draw(QPainter &painter) const {
     pen.setWidth(3);
     ///< use the drawPolygon method of QPainter
     auto N=tabPts.size();
-    QPoint *points=new QPoint[N];
+    ScratchBuffer<QPoint> points;
+    points->reserve(N);
     for (int i=0; i<N; i++) {
-        points[i].setX(tabPts[i].x);
-        points[i].setY(tabPts[i].y);
+        points->push_back(QPoint(tabPts[i].x,tabPts[i].y));
     }
     painter.setPen(pen);
 
-    painter.drawPolygon(points,N,Qt::OddEvenFill);
-    delete [] points;
-
-    // draw Doors
+    painter.drawPolygon(points->constData(),N,Qt::OddEvenFill);
 }
 
 QPair<Vector2D,Vector2D> Polygon::getBoundingBox() const {
@@ -115,142 +94,221 @@ QPair<Vector2D,Vector2D> Polygon::getBoundingBox() const {
 }
 
 void Polygon::triangulate() {
+    PROFILE_SCOPE("Polygon::triangulate");
     /// @todo write the code
     /// 1. Copy the poly polygon in a temporary version (tmp)
-    Polygon tmp(*this);
-    QList<Vector2D*> pointListPtr;
+    updateBox();
+    if (isConvex()) {
+        // fan from the first vertex (the flat triangles of collinear vertices are skipped)
+        int N=nbVertices();
+        triangles.reserve(triangles.size()+qMax(0,N-2));
+        for (int i=1; i+1<N; i++) {
+            if (orient2d(tabPts[0].x,tabPts[0].y,tabPts[i].x,tabPts[i].y,tabPts[i+1].x,tabPts[i+1].y)>0) {
+                triangles.push_back(Triangle(tabPts[0],tabPts[i],tabPts[i+1]));
+            }
+        }
+        packedTriangles.build(triangles);
+        return;
+    }
+    ///    (vertices without the duplicated last one, in a pooled buffer)
+    auto N=nbVertices();
+    ScratchBuffer<Vector2D> tmp;
+    tmp->reserve(N);
+    for (int j=0; j<N; j++) {
+        tmp->push_back(tabPts[j]);
+    }
+    triangles.reserve(triangles.size()+qMax(0,N-2));
 
     /// 2. search a first consecutive group of three vertices that check:
     /// - CCW oriented
     /// - does not contain any other vertex
     int i=0;
-    auto N=tmp.nbVertices();
-    while (N>=3) {
-        Triangle t(tmp[i%N],tmp[(i+1)%N],tmp[(i+2)%N]);
-        // fill the list (pointListPtr) with all the vertices of the polygon
-        // but the vertices of the triangle.
-        pointListPtr.clear();
-        for (int j=0; j<N; j++) {
+    int tested=0; ///< vertices tested since the last ear, no ear in a complete turn means that the polygon is not simple
+    while (N>=3 && tested<N) {
+        i=i%N;
+        const Vector2D A=(*tmp)[i],B=(*tmp)[(i+1)%N],C=(*tmp)[(i+2)%N];
+        if (orient2d(A.x,A.y,B.x,B.y,C.x,C.y)==0) {
+            // collinear vertices: the middle one is removed without triangle
+            tmp->remove((i+1)%N);
+            N--;
+            tested=0;
+            continue;
+        }
+        Triangle t(A,B,C);
+        // test all the vertices of the polygon but the vertices of the triangle
+        bool isEar=t.isCCW();
+        for (int j=0; j<N && isEar; j++) {
             if (j!=i && j!=(i+1)%N && j!=(i+2)%N) {
-                pointListPtr.push_back(&(tmp.tabPts[j]));
+                isEar=!t.contains((*tmp)[j]);
             }
         }
 
-        if (t.isCCW() && !t.containsOneOf(pointListPtr)) {
+        if (isEar) {
             /// 3. add the triangle in the list
             triangles.push_back(t);
             /// 4. remove middle vertex from the tmp polygon
-            tmp.remove((i+1)%N);
+            tmp->remove((i+1)%N);
             N--;
+            tested=0;
         } else {
             i=(i+1)%N;
+            tested++;
         }
     }
+    packedTriangles.build(triangles);
 }
 
-const float eps=1e-4;
-void Polygon::clip(int x0,int y0,int x1,int y1) {
-    // cut point out of the zone
-    int i;
-    for (int k=0; k<4; k++) {
-        // find a point outside
-        i=0;
-        int N=nbVertices();
-        while (i<N && tabPts[i].x>=x0 && tabPts[i].x<=x1 && tabPts[i].y>=y0 && tabPts[i].y<=y1) {
-            i++;
+void Polygon::prepare() {
+    convex=isConvex();
+    if (convex) {
+        updateBox();
+    } else {
+        triangulate();
+    }
+}
+
+void Polygon::updateBox() {
+    if (tabPts.isEmpty()) return;
+    auto box=getBoundingBox();
+    boxMin=box.first;
+    boxMax=box.second;
+}
+
+bool Polygon::convexContains(const Vector2D &pt) const {
+    // the vertices P1..PN-1 are sorted by angle around P0: binary search of the wedge P0,Pi,Pi+1 that contains pt
+    int N=nbVertices();
+    const Vector2D &O=tabPts[0];
+    if (orient2d(O.x,O.y,tabPts[1].x,tabPts[1].y,pt.x,pt.y)<0 ||
+        orient2d(O.x,O.y,tabPts[N-1].x,tabPts[N-1].y,pt.x,pt.y)>0) return false;
+    int lo=1,hi=N-1;
+    while (hi-lo>1) {
+        int mid=(lo+hi)/2;
+        if (orient2d(O.x,O.y,tabPts[mid].x,tabPts[mid].y,pt.x,pt.y)>=0) lo=mid;
+        else hi=mid;
+    }
+    return isOnTheLeft(pt,lo);
+}
+
+void PackedTriangles::build(const QVector<Triangle> &triangles) {
+    int nbBlocks=(triangles.size()+blockSize-1)/blockSize;
+    blocks.resize(nbBlocks);
+    for (int t=0; t<nbBlocks*blockSize; t++) {
+        Block &block=blocks[t/blockSize];
+        int k=t%blockSize;
+        for (int e=0; e<3; e++) {
+            if (t<triangles.size()) {
+                // orient2d(A,B,P)=(Bx-Ax)(Py-Ay)-(By-Ay)(Px-Ax)
+                const Vector2D A=triangles[t][e],B=triangles[t][(e+1)%3];
+                block.a[e][k]=double(A.y)-B.y;
+                block.b[e][k]=double(B.x)-A.x;
+                block.c[e][k]=double(A.x)*B.y-double(A.y)*B.x;
+            } else {
+                // padding, never contains a point
+                block.a[e][k]=0;
+                block.b[e][k]=0;
+                block.c[e][k]=-1;
+            }
+        }
+    }
+}
+
+int PackedTriangles::find(const Vector2D &p,const QVector<Triangle> &triangles) const {
+    const double x=p.x,y=p.y;
+    // bound of the rounding errors of a*x+b*y+c relative to |a*x|+|b*y|+|c|
+    const double errBound=16*predicatesEpsilon;
+    for (int i=0; i<blocks.size(); i++) {
+        const Block &block=blocks[i];
+        // sure inside if minLow>0, sure outside if minHigh<0 (branchless loop, vectorized)
+        double minLow[blockSize],minHigh[blockSize];
+        for (int k=0; k<blockSize; k++) {
+            double low=std::numeric_limits<double>::max(),high=low;
+            for (int e=0; e<3; e++) {
+                double ax=block.a[e][k]*x,by=block.b[e][k]*y,c=block.c[e][k];
+                double value=ax+by+c;
+                double err=errBound*(fabs(ax)+fabs(by)+fabs(c));
+                low=std::min(low,value-err);
+                high=std::min(high,value+err);
+            }
+            minLow[k]=low;
+            minHigh[k]=high;
         }
-        if (i!=N) {
-            Vector2D P[2];
-            int i_1=(i==0)?N:i-1;
-            if (tabPts[i].y>y1) {
-                int n=0;
-                if (tabPts[i_1].y<y1) {
-                    P[n++].set(tabPts[i_1].x+(tabPts[i].x-tabPts[i_1].x)*((y1-tabPts[i_1].y)/(tabPts[i].y-tabPts[i_1].y)),y1);
-                }
-                if (tabPts[i+1].y<y1) {
-                    P[n++].set(tabPts[i].x+(tabPts[i+1].x-tabPts[i].x)*((y1-tabPts[i].y)/(tabPts[i+1].y-tabPts[i].y)),y1);
-                }
-                if (n==2) insertPoint(P[1],i+1);
-                if (n>0) {
-                    tabPts[i]=P[0];
-                    if (i==0) tabPts[N]=P[0];
-                }
-            } else if (tabPts[i].y<y0) {
-                int n=0;
-                if (tabPts[i_1].y>y0) {
-                    P[n++].set(tabPts[i_1].x+(tabPts[i].x-tabPts[i_1].x)*((y0-tabPts[i_1].y)/(tabPts[i].y-tabPts[i_1].y)),y0);
-                }
-                if (tabPts[i+1].y>y0) {
-                    P[n++].set(tabPts[i].x+(tabPts[i+1].x-tabPts[i].x)*((y0-tabPts[i].y)/(tabPts[i+1].y-tabPts[i].y)),y0);
-                }
-                if (n==2) insertPoint(P[1],i+1);
-                if (n>0) {
-                    tabPts[i]=P[0];
-                    if (i==0) tabPts[N]=P[0];
-                }
-            } else if (tabPts[i].x>x1) {
-                int n=0;
-                if (tabPts[i_1].x<x1) {
-                    P[n++].set(x1,tabPts[i_1].y+(tabPts[i].y-tabPts[i_1].y)*((x1-tabPts[i_1].x)/(tabPts[i].x-tabPts[i_1].x)));
-                }
-                if (tabPts[i+1].x<x1) {
-                    P[n++].set(x1,tabPts[i].y+(tabPts[i+1].y-tabPts[i].y)*((x1-tabPts[i].x)/(tabPts[i+1].x-tabPts[i].x)));
-                }
-                if (n==2) insertPoint(P[1],i+1);
-                if (n>0) {
-                    tabPts[i]=P[0];
-                    if (i==0) tabPts[N]=P[0];
-                }
-            } else if (tabPts[i].x<x0) {
-                int n=0;
-                if (tabPts[i_1].x>x0) {
-                    P[n++].set(x0,tabPts[i_1].y+(tabPts[i].y-tabPts[i_1].y)*((x0-tabPts[i_1].x)/(tabPts[i].x-tabPts[i_1].x)));
-                }
-                if (tabPts[i+1].x>x0) {
-                    P[n++].set(x0,tabPts[i].y+(tabPts[i+1].y-tabPts[i].y)*((x0-tabPts[i].x)/(tabPts[i+1].x-tabPts[i].x)));
-                }
-                if (n==2) insertPoint(P[1],i+1);
-                if (n>0) {
-                    tabPts[i]=P[0];
-                    if (i==0) tabPts[N]=P[0];
-                }
+        for (int k=0; k<blockSize; k++) {
+            if (minLow[k]>0) return i*blockSize+k;
+            if (minHigh[k]>=0) {
+                // p is on or very close to an edge: exact test
+                int t=i*blockSize+k;
+                if (t<triangles.size() && triangles[t].contains(p)) return t;
             }
         }
     }
+    return -1;
+}
 
+void Polygon::clipHalfPlane(double a,double b,double c) {
+    ScratchBuffer<Vector2D> buffer;
+    clipHalfPlane(a,b,c,*buffer);
+}
 
-    i=0;
-    while (i<nbVertices()) {
-        // case Left/Bottom
-        if (fabs(tabPts[i].x-x0)<eps && fabs(tabPts[i+1].y-y0)<eps) {
-            insertPoint(Vector2D(x0,y0),i+1);
-            i++;
-        } else // case Bottom/Right
-        if (fabs(tabPts[i].y-y0)<eps && fabs(tabPts[i+1].x-x1)<eps) {
-            insertPoint(Vector2D(x1,y0),i+1);
-            i++;
-        } else // case Right/Top
-        if (fabs(tabPts[i].x-x1)<eps && fabs(tabPts[i+1].y-y1)<eps) {
-            insertPoint(Vector2D(x1,y1),i+1);
-            i++;
-        } else // case Top/Left
-        if (fabs(tabPts[i].y-y1)<eps && fabs(tabPts[i+1].x-x0)<eps) {
-            insertPoint(Vector2D(x0,y1),i+1);
-            i++;
+void Polygon::clipHalfPlane(double a,double b,double c,QVector<Vector2D> &out) {
+    int N=nbVertices();
+    if (N==0) return;
+    // the output is written in out, swapped with tabPts at the end
+    out.clear();
+    out.reserve(N+2);
+    // Sutherland-Hodgman pass: keep the inside vertices and the intersections of the crossing edges
+    double vP=a*tabPts[0].x+b*tabPts[0].y+c;
+    for (int i=0; i<N; i++) {
+        const Vector2D &P=tabPts[i],&Q=tabPts[i+1];
+        double vQ=a*Q.x+b*Q.y+c;
+        if (vP>=0) out.push_back(P);
+        if ((vP>0 && vQ<0) || (vP<0 && vQ>0)) {
+            double t=vP/(vP-vQ);
+            Vector2D I(P.x+t*(Q.x-P.x),P.y+t*(Q.y-P.y));
+            // exact coordinate on the axis-aligned lines
+            if (b==0) I.x=-c/a;
+            else if (a==0) I.y=-c/b;
+            out.push_back(I);
         }
-        i++;
+        vP=vQ;
     }
+    if (out.size()<3) {
+        tabPts.clear();
+        return;
+    }
+    out.push_back(out[0]); // polygon propriety (N+1 vertices with P_N=P_0)
+    tabPts.swap(out);
 }
 
-void Triangle::computeCircle() {
-    Vector2D AB = tabPts[1]-tabPts[0];
-    Vector2D AC=tabPts[2]-tabPts[0];
-    //OBprim = OA+0.5 AC
-    Vector2D OBprim = tabPts[0] + 0.5*AC;
-    Vector2D VAC = AC.orthoNormed();
+void Polygon::clip(int x0,int y0,int x1,int y1) {
+    ScratchBuffer<Vector2D> buffer;
+    clipHalfPlane(1,0,-x0,*buffer); // x>=x0
+    clipHalfPlane(-1,0,x1,*buffer); // x<=x1
+    clipHalfPlane(0,1,-y0,*buffer); // y>=y0
+    clipHalfPlane(0,-1,y1,*buffer); // y<=y1
+}
 
-    double k=(AB*AB - AC*AB)/(2* (VAC*AB));
+void Polygon::clip(const Polygon &window) {
+    ScratchBuffer<Vector2D> buffer;
+    for (int i=0; i<window.nbVertices(); i++) {
+        // left side of the edge AB: orient2d(A,B,P)>=0
+        const Vector2D &A=window.tabPts[i],&B=window.tabPts[i+1];
+        clipHalfPlane(double(A.y)-B.y,double(B.x)-A.x,double(A.x)*B.y-double(A.y)*B.x,*buffer);
+    }
+}
 
-    circumCenter = OBprim+ k * VAC;
-    circumRadius = (circumCenter-tabPts[0]).length();
+void Polygon::removeCloseVertices(float minDistance) {
+    int N=nbVertices();
+    if (N==0) return;
+    float d2=minDistance*minDistance;
+    int n=1;
+    for (int i=1; i<N; i++) {
+        if (tabPts[i].distance2(tabPts[n-1])>=d2) tabPts[n++]=tabPts[i];
+    }
+    while (n>1 && tabPts[n-1].distance2(tabPts[0])<d2) n--;
+    if (n<3) {
+        tabPts.clear();
+        return;
+    }
+    tabPts.resize(n);
+    tabPts.push_back(tabPts[0]);
 }
@@ -7,7 +7,7 @@
 #ifndef POLYGON_H
 #define POLYGON_H
 #include "vector2d.h"
-#include <determinant.h>
+#include <predicates.h>
 #include <QPainter>
 #include <QDebug>
 
@@ -16,11 +16,7 @@
  * It is used by the Polygon class to create a set of internal triangles.
  */
 class Triangle {
-    Vector2D tabPts[3]; ///< array of 3 pointers to vertices
-    bool isDelaunay=false; ///< is drawn as Delaunay triangle
-    bool isFlippable=false; ///< is drawn as Delaunay but not flippable triangle
-    Vector2D circumCenter; ///< the center of the triangle (by computeCenter)
-    float circumRadius; ///< the radius of the circumCircle (by computeCenter)
+    Vector2D tabPts[3]; ///< array of 3 vertices
 public:
     /**
      * @brief Constuctor of triangle with pointers to vertices,
@@ -33,15 +29,12 @@ public:
         tabPts[0]=p_p0;
         tabPts[1]=p_p1;
         tabPts[2]=p_p2;
-        computeCircle();
     }
     void update(const Vector2D &p_p0,const Vector2D &p_p1,const Vector2D &p_p2) {
         tabPts[0]=p_p0;
         tabPts[1]=p_p1;
         tabPts[2]=p_p2;
-        computeCircle();
     }
-    void computeCircle();
     /**
      * @brief operator [] to get vertex #i coordinates
      * @param i
@@ -53,11 +46,8 @@ public:
      * is on the left of the first edge
      * @return true if the triangle is Counterclock Wise oriented
      */
-    bool isCCW() {
-        Vector2D AB = (tabPts[1])-(tabPts[0]);
-        Vector2D AP = (tabPts[2])-(tabPts[0]);
-        // z component of AB x AP
-        return (AB.x*AP.y-AB.y*AP.x)>0;
+    bool isCCW() const {
+        return orient2d(tabPts[0].x,tabPts[0].y,tabPts[1].x,tabPts[1].y,tabPts[2].x,tabPts[2].y)>0;
     }
     /**
      * @brief contains
@@ -84,10 +74,8 @@ public:
      * @return true if p is on the left of the edge P_iP_{i+1}
      */
     bool isOnTheLeft(const Vector2D &p, int i) const {
-        Vector2D AB = (tabPts[(i+1)%3])-(tabPts[i]);
-        Vector2D AP = p-(tabPts[i]);
-        // z component of AB x AP
-        return (AB.x*AP.y-AB.y*AP.x)>=0;
+        const Vector2D &A=tabPts[i],&B=tabPts[(i+1)%3];
+        return orient2d(A.x,A.y,B.x,B.y,p.x,p.y)>=0;
     }
     void print() {
         qDebug() << tabPts[0].x << "," << tabPts[0].y << "/"
@@ -104,23 +92,6 @@ public:
         Vector2D AC=(tabPts[2])-(tabPts[0]);
         return 0.005*(AB.x*AC.y-AB.y*AC.x); // convertion to u² unit
     }
-
-    inline void setDelaunay(bool d, bool f) {
-        isDelaunay=d;
-        isFlippable=f;
-    }
-    bool canBeFlipped() {
-        return (!isDelaunay && isFlippable);
-    }
-    bool checkDelaunay(const QVector<Vector2D> &tabVertices) {
-        auto it=tabVertices.begin();
-        while (it!=tabVertices.end() && circleContains(*it)) {
-            it++;
-        }
-        isDelaunay = it==tabVertices.end();
-        isFlippable=false;
-        return isDelaunay;
-    }
     Vector2D getNextVertex(const Vector2D &pt) const {
         if (pt==tabPts[0]) return tabPts[1];
         if (pt==tabPts[1]) return tabPts[2];
@@ -147,24 +118,9 @@ public:
                (tabPts[1]==other.tabPts[0] || tabPts[1]==other.tabPts[1] || tabPts[1]==other.tabPts[2]) &&
                (tabPts[2]==other.tabPts[0] || tabPts[2]==other.tabPts[1] || tabPts[2]==other.tabPts[2]);
     }
-    bool circleContains(const Vector2D&M) {
-        Matrix33 mat;
-        Vector2D A = tabPts[0];
-        Vector2D B = tabPts[1];
-        Vector2D C = tabPts[2];
-        mat.m[0][0] = (A.x - M.x);
-        mat.m[0][1] = (A.y - M.y);
-        mat.m[0][2] = (A.x*A.x-M.x*M.x)+(A.y*A.y-M.y*M.y);
-        mat.m[1][0] = (B.x - M.x);
-        mat.m[1][1] = (B.y - M.y);
-        mat.m[1][2] = (B.x*B.x-M.x*M.x)+(B.y*B.y-M.y*M.y);
-        mat.m[2][0] = (C.x - M.x);
-        mat.m[2][1] = (C.y - M.y);
-        mat.m[2][2] = (C.x*C.x-M.x*M.x)+(C.y*C.y-M.y*M.y);
-        return mat.determinant()<=0; // positive for outside points and equal for A,B,C
-    }
-    Vector2D getCenter() const {
-        return circumCenter;
+    bool circleContains(const Vector2D&M) const {
+        // negative for outside points and equal to 0 for A,B,C
+        return incircle(tabPts[0].x,tabPts[0].y,tabPts[1].x,tabPts[1].y,tabPts[2].x,tabPts[2].y,M.x,M.y)<=0;
     }
     Vector2D getEdgeTo(const Vector2D &p) const {
         if (tabPts[0]==p) return tabPts[2];
@@ -196,6 +152,29 @@ public:
 
 };
 
+/**
+ * @brief The PackedTriangles class stores the edge functions E(P)=a*x+b*y+c of a list of triangles,
+ * E is orient2d of the edge and P (positive on the left). The coefficients are stored by blocks of
+ * 8 triangles (structure of arrays) to test a point against the 8 triangles of a block at once.
+ */
+class PackedTriangles {
+public:
+    static const int blockSize=8;
+    void build(const QVector<Triangle> &triangles);
+    /**
+     * @brief find
+     * @param p tested point
+     * @param triangles the list given to build (exact test when p is too close to an edge)
+     * @return the index of the first triangle that contains p, -1 if none
+     */
+    int find(const Vector2D &p,const QVector<Triangle> &triangles) const;
+private:
+    struct Block {
+        double a[3][blockSize],b[3][blockSize],c[3][blockSize]; ///< [edge][triangle]
+    };
+    QVector<Block> blocks;
+};
+
 /**
  *  @brief Polygon class allow to create, draw and manipulate
  *  polygons, especially check if a point is inside and compute
@@ -206,6 +185,11 @@ private:
     ///< @warning Store N+1 vertices in tabPts array, first is duplicated in last.
     QVector<Vector2D> tabPts; ///< array of vertex positions
     QVector<Triangle> triangles; ///< array of triangles for the triangulation process
+    PackedTriangles packedTriangles; ///< edge functions of the triangles, for contains()
+    bool convex=false; ///< contains() uses a binary search in the vertices (set by prepare())
+    Vector2D boxMin{0,0},boxMax{-1,-1}; ///< bounding box for contains()
+    void updateBox();
+    bool convexContains(const Vector2D &pt) const;
 public:
     /**
      * @brief Constructor of a polygon.
@@ -223,6 +207,10 @@ public:
      * @return the number of vertices of the polygon
      */
     int nbVertices() const { return tabPts.size()==0?0:tabPts.size()-1; }
+    /**
+     * @brief reserve : allocate the memory for n vertices
+     */
+    void reserve(int n) { tabPts.reserve(n+1); }
     /**
      * @brief Add a new vertex at the end of the list
      * @warning The number of vertices added to the polygon must be lower than Nmax.
@@ -260,6 +248,11 @@ public:
      * @brief triangulate the polygon and store triangles in "triangles" array.
      */
     void triangulate();
+    /**
+     * @brief prepare the polygon for contains(): a convex polygon keeps only its vertices
+     * (O(log n) test, no triangles), the others are triangulated.
+     */
+    void prepare();
 
     /**
      * @brief isOnTheLeft
@@ -268,10 +261,8 @@ public:
      * @return true if p is on the left of the edge P_iP_{i+1}
      */
     bool isOnTheLeft(const Vector2D &p, int i) const {
-        Vector2D AB = tabPts[i+1]-tabPts[i];
-        Vector2D AP = p-tabPts[i];
-        // z component of AB x AP
-        return (AB.x*AP.y-AB.y*AP.x)>=0;
+        const Vector2D &A=tabPts[i],&B=tabPts[i+1];
+        return orient2d(A.x,A.y,B.x,B.y,p.x,p.y)>=0;
     }
     /**
      * @brief isOnTheLeft
@@ -281,8 +272,7 @@ public:
      * @return true if Ap is on the left of [AB]
      */
     bool isOnTheLeft(const Vector2D *p,const Vector2D *A,const Vector2D *B) {
-        Vector2D AB = *B-*A,AP = *p-*A;
-        return (AB.x*AP.y - AB.y*AP.x)>=0;
+        return orient2d(A->x,A->y,B->x,B->y,p->x,p->y)>=0;
     }
     /**
      * @brief isConvex
@@ -308,28 +298,48 @@ public:
         return triangles;
     }
     /**
-     * @brief area
+     * @brief area (shoelace formula, the polygon does not need to be triangulated)
+     * @warning the area is in u square. (u=10 pixels).
      * @return the surface of a polygon
      */
     double area() const {
-        /// @todo write the code
         double res=0;
-        for (auto &t:triangles) {
-                res+=t.area();
+        for (int i=0; i<nbVertices(); i++) {
+            res+=double(tabPts[i].x)*tabPts[i+1].y-double(tabPts[i+1].x)*tabPts[i].y;
         }
-        return res;
+        return 0.005*res; // convertion to u² unit
     }
+    /**
+     * @brief clip : keep the part of the polygon inside the box [x0,x1]x[y0,y1]
+     */
     void clip(int x0,int y0,int x1,int y1);
+    /**
+     * @brief clip : keep the part of the polygon inside the convex polygon window (CCW)
+     */
+    void clip(const Polygon &window);
+    /**
+     * @brief clipHalfPlane : keep the part of the polygon where a*x+b*y+c>=0, in linear time
+     * (one Sutherland-Hodgman pass in a reused buffer).
+     * @warning the result of a non-convex polygon may have overlapping edges, an empty polygon has no vertex.
+     */
+    void clipHalfPlane(double a,double b,double c);
+    /**
+     * @brief clipHalfPlane : same with a working array given by the caller (successive clippings)
+     * @param out buffer swapped with the vertex array, its previous content is lost
+     */
+    void clipHalfPlane(double a,double b,double c,QVector<Vector2D> &out);
+    /**
+     * @brief removeCloseVertices : remove the vertices at less than minDistance of the previous one
+     * (tiny edges of the clipping at a degenerated vertex).
+     */
+    void removeCloseVertices(float minDistance);
     void insertPoint(const Vector2D &p,int index) {
         tabPts.insert(index,p);
         tabPts[tabPts.size()-1]=tabPts[0];
     }
-    bool contains(const Vector2D& pt) {
-        auto t = triangles.begin();
-        while (t!=triangles.end() && !t->contains(pt)) {
-            t++;
-        }
-        return t!=triangles.end();
+    bool contains(const Vector2D& pt) const {
+        if (pt.x<boxMin.x || pt.x>boxMax.x || pt.y<boxMin.y || pt.y>boxMax.y) return false;
+        return convex?convexContains(pt):packedTriangles.find(pt,triangles)!=-1;
     }
 };
 
@@ -0,0 +1,195 @@
+#include "predicates.h"
+#include <QVarLengthArray>
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+/**
+ * An expansion is a sum of doubles, nonoverlapping and sorted by increasing magnitude:
+ * its sign is the sign of its last component.
+ * The components are zero-eliminated, expansions are short and stay on the stack.
+ */
+typedef QVarLengthArray<double,32> Expansion;
+
+/**
+ * @brief twoSum : x+y=a+b exactly, x=fl(a+b)
+ */
+inline void twoSum(double a,double b,double &x,double &y) {
+    x=a+b;
+    double bVirtual=x-a;
+    double aVirtual=x-bVirtual;
+    y=(a-aVirtual)+(b-bVirtual);
+}
+
+/**
+ * @brief twoProduct : x+y=a*b exactly, x=fl(a*b)
+ */
+inline void twoProduct(double a,double b,double &x,double &y) {
+    x=a*b;
+    y=std::fma(a,b,-x);
+}
+
+Expansion fromPair(double hi,double lo) {
+    Expansion e;
+    if (lo!=0) e.push_back(lo);
+    if (hi!=0 || e.isEmpty()) e.push_back(hi);
+    return e;
+}
+
+Expansion difference(double a,double b) {
+    double x,y;
+    twoSum(a,-b,x,y);
+    return fromPair(x,y);
+}
+
+/**
+ * @brief grow : e+b (Shewchuk's grow_expansion_zeroelim)
+ */
+Expansion grow(const Expansion &e,double b) {
+    Expansion h;
+    double q=b,hh;
+    for (double ei:e) {
+        twoSum(q,ei,q,hh);
+        if (hh!=0) h.push_back(hh);
+    }
+    if (q!=0 || h.isEmpty()) h.push_back(q);
+    return h;
+}
+
+Expansion sum(const Expansion &e,const Expansion &f) {
+    Expansion h=e;
+    for (double fi:f) h=grow(h,fi);
+    return h;
+}
+
+Expansion negate(Expansion e) {
+    for (auto &v:e) v=-v;
+    return e;
+}
+
+/**
+ * @brief scale : e*b (Shewchuk's scale_expansion_zeroelim)
+ */
+Expansion scale(const Expansion &e,double b) {
+    Expansion h;
+    double q,hh,product1,product0,s;
+    twoProduct(e[0],b,q,hh);
+    if (hh!=0) h.push_back(hh);
+    for (int i=1; i<e.size(); i++) {
+        twoProduct(e[i],b,product1,product0);
+        twoSum(q,product0,s,hh);
+        if (hh!=0) h.push_back(hh);
+        twoSum(product1,s,q,hh);
+        if (hh!=0) h.push_back(hh);
+    }
+    if (q!=0 || h.isEmpty()) h.push_back(q);
+    return h;
+}
+
+Expansion product(const Expansion &e,const Expansion &f) {
+    Expansion h={0};
+    for (double fi:f) h=sum(h,scale(e,fi));
+    return h;
+}
+}
+
+double orient2dExact(double ax,double ay,double bx,double by,double cx,double cy) {
+    // (ax*by-ay*bx)+(bx*cy-by*cx)+(cx*ay-cy*ax), each product is exact as a pair of doubles
+    const double terms[6][2]={{ax,by},{bx,cy},{cx,ay},{-ay,bx},{-by,cx},{-cy,ax}};
+    Expansion det={0};
+    for (auto &t:terms) {
+        double x,y;
+        twoProduct(t[0],t[1],x,y);
+        det=grow(grow(det,y),x);
+    }
+    return det.last();
+}
+
+double incircleExact(double ax,double ay,double bx,double by,double cx,double cy,double dx,double dy) {
+    // frequent in the meshes: D is a vertex of the triangle
+    if ((dx==ax && dy==ay) || (dx==bx && dy==by) || (dx==cx && dy==cy)) return 0;
+    Expansion adx=difference(ax,dx),ady=difference(ay,dy);
+    Expansion bdx=difference(bx,dx),bdy=difference(by,dy);
+    Expansion cdx=difference(cx,dx),cdy=difference(cy,dy);
+
+    Expansion bc=sum(product(bdx,cdy),negate(product(cdx,bdy)));
+    Expansion ca=sum(product(cdx,ady),negate(product(adx,cdy)));
+    Expansion ab=sum(product(adx,bdy),negate(product(bdx,ady)));
+    Expansion aLift=sum(product(adx,adx),product(ady,ady));
+    Expansion bLift=sum(product(bdx,bdx),product(bdy,bdy));
+    Expansion cLift=sum(product(cdx,cdx),product(cdy,cdy));
+
+    Expansion det=sum(sum(product(aLift,bc),product(bLift,ca)),product(cLift,ab));
+    return det.last();
+}
+
+int firstInsideCircle(double ax,double ay,double bx,double by,double cx,double cy,
+                      const double *px,const double *py,int n) {
+    int i=0;
+#if defined(__AVX__) || defined(__SSE2__)
+#if defined(__AVX__)
+    // 4 points per iteration
+    typedef __m256d Lanes;
+    const int width=4;
+    auto set1=[](double v) { return _mm256_set1_pd(v); };
+    auto load=[](const double *p) { return _mm256_loadu_pd(p); };
+    auto add=[](Lanes a,Lanes b) { return _mm256_add_pd(a,b); };
+    auto sub=[](Lanes a,Lanes b) { return _mm256_sub_pd(a,b); };
+    auto mul=[](Lanes a,Lanes b) { return _mm256_mul_pd(a,b); };
+    auto abs=[](Lanes a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0),a); };
+    auto greater=[](Lanes a,Lanes b) { return _mm256_movemask_pd(_mm256_cmp_pd(a,b,_CMP_GT_OQ)); };
+#else
+    // 2 points per iteration
+    typedef __m128d Lanes;
+    const int width=2;
+    auto set1=[](double v) { return _mm_set1_pd(v); };
+    auto load=[](const double *p) { return _mm_loadu_pd(p); };
+    auto add=[](Lanes a,Lanes b) { return _mm_add_pd(a,b); };
+    auto sub=[](Lanes a,Lanes b) { return _mm_sub_pd(a,b); };
+    auto mul=[](Lanes a,Lanes b) { return _mm_mul_pd(a,b); };
+    auto abs=[](Lanes a) { return _mm_andnot_pd(_mm_set1_pd(-0.0),a); };
+    auto greater=[](Lanes a,Lanes b) { return _mm_movemask_pd(_mm_cmpgt_pd(a,b)); };
+#endif
+    // same operations as incircle(), lane by lane
+    const Lanes vax=set1(ax),vay=set1(ay);
+    const Lanes vbx=set1(bx),vby=set1(by);
+    const Lanes vcx=set1(cx),vcy=set1(cy);
+    const Lanes errBound=set1(incircleErrBound);
+    const Lanes zero=set1(0);
+    for (; i+width<=n; i+=width) {
+        Lanes dx=load(px+i),dy=load(py+i);
+        Lanes adx=sub(vax,dx),ady=sub(vay,dy);
+        Lanes bdx=sub(vbx,dx),bdy=sub(vby,dy);
+        Lanes cdx=sub(vcx,dx),cdy=sub(vcy,dy);
+        Lanes bdxcdy=mul(bdx,cdy),cdxbdy=mul(cdx,bdy);
+        Lanes aLift=add(mul(adx,adx),mul(ady,ady));
+        Lanes cdxady=mul(cdx,ady),adxcdy=mul(adx,cdy);
+        Lanes bLift=add(mul(bdx,bdx),mul(bdy,bdy));
+        Lanes adxbdy=mul(adx,bdy),bdxady=mul(bdx,ady);
+        Lanes cLift=add(mul(cdx,cdx),mul(cdy,cdy));
+        Lanes det=add(add(mul(aLift,sub(bdxcdy,cdxbdy)),mul(bLift,sub(cdxady,adxcdy))),mul(cLift,sub(adxbdy,bdxady)));
+        Lanes permanent=add(add(mul(add(abs(bdxcdy),abs(cdxbdy)),aLift),
+                                mul(add(abs(cdxady),abs(adxcdy)),bLift)),
+                            mul(add(abs(adxbdy),abs(bdxady)),cLift));
+        Lanes err=mul(errBound,permanent);
+        int inside=greater(det,err);
+        int outside=greater(sub(zero,det),err);
+        int allLanes=(1<<width)-1;
+        if ((inside|outside)!=allLanes) {
+            // uncertain sign for some lanes: scalar (exact) test of the group
+            for (int k=i; k<i+width; k++) {
+                if (incircle(ax,ay,bx,by,cx,cy,px[k],py[k])>0) return k;
+            }
+        } else if (inside) {
+            int k=0;
+            while (!(inside&(1<<k))) k++;
+            return i+k;
+        }
+    }
+#endif
+    for (; i<n; i++) {
+        if (incircle(ax,ay,bx,by,cx,cy,px[i],py[i])>0) return i;
+    }
+    return n;
+}
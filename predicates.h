@@ -0,0 +1,79 @@
+#ifndef PREDICATES_H
+#define PREDICATES_H
+
+#include <cmath>
+
+/**
+ * Robust geometric predicates (Shewchuk, "Adaptive Precision Floating-Point Arithmetic
+ * and Fast Robust Geometric Predicates"). The determinant is first evaluated in double
+ * with an error bound, the exact evaluation with expansions is only done when the sign
+ * of the result is not certain (nearly collinear or cocircular points).
+ * The returned value is an approximation of the determinant with the exact sign.
+ */
+
+const double predicatesEpsilon=1.1102230246251565e-16; ///< 2^-53
+const double orient2dErrBound=(3.0+16.0*predicatesEpsilon)*predicatesEpsilon;
+const double incircleErrBound=(10.0+96.0*predicatesEpsilon)*predicatesEpsilon;
+
+double orient2dExact(double ax,double ay,double bx,double by,double cx,double cy);
+double incircleExact(double ax,double ay,double bx,double by,double cx,double cy,double dx,double dy);
+
+/**
+ * @brief orient2d
+ * @return positive if A,B,C are CCW, negative if CW and 0 if collinear
+ */
+inline double orient2d(double ax,double ay,double bx,double by,double cx,double cy) {
+    double detLeft=(ax-cx)*(by-cy);
+    double detRight=(ay-cy)*(bx-cx);
+    double det=detLeft-detRight;
+    double detSum;
+    if (detLeft>0) {
+        if (detRight<=0) return det;
+        detSum=detLeft+detRight;
+    } else if (detLeft<0) {
+        if (detRight>=0) return det;
+        detSum=-detLeft-detRight;
+    } else {
+        return det;
+    }
+    double errBound=orient2dErrBound*detSum;
+    if (det>=errBound || -det>=errBound) return det;
+    return orient2dExact(ax,ay,bx,by,cx,cy);
+}
+
+/**
+ * @brief incircle
+ * @return positive if D is inside the circumcircle of the CCW triangle A,B,C, negative outside and 0 if cocircular
+ */
+inline double incircle(double ax,double ay,double bx,double by,double cx,double cy,double dx,double dy) {
+    double adx=ax-dx,ady=ay-dy;
+    double bdx=bx-dx,bdy=by-dy;
+    double cdx=cx-dx,cdy=cy-dy;
+
+    double bdxcdy=bdx*cdy,cdxbdy=cdx*bdy;
+    double aLift=adx*adx+ady*ady;
+    double cdxady=cdx*ady,adxcdy=adx*cdy;
+    double bLift=bdx*bdx+bdy*bdy;
+    double adxbdy=adx*bdy,bdxady=bdx*ady;
+    double cLift=cdx*cdx+cdy*cdy;
+
+    double det=aLift*(bdxcdy-cdxbdy)+bLift*(cdxady-adxcdy)+cLift*(adxbdy-bdxady);
+    double permanent=(fabs(bdxcdy)+fabs(cdxbdy))*aLift
+                     +(fabs(cdxady)+fabs(adxcdy))*bLift
+                     +(fabs(adxbdy)+fabs(bdxady))*cLift;
+    double errBound=incircleErrBound*permanent;
+    if (det>errBound || -det>errBound) return det;
+    return incircleExact(ax,ay,bx,by,cx,cy,dx,dy);
+}
+
+/**
+ * @brief firstInsideCircle : batched in-circle test of one triangle against n points
+ * (SIMD when available, exact test for the lanes where the filter fails)
+ * @param px abscissas of the points
+ * @param py ordinates of the points
+ * @return the index of the first point strictly inside the circumcircle of the CCW triangle A,B,C, n if none
+ */
+int firstInsideCircle(double ax,double ay,double bx,double by,double cx,double cy,
+                      const double *px,const double *py,int n);
+
+#endif // PREDICATES_H
@@ -0,0 +1,113 @@
+#include "profiler.h"
+
+#ifdef DRONES_PROFILING
+
+#include <QFile>
+#include <QMap>
+#include <chrono>
+
+namespace {
+const std::chrono::steady_clock::time_point profilerEpoch=std::chrono::steady_clock::now();
+}
+
+Profiler& Profiler::instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+qint64 Profiler::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-profilerEpoch).count();
+}
+
+Profiler::~Profiler() {
+    for (auto b:buffers) {
+        delete b;
+    }
+}
+
+ProfileBuffer* Profiler::threadBuffer() {
+    thread_local ProfileBuffer *buffer=nullptr;
+    if (buffer==nullptr) {
+        buffer=new ProfileBuffer;
+        QMutexLocker lock(&mutex);
+        buffers.push_back(buffer);
+        buffer->threadIndex=buffers.size();
+    }
+    return buffer;
+}
+
+QVector<QPair<int,ProfileEvent>> Profiler::snapshot() const {
+    QVector<QPair<int,ProfileEvent>> res;
+    QMutexLocker lock(&mutex);
+    for (auto b:buffers) {
+        quint64 h=b->head.load(std::memory_order_acquire);
+        quint64 first=h>quint64(ProfileBuffer::size)?h-ProfileBuffer::size:0;
+        int start=res.size();
+        for (quint64 i=first; i<h; i++) {
+            res.push_back({b->threadIndex,b->events[i&(ProfileBuffer::size-1)]});
+        }
+        // the owner may have written events during the copy: the event newHead may be half written
+        // in the slot of newHead-size, the events up to newHead-size are dropped
+        std::atomic_thread_fence(std::memory_order_acquire);
+        quint64 newHead=b->head.load(std::memory_order_relaxed);
+        quint64 valid=newHead>=quint64(ProfileBuffer::size)?newHead-ProfileBuffer::size+1:0;
+        if (valid>first) res.remove(start,int(qMin(valid,h)-first));
+    }
+    return res;
+}
+
+QVector<StageTiming> Profiler::stageTimings(qint64 period) const {
+    qint64 from=now()-period;
+    QMap<QString,StageTiming> stages;
+    QMap<QString,qint64> lastEnd;
+    for (auto &e:snapshot()) {
+        QString name(e.second.name);
+        qreal ms=(e.second.end-e.second.start)*1e-6;
+        auto &st=stages[name];
+        st.name=name;
+        if (e.second.end>=lastEnd.value(name,-1)) {
+            st.lastMs=ms;
+            lastEnd[name]=e.second.end;
+        }
+        if (e.second.end>=from) {
+            st.meanMs+=ms;
+            st.count++;
+        }
+    }
+    QVector<StageTiming> res;
+    for (auto &st:stages) {
+        if (st.count>0) st.meanMs/=st.count;
+        res.push_back(st);
+    }
+    return res;
+}
+
+qreal Profiler::fps() const {
+    qint64 from=now()-1000000000;
+    int n=0;
+    for (auto &e:snapshot()) {
+        if (e.second.end>=from && qstrcmp(e.second.name,"Canvas::paintEvent")==0) n++;
+    }
+    return n;
+}
+
+bool Profiler::exportChromeTrace(const QString &fileName) const {
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    // complete events ("ph":"X"), times in µs
+    QByteArray json="{\"traceEvents\":[\n";
+    bool first=true;
+    for (auto &e:snapshot()) {
+        if (!first) json+=",\n";
+        first=false;
+        json+="{\"name\":\""+QByteArray(e.second.name)+"\",\"ph\":\"X\",\"pid\":1,\"tid\":"+QByteArray::number(e.first)
+              +",\"ts\":"+QByteArray::number(e.second.start/1000.0,'f',3)
+              +",\"dur\":"+QByteArray::number((e.second.end-e.second.start)/1000.0,'f',3)+"}";
+    }
+    json+="\n],\"displayTimeUnit\":\"ms\"}\n";
+    return file.write(json)==json.size();
+}
+
+#endif // DRONES_PROFILING
@@ -0,0 +1,106 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+/**
+ * Per-stage timers, enabled by building with CONFIG+=profiling (defines DRONES_PROFILING).
+ * PROFILE_SCOPE("name") measures the end of the current block, "name" must be a literal.
+ * Without DRONES_PROFILING the macro is empty and nothing of the profiler is compiled.
+ */
+#ifdef DRONES_PROFILING
+
+#include <QVector>
+#include <QPair>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+
+struct ProfileEvent {
+    const char *name;
+    qint64 start; ///< ns since the start of the profiler
+    qint64 end;
+};
+
+/**
+ * @brief The ProfileBuffer class is the ring buffer of one thread,
+ * only this thread writes in it (no lock), the oldest events are overwritten.
+ * A reader copies the events then reads head again, and drops the slots that were
+ * overwritten during its copy (see Profiler::snapshot).
+ */
+class ProfileBuffer {
+public:
+    static const int size=4096; ///< must be a power of 2
+    void push(const char *name,qint64 start,qint64 end) {
+        quint64 h=head.load(std::memory_order_relaxed);
+        // the event h-1 is published before its slot is overwritten by the event h-1+size
+        std::atomic_thread_fence(std::memory_order_release);
+        events[h&(size-1)]={name,start,end};
+        head.store(h+1,std::memory_order_release);
+    }
+    int threadIndex=0;
+    ProfileEvent events[size];
+    std::atomic<quint64> head{0};
+};
+
+/**
+ * @brief The StageTiming struct summarizes the events of a stage during the last period.
+ */
+struct StageTiming {
+    QString name;
+    qreal lastMs=0; ///< duration of the last call
+    qreal meanMs=0; ///< mean duration during the period
+    int count=0; ///< number of calls during the period
+};
+
+class Profiler {
+public:
+    static Profiler& instance();
+    static qint64 now();
+    void record(const char *name,qint64 start,qint64 end) {
+        threadBuffer()->push(name,start,end);
+    }
+    /**
+     * @brief stageTimings
+     * @param period duration (ns) of the summary before now
+     * @return one line per stage, in alphabetical order
+     */
+    QVector<StageTiming> stageTimings(qint64 period=1000000000) const;
+    /**
+     * @brief fps
+     * @return number of Canvas::paintEvent during the last second
+     */
+    qreal fps() const;
+    /**
+     * @brief exportChromeTrace : write the content of the buffers in the Chrome trace event format
+     * (open with chrome://tracing or https://ui.perfetto.dev)
+     */
+    bool exportChromeTrace(const QString &fileName) const;
+    ~Profiler();
+private:
+    Profiler() {}
+    ProfileBuffer* threadBuffer();
+    QVector<QPair<int,ProfileEvent>> snapshot() const;
+
+    mutable QMutex mutex; ///< protects buffers (not their content)
+    QVector<ProfileBuffer*> buffers;
+};
+
+class ProfileScope {
+public:
+    ProfileScope(const char *p_name):name(p_name),start(Profiler::now()) {}
+    ~ProfileScope() { Profiler::instance().record(name,start,Profiler::now()); }
+private:
+    const char *name;
+    qint64 start;
+};
+
+#define PROFILE_CONCAT2(a,b) a##b
+#define PROFILE_CONCAT(a,b) PROFILE_CONCAT2(a,b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope,__LINE__)(name)
+
+#else
+
+#define PROFILE_SCOPE(name)
+
+#endif // DRONES_PROFILING
+
+#endif // PROFILER_H
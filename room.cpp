@@ -0,0 +1,55 @@
+#include "room.h"
+#include <QDebug>
+#include <algorithm>
+
+QVector<Wall> Room::walls() const {
+    int N=outline.nbVertices();
+    // openings of each edge, as intervals of the parameter t in [0,1] along the edge
+    QVector<QVector<QPair<float,float>>> openings(N);
+    for (auto &door:doors) {
+        int best=-1;
+        double bestDistance=doorWidth;
+        float bestT=0;
+        for (int i=0; i<N; i++) {
+            Vector2D A=outline[i],AB=outline[i+1]-outline[i];
+            double l2=AB*AB;
+            if (l2==0) continue;
+            double t=((door-A)*AB)/l2;
+            if (t<0 || t>1) continue;
+            double d=(A+t*AB-door).length();
+            if (d<bestDistance) {
+                best=i;
+                bestDistance=d;
+                bestT=t;
+            }
+        }
+        if (best==-1) {
+            qWarning() << "door" << door.x << door.y << "is not on a wall of" << name;
+            continue;
+        }
+        float halfWidth=0.5*doorWidth/(outline[best+1]-outline[best]).length();
+        openings[best].push_back({bestT-halfWidth,bestT+halfWidth});
+    }
+    QVector<Wall> res;
+    for (int i=0; i<N; i++) {
+        Vector2D A=outline[i],AB=outline[i+1]-outline[i];
+        std::sort(openings[i].begin(),openings[i].end());
+        float t=0;
+        for (auto &o:openings[i]) {
+            if (o.first>t) res.push_back({A+t*AB,A+o.first*AB});
+            t=qMax(t,o.second);
+        }
+        if (t<1) res.push_back({A+t*AB,outline[i+1]});
+    }
+    return res;
+}
+
+void Room::draw(QPainter &painter) const {
+    QPen pen(Qt::darkGray);
+    pen.setWidth(6);
+    pen.setCapStyle(Qt::FlatCap);
+    painter.setPen(pen);
+    for (auto &w:walls()) {
+        painter.drawLine(QPointF(w.A.x,w.A.y),QPointF(w.B.x,w.B.y));
+    }
+}
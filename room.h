@@ -0,0 +1,35 @@
+#ifndef ROOM_H
+#define ROOM_H
+
+#include <QString>
+#include <QVector>
+#include <QPainter>
+#include <polygon.h>
+
+const float defaultDoorWidth=20.0; ///< width of the door openings
+
+/**
+ * @brief The Wall struct is a segment that the drones cannot cross.
+ */
+struct Wall {
+    Vector2D A,B;
+};
+
+/**
+ * @brief The Room class is a closed outline of walls with door openings,
+ * a room without door is an obstacle.
+ */
+class Room {
+public:
+    QString name;
+    Polygon outline;
+    QVector<Vector2D> doors; ///< centers of the openings, each one is placed on the nearest edge of the outline
+    float doorWidth=defaultDoorWidth;
+    /**
+     * @brief walls : the edges of the outline without the door openings
+     */
+    QVector<Wall> walls() const;
+    void draw(QPainter &painter) const;
+};
+
+#endif // ROOM_H
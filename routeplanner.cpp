@@ -0,0 +1,118 @@
+#include "routeplanner.h"
+#include <limits>
+#include <queue>
+#include <algorithm>
+
+/// servers closed by the A* search of a congested path, the path by length is used above
+const int maxCongestedSearch=4096;
+
+QVector<Vector2D> RoutePlanner::getRoute(ServerId from,ServerId to) {
+    auto k=key(from,to);
+    auto it=cache.constFind(k);
+    if (it!=cache.constEnd()) return it.value();
+
+    QVector<Vector2D> route;
+    QVector<LinkId> path;
+    if (hasCongestion() && findCongestedPath(from,to,path)) {
+        for (LinkId l:path) {
+            route.push_back(map->links[l].getEdgeCenter());
+        }
+    } else {
+        ServerId current=from;
+        // follow the first link of the best path until the destination cell,
+        // the remaining distance must decrease at each step
+        qreal remaining=std::numeric_limits<qreal>::infinity();
+        while (router!=nullptr && current!=to) {
+            auto best=router->bestDistance(current,to);
+            if (best.first==invalidId || best.second>=remaining) break; // unreachable: go straight to the target
+            const Link &link=map->links[best.first];
+            remaining=best.second;
+            route.push_back(link.getEdgeCenter());
+            current = link.getOther(current);
+        }
+    }
+    const QPointF &target=map->servers[to].position;
+    route.push_back(Vector2D(target.x(),target.y()));
+    const NavigationGraph *navigation=&map->navigation;
+    if (!navigation->isEmpty()) {
+        // go around the walls between the waypoints
+        QVector<Vector2D> path={route[0]};
+        for (int i=1; i<route.size(); i++) {
+            path+=navigation->findPath(route[i-1],route[i]);
+        }
+        route=path;
+    }
+    route.squeeze();
+    cache.insert(k,route);
+    return route;
+}
+
+bool RoutePlanner::findCongestedPath(ServerId from,ServerId to,QVector<LinkId> &path) const {
+    struct Visit {
+        qreal cost; ///< cost of the best path from "from"
+        qreal estimate; ///< distance to "to", a lower bound of the cost
+        LinkId link; ///< last link of the best path
+        bool closed;
+    };
+    // the estimates are consistent (the cost of a link is at least the distance between its
+    // servers): a closed server has its best cost, the search goes towards "to" and only
+    // spreads around the congested servers
+    Vector2D target(map->servers[to].position.x(),map->servers[to].position.y());
+    auto distance=[&](ServerId s) {
+        return (Vector2D(map->servers[s].position.x(),map->servers[s].position.y())-target).length();
+    };
+    QHash<ServerId,Visit> visits;
+    qreal estimate=distance(from);
+    typedef QPair<qreal,ServerId> Entry; ///< cost + estimate
+    std::priority_queue<Entry,std::vector<Entry>,std::greater<Entry>> queue;
+    visits.insert(from,{0,estimate,invalidId,false});
+    queue.push({estimate,from});
+    int nbClosed=0;
+    while (!queue.empty()) {
+        ServerId s=queue.top().second;
+        queue.pop();
+        Visit &visit=visits[s];
+        if (visit.closed) continue;
+        if (s==to) {
+            path.clear();
+            for (ServerId current=to; current!=from;) {
+                LinkId l=visits[current].link;
+                path.push_back(l);
+                current=map->links[l].getOther(current);
+            }
+            std::reverse(path.begin(),path.end());
+            return true;
+        }
+        visit.closed=true;
+        if (++nbClosed>maxCongestedSearch) return false;
+        qreal cost=visit.cost;
+        for (LinkId l:map->servers[s].links) {
+            const Link &link=map->links[l];
+            ServerId t=link.getOther(s);
+            qreal c=cost+link.getCost(congestion);
+            auto v=visits.find(t);
+            if (v==visits.end()) {
+                estimate=distance(t);
+                visits.insert(t,{c,estimate,l,false});
+            } else if (!v.value().closed && c<v.value().cost) {
+                estimate=v.value().estimate;
+                v.value()={c,estimate,l,false};
+            } else {
+                continue;
+            }
+            queue.push({c+estimate,t});
+        }
+    }
+    return false;
+}
+
+QVector<Vector2D> RoutePlanner::getRoute(const Vector2D &position,ServerId from,ServerId to) {
+    QVector<Vector2D> route;
+    if (from!=invalidId) route=getRoute(from,to);
+    else route={Vector2D(map->servers[to].position.x(),map->servers[to].position.y())};
+    const NavigationGraph *navigation=&map->navigation;
+    if (navigation->isEmpty() || navigation->isVisible(position,route[0])) return route;
+    QVector<Vector2D> path=navigation->findPath(position,route[0]);
+    path.pop_back();
+    return path+route;
+}
@@ -0,0 +1,84 @@
+#ifndef ROUTEPLANNER_H
+#define ROUTEPLANNER_H
+
+#include <QHash>
+#include <QVector>
+#include <QSharedPointer>
+#include <servermap.h>
+
+/**
+ * @brief The RoutePlanner class converts the routing table of the servers
+ * into waypoint chains: the centers of the common edges to cross, then the
+ * position of the destination server.
+ * Chains are computed once per (source, destination) pair and shared by all
+ * the drones that follow them (QVector is implicitly shared).
+ * With a navigation graph, the segments of the chains that cross walls are replaced by
+ * the shortest paths around the walls.
+ * The router gives the shortest paths by length and is shared by the fleets of a map. With the
+ * congestion of a fleet (setCongestion), a chain is the best path for Link::getCost(): an A* search
+ * over the links, guided by the distance to the destination, that only visits the servers around the path
+ * (no table is built per fleet).
+ */
+class RoutePlanner {
+public:
+    /**
+     * @brief setRouter : set the routing table used to compute the chains (shared with the map)
+     * @param r the new router, or nullptr
+     */
+    void setRouter(const QSharedPointer<const Router> &r) {
+        router=r;
+        cache.clear();
+    }
+    const Router* getRouter() const { return router.data(); }
+    /**
+     * @brief setCongestion : compute the next chains with the costs of the links for these loads
+     * @param loads loads of the servers of the fleet (copied), empty to route by length only
+     */
+    void setCongestion(const QVector<ServerLoad> &loads) {
+        congestion=loads;
+        cache.clear();
+    }
+    bool hasCongestion() const { return !congestion.isEmpty(); }
+    /**
+     * @brief setMap : set the servers, links and visibility graph of the walls (not owned)
+     */
+    void setMap(const ServerMap *m) {
+        map=m;
+        cache.clear();
+    }
+    /**
+     * @brief getRoute
+     * @param from server of the cell where the drone starts
+     * @param to destination server
+     * @return the list of waypoints from the cell of "from" to the position of "to"
+     */
+    QVector<Vector2D> getRoute(ServerId from,ServerId to);
+    /**
+     * @brief getRoute : route of a drone, the shared chain when the first waypoint is visible from position
+     * @param position position of the drone
+     * @param from server of the cell of the drone, invalidId if the drone is outside of the cells
+     * @param to destination server
+     */
+    QVector<Vector2D> getRoute(const Vector2D &position,ServerId from,ServerId to);
+    /**
+     * @brief clear all the cached routes, must be called when the routing table changes
+     */
+    void clear() { cache.clear(); }
+    int size() const { return cache.size(); }
+private:
+    static quint64 key(ServerId from,ServerId to) {
+        return (quint64(quint32(from))<<32) | quint32(to);
+    }
+    /**
+     * @brief findCongestedPath : A* search of the best path for the congestion
+     * @param path links of the path from "from" to "to"
+     * @return false if the search visits more than maxCongestedSearch servers or if there is no path
+     */
+    bool findCongestedPath(ServerId from,ServerId to,QVector<LinkId> &path) const;
+    QHash<quint64,QVector<Vector2D>> cache;
+    QSharedPointer<const Router> router;
+    QVector<ServerLoad> congestion; ///< loads used for the costs of the links, empty for the lengths only
+    const ServerMap *map=nullptr;
+};
+
+#endif // ROUTEPLANNER_H
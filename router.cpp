@@ -0,0 +1,238 @@
+#include "router.h"
+#include <queue>
+#include <limits>
+
+namespace {
+const float infinity=std::numeric_limits<float>::infinity();
+const int maxWitnessSettled=100; ///< witness searches are local, a missed witness only adds a useless shortcut
+
+struct Arc {
+    int to;
+    float weight;
+    int middle; ///< -1 for an original link
+    LinkId link;
+};
+
+typedef QPair<float,int> QueueItem; ///< (distance,server)
+typedef std::priority_queue<QueueItem,std::vector<QueueItem>,std::greater<QueueItem>> MinQueue;
+
+/**
+ * @brief Dijkstra buffers reused between searches, a value is valid only if
+ * its stamp is the current generation (avoids clearing arrays of size n).
+ */
+struct SearchBuffers {
+    QVector<float> dist;
+    QVector<int> parent;
+    QVector<unsigned> stamp;
+    unsigned generation=0;
+
+    void reset(int n) {
+        if (stamp.size()<n) {
+            dist.resize(n);
+            parent.resize(n);
+            stamp.fill(0,n);
+            generation=0;
+        }
+        generation++;
+    }
+    float distance(int v) const { return stamp[v]==generation?dist[v]:infinity; }
+    void set(int v,float d,int p) {
+        dist[v]=d;
+        parent[v]=p;
+        stamp[v]=generation;
+    }
+};
+
+void addArc(QVector<Arc> &arcs,const Arc &arc) {
+    for (auto &a:arcs) {
+        if (a.to==arc.to) {
+            if (arc.weight<a.weight) a=arc;
+            return;
+        }
+    }
+    arcs.push_back(arc);
+}
+
+/**
+ * @brief witnessSearch : bounded Dijkstra from source in the remaining graph, avoiding a server.
+ */
+void witnessSearch(const QVector<QVector<Arc>> &adj,SearchBuffers &buf,int source,int avoid,float limit) {
+    buf.reset(adj.size());
+    MinQueue queue;
+    buf.set(source,0,-1);
+    queue.push({0,source});
+    int settled=0;
+    while (!queue.empty() && settled<maxWitnessSettled) {
+        auto top=queue.top();
+        queue.pop();
+        if (top.first>buf.distance(top.second)) continue;
+        if (top.first>limit) break;
+        settled++;
+        for (auto &a:adj[top.second]) {
+            if (a.to==avoid) continue;
+            float d=top.first+a.weight;
+            if (d<buf.distance(a.to)) {
+                buf.set(a.to,d,top.second);
+                queue.push({d,a.to});
+            }
+        }
+    }
+}
+
+/**
+ * @brief contract : compute (and add if !simulate) the shortcuts needed to remove v.
+ * @return the number of shortcuts
+ */
+int contract(QVector<QVector<Arc>> &adj,SearchBuffers &buf,int v,bool simulate) {
+    const QVector<Arc> arcs=adj[v];
+    float maxOut=0;
+    for (auto &a:arcs) maxOut=qMax(maxOut,a.weight);
+    int nb=0;
+    for (int i=0; i<arcs.size(); i++) {
+        witnessSearch(adj,buf,arcs[i].to,v,arcs[i].weight+maxOut);
+        for (int j=i+1; j<arcs.size(); j++) {
+            float w=arcs[i].weight+arcs[j].weight;
+            if (buf.distance(arcs[j].to)>w) {
+                nb++;
+                if (!simulate) {
+                    addArc(adj[arcs[i].to],{arcs[j].to,w,v,invalidId});
+                    addArc(adj[arcs[j].to],{arcs[i].to,w,v,invalidId});
+                }
+            }
+        }
+    }
+    return nb;
+}
+}
+
+HierarchicalRouter::HierarchicalRouter(const QList<Server> &servers,const QVector<Link> &links,const BuildProgress &progress) {
+    int n=servers.size();
+    QVector<QVector<Arc>> adj(n);
+    for (auto &s:servers) {
+        for (LinkId l:s.links) {
+            const Link &link=links[l];
+            addArc(adj[s.id],{link.getOther(s.id),float(link.getDistance()),-1,l});
+        }
+    }
+
+    // contraction in the order of the edge difference (lazy updates)
+    SearchBuffers buf;
+    QVector<int> contractedNeighbors(n,0);
+    QVector<QVector<Arc>> up(n);
+    rank.fill(0,n);
+    MinQueue queue;
+    for (int v=0; v<n; v++) {
+        queue.push({float(contract(adj,buf,v,true)-adj[v].size()),v});
+    }
+    int order=0;
+    while (!queue.empty()) {
+        int v=queue.top().second;
+        queue.pop();
+        float priority=contract(adj,buf,v,true)-adj[v].size()+contractedNeighbors[v];
+        if (!queue.empty() && priority>queue.top().first) {
+            queue.push({priority,v});
+            continue;
+        }
+        shortcuts+=contract(adj,buf,v,false);
+        rank[v]=order++;
+        // remaining neighbors have a higher rank: the arcs of v are its upward edges
+        up[v]=adj[v];
+        for (auto &a:adj[v]) {
+            auto &arcs=adj[a.to];
+            for (int i=0; i<arcs.size(); i++) {
+                if (arcs[i].to==v) {
+                    arcs.removeAt(i);
+                    break;
+                }
+            }
+            contractedNeighbors[a.to]++;
+        }
+        adj[v].clear();
+        if (progress && !progress(order)) return;
+    }
+
+    // compact storage of the upward graph
+    upStart.resize(n+1);
+    upStart[0]=0;
+    for (int v=0; v<n; v++) {
+        upStart[v+1]=upStart[v]+up[v].size();
+        for (auto &a:up[v]) {
+            upEdges.push_back({a.to,a.weight,a.middle,a.link});
+        }
+    }
+    built=true;
+}
+
+const HierarchicalRouter::UpEdge* HierarchicalRouter::findEdge(int a,int b) const {
+    if (rank[a]>rank[b]) std::swap(a,b);
+    for (int i=upStart[a]; i<upStart[a+1]; i++) {
+        if (upEdges[i].to==b) return &upEdges[i];
+    }
+    return nullptr;
+}
+
+LinkId HierarchicalRouter::firstLink(int from,int to) const {
+    // unpack the shortcuts until the original link that leaves "from"
+    auto e=findEdge(from,to);
+    while (e!=nullptr && e->link==invalidId) {
+        e=findEdge(from,e->middle);
+    }
+    return e?e->link:invalidId;
+}
+
+QPair<LinkId,qreal> HierarchicalRouter::bestDistance(ServerId from,ServerId to) const {
+    if (from==to) return {invalidId,0};
+    thread_local SearchBuffers buf[2];
+    int n=rank.size();
+    buf[0].reset(n);
+    buf[1].reset(n);
+    MinQueue queue[2];
+    buf[0].set(from,0,-1);
+    buf[1].set(to,0,-1);
+    queue[0].push({0,from});
+    queue[1].push({0,to});
+    float best=infinity;
+    int meeting=-1;
+    // alternate forward (0) and backward (1) upward searches
+    int dir=0;
+    while (!queue[0].empty() || !queue[1].empty()) {
+        if (queue[dir].empty()) dir=1-dir;
+        auto top=queue[dir].top();
+        queue[dir].pop();
+        if (top.first>buf[dir].distance(top.second)) continue;
+        if (top.first>=best) {
+            // no better path in this direction
+            while (!queue[dir].empty()) queue[dir].pop();
+            dir=1-dir;
+            continue;
+        }
+        int v=top.second;
+        float total=top.first+buf[1-dir].distance(v);
+        if (total<best) {
+            best=total;
+            meeting=v;
+        }
+        for (int i=upStart[v]; i<upStart[v+1]; i++) {
+            const UpEdge &e=upEdges[i];
+            float d=top.first+e.weight;
+            if (d<buf[dir].distance(e.to)) {
+                buf[dir].set(e.to,d,v);
+                queue[dir].push({d,e.to});
+            }
+        }
+        dir=1-dir;
+    }
+    if (meeting==-1) return {invalidId,infinity};
+
+    // second server of the path in the hierarchy
+    int next;
+    if (meeting==from) {
+        next=buf[1].parent[meeting];
+    } else {
+        next=meeting;
+        while (buf[0].parent[next]!=from) {
+            next=buf[0].parent[next];
+        }
+    }
+    return {firstLink(from,next),best};
+}
@@ -0,0 +1,81 @@
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include <QVector>
+#include <QPair>
+#include <serveranddrone.h>
+#include <buildprogress.h>
+
+/**
+ * @brief The Router class answers next-hop queries on the graph of links:
+ * bestDistance(from,to) is the link to follow from "from" and the cost of the best path
+ * to "to" (sum of the lengths of the links). The link is invalidId
+ * when from==to or when there is no path.
+ * A router is not modified by the queries, it can be shared by threads.
+ */
+class Router {
+public:
+    virtual ~Router() {}
+    virtual QPair<LinkId,qreal> bestDistance(ServerId from,ServerId to) const=0;
+};
+
+/**
+ * @brief The FlatRouter class reads a nServers x nServers table:
+ * the first link of the best path and its cost for each pair of servers.
+ */
+class FlatRouter : public Router {
+public:
+    FlatRouter(int n):nServers(n),table(n*n,QPair<LinkId,float>(invalidId,0)) {}
+    QPair<LinkId,qreal> bestDistance(ServerId from,ServerId to) const override {
+        auto &e=table[from*nServers+to];
+        return {e.first,e.second};
+    }
+    void set(ServerId from,ServerId to,LinkId link,float cost) { table[from*nServers+to]={link,cost}; }
+private:
+    int nServers;
+    QVector<QPair<LinkId,float>> table; ///< 8 bytes per pair of servers
+};
+
+/**
+ * @brief The HierarchicalRouter class uses a contraction hierarchy of the links graph.
+ * Servers are contracted one by one (least important first) and shortcuts are added
+ * to keep the distances between the remaining servers. A query is a bidirectional
+ * Dijkstra that only goes up the hierarchy, it visits a few hundred servers on
+ * planar maps and the memory is in O(n+shortcuts) instead of O(n²).
+ * @warning server ids must be their index in the server list.
+ */
+class HierarchicalRouter : public Router {
+public:
+    /**
+     * @param progress called after each contracted server, the contraction stops when it returns false
+     */
+    HierarchicalRouter(const QList<Server> &servers,const QVector<Link> &links,const BuildProgress &progress=nullptr);
+    QPair<LinkId,qreal> bestDistance(ServerId from,ServerId to) const override;
+    int nbShortcuts() const { return shortcuts; }
+    /**
+     * @brief isBuilt
+     * @return false if the contraction was stopped by progress (the router must not be used)
+     */
+    bool isBuilt() const { return built; }
+private:
+    /**
+     * @brief The UpEdge struct is an edge to a server of higher rank,
+     * link is the original link or invalidId for a shortcut by middle.
+     */
+    struct UpEdge {
+        int to;
+        float weight;
+        int middle;
+        LinkId link;
+    };
+    const UpEdge* findEdge(int a,int b) const;
+    LinkId firstLink(int from,int to) const;
+
+    QVector<int> rank; ///< contraction order of each server
+    QVector<int> upStart; ///< upEdges of server i are in [upStart[i],upStart[i+1][
+    QVector<UpEdge> upEdges;
+    int shortcuts=0;
+    bool built=false;
+};
+
+#endif // ROUTER_H
@@ -0,0 +1,66 @@
+#include "rtree.h"
+#include <algorithm>
+#include <numeric>
+#include <limits>
+#include <cmath>
+
+void RTree::build(const QVector<QPair<Vector2D,Vector2D>> &boxes) {
+    clear();
+    int n=boxes.size();
+    if (n==0) return;
+    // Sort-Tile-Recursive order: sqrt(nbLeaves) vertical slices, sorted by y in each slice
+    QVector<int> order(n);
+    std::iota(order.begin(),order.end(),0);
+    auto centerX=[&boxes](int i) { return boxes[i].first.x+boxes[i].second.x; };
+    auto centerY=[&boxes](int i) { return boxes[i].first.y+boxes[i].second.y; };
+    std::sort(order.begin(),order.end(),[&](int a,int b) { return centerX(a)<centerX(b); });
+    int nbLeaves=(n+nodeSize-1)/nodeSize;
+    int sliceSize=int(std::ceil(std::sqrt(double(nbLeaves))))*nodeSize;
+    for (int s=0; s<n; s+=sliceSize) {
+        std::sort(order.begin()+s,order.begin()+qMin(s+sliceSize,n),[&](int a,int b) { return centerY(a)<centerY(b); });
+    }
+    int total=n+n/(nodeSize-1)+1; // all the levels
+    minX.reserve(total);
+    minY.reserve(total);
+    maxX.reserve(total);
+    maxY.reserve(total);
+    ids.reserve(n);
+    levelStart.append(0);
+    for (int i:order) {
+        minX.append(boxes[i].first.x);
+        minY.append(boxes[i].first.y);
+        maxX.append(boxes[i].second.x);
+        maxY.append(boxes[i].second.y);
+        ids.append(i);
+    }
+    levelStart.append(n);
+    // each run of nodeSize entries gets a parent, until the level fits in one node
+    int start=0,end=n;
+    while (end-start>nodeSize) {
+        for (int k=start; k<end; k+=nodeSize) {
+            float x0=std::numeric_limits<float>::max(),y0=x0,x1=-x0,y1=-x0;
+            for (int c=k; c<qMin(k+nodeSize,end); c++) {
+                x0=qMin(x0,minX[c]);
+                y0=qMin(y0,minY[c]);
+                x1=qMax(x1,maxX[c]);
+                y1=qMax(y1,maxY[c]);
+            }
+            minX.append(x0);
+            minY.append(y0);
+            maxX.append(x1);
+            maxY.append(y1);
+        }
+        start=end;
+        end=minX.size();
+        levelStart.append(end);
+    }
+}
+
+void RTree::clear() {
+    minX.clear();
+    minY.clear();
+    maxX.clear();
+    maxY.clear();
+    ids.clear();
+    levelStart.clear();
+}
@@ -0,0 +1,66 @@
+#ifndef RTREE_H
+#define RTREE_H
+
+#include <QVector>
+#include <QPair>
+#include <vector2d.h>
+
+/**
+ * @brief The RTree class is a static R-tree of boxes, packed by Sort-Tile-Recursive:
+ * the boxes are sorted in vertical slices then by y in each slice, each run of nodeSize
+ * boxes is a leaf and each run of nodeSize nodes a parent. The levels are stored one after
+ * the other in flat arrays (leaves first), the children of a node are contiguous.
+ */
+class RTree {
+public:
+    static const int nodeSize=16;
+    /**
+     * @brief build : index the boxes, box i is reported as i by query
+     * @param boxes (min,max) corners of the boxes
+     */
+    void build(const QVector<QPair<Vector2D,Vector2D>> &boxes);
+    void clear();
+    bool isEmpty() const { return ids.isEmpty(); }
+    int size() const { return ids.size(); }
+    /**
+     * @brief query : call f(i) for each box i that intersects the box (min,max)
+     */
+    template<class F> void query(const Vector2D &min,const Vector2D &max,F f) const;
+private:
+    bool intersects(int k,const Vector2D &min,const Vector2D &max) const {
+        return minX[k]<=max.x && maxX[k]>=min.x && minY[k]<=max.y && maxY[k]>=min.y;
+    }
+    QVector<float> minX,minY,maxX,maxY; ///< boxes of the entries of all the levels
+    QVector<int> ids; ///< index of the box of each leaf entry
+    QVector<int> levelStart; ///< first entry of each level, the last level is the root
+};
+
+template<class F> void RTree::query(const Vector2D &min,const Vector2D &max,F f) const {
+    if (ids.isEmpty()) return;
+    // stack of (level,entry), at most nodeSize entries per level are pending
+    int stackLevel[nodeSize*32],stackEntry[nodeSize*32];
+    int top=0;
+    int root=levelStart.size()-2;
+    for (int k=levelStart[root]; k<levelStart[root+1]; k++) {
+        stackLevel[top]=root;
+        stackEntry[top++]=k;
+    }
+    while (top>0) {
+        top--;
+        int level=stackLevel[top],k=stackEntry[top];
+        if (!intersects(k,min,max)) continue;
+        if (level==0) {
+            f(ids[k]);
+            continue;
+        }
+        // children of entry k of level are the entries of level-1 grouped by nodeSize
+        int first=levelStart[level-1]+(k-levelStart[level])*nodeSize;
+        int last=qMin(first+nodeSize,levelStart[level]);
+        for (int c=first; c<last; c++) {
+            stackLevel[top]=level-1;
+            stackEntry[top++]=c;
+        }
+    }
+}
+
+#endif // RTREE_H
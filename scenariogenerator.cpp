@@ -0,0 +1,191 @@
+#include "scenariogenerator.h"
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QSet>
+
+QString ScenarioGenerator::layoutName(Layout layout) {
+    switch (layout) {
+    case Uniform : return "uniform";
+    case Clustered : return "clustered";
+    case Grid : return "grid";
+    case Collinear : return "collinear";
+    }
+    return "";
+}
+
+QPoint ScenarioGenerator::randomPoint(const QRect &window) {
+    return QPoint(window.left()+rnd.bounded(window.width()),window.top()+rnd.bounded(window.height()));
+}
+
+QVector<QPoint> ScenarioGenerator::positions(Layout layout,int n,const QRect &window) {
+    QVector<QPoint> res;
+    QSet<quint64> used; // no duplicated positions
+    auto add=[&](const QPoint &p) {
+        if (!window.contains(p)) return;
+        quint64 key=(quint64(quint32(p.x()))<<32)|quint32(p.y());
+        if (used.contains(key)) return;
+        used.insert(key);
+        res.push_back(p);
+    };
+    // the random draws are bounded: duplicated positions are rejected, so they would not end when
+    // n is close to (or above) the number of points of the window
+    int guard=0;
+    switch (layout) {
+    case Uniform :
+        while (res.size()<n && guard++<100*n) add(randomPoint(window));
+        break;
+    case Clustered : {
+        int nClusters=qMax(2,int(sqrt(n)/2));
+        QVector<QPoint> centers;
+        for (int i=0; i<nClusters; i++) centers.push_back(randomPoint(window));
+        qreal sigma=qMin(window.width(),window.height())/(4.0*sqrt(nClusters));
+        while (res.size()<n && guard++<100*n) {
+            // Box-Muller transform
+            qreal r=sigma*sqrt(-2.0*log(1.0-rnd.generateDouble()));
+            qreal a=2.0*M_PI*rnd.generateDouble();
+            const QPoint &c=centers[rnd.bounded(nClusters)];
+            add(QPoint(c.x()+qRound(r*cos(a)),c.y()+qRound(r*sin(a))));
+        }
+        break;
+    }
+    case Grid : {
+        int nx=qMax(2,int(ceil(sqrt(n*qreal(window.width())/window.height()))));
+        int ny=(n+nx-1)/nx;
+        int dx=qMax(1,window.width()/(nx+1));
+        int dy=qMax(1,window.height()/(ny+1));
+        for (int j=0; j<ny && res.size()<n; j++) {
+            for (int i=0; i<nx && res.size()<n; i++) {
+                add(QPoint(window.left()+(i+1)*dx,window.top()+(j+1)*dy));
+            }
+        }
+        break;
+    }
+    case Collinear : {
+        // a few horizontal, vertical and diagonal lines
+        int nLines=qMax(3,int(sqrt(n)/4));
+        QVector<QPair<QPoint,QPoint>> lines;
+        for (int i=0; i<nLines; i++) {
+            int y=window.top()+(i+1)*window.height()/(nLines+1);
+            int x=window.left()+(i+1)*window.width()/(nLines+1);
+            switch (i%3) {
+            case 0 : lines.push_back({QPoint(window.left(),y),QPoint(1,0)}); break;
+            case 1 : lines.push_back({QPoint(x,window.top()),QPoint(0,1)}); break;
+            default : lines.push_back({QPoint(window.left(),window.top()+rnd.bounded(window.height()/2)),QPoint(1,1)}); break;
+            }
+        }
+        while (res.size()<n && guard++<100*n) {
+            auto &l=lines[rnd.bounded(nLines)];
+            int t=rnd.bounded(qMax(window.width(),window.height()));
+            add(l.first+t*l.second);
+        }
+        guard=0;
+        while (res.size()<n && guard++<100*n) add(randomPoint(window));
+        break;
+    }
+    }
+    // missing positions: the free points of the window in order
+    for (int y=window.top(); y<=window.bottom() && res.size()<n; y++) {
+        for (int x=window.left(); x<=window.right() && res.size()<n; x++) add(QPoint(x,y));
+    }
+    return res;
+}
+
+QList<Server> ScenarioGenerator::servers(Layout layout,int n,const QRect &window) {
+    QList<Server> res;
+    int num=0;
+    for (auto &p:positions(layout,n,window)) {
+        Server s;
+        s.id=num++;
+        s.name=QString("S%1").arg(s.id);
+        s.position=p;
+        s.color=QColor::fromHsv(rnd.bounded(360),128+rnd.bounded(128),160+rnd.bounded(96));
+        res.push_back(s);
+    }
+    return res;
+}
+
+QList<Drone> ScenarioGenerator::drones(int n,const QList<Server> &servers,const QRect &window) {
+    QList<Drone> res;
+    for (int i=0; i<n; i++) {
+        Drone d;
+        d.name=QString("D%1").arg(i);
+        QPoint p=randomPoint(window);
+        d.position.set(p.x(),p.y());
+        d.target=servers.isEmpty()?invalidId:rnd.bounded(servers.size());
+        res.push_back(d);
+    }
+    return res;
+}
+
+QVector<Room> ScenarioGenerator::rooms(int n,const QRect &window) {
+    QVector<Room> res;
+    int nx=int(ceil(sqrt(double(n))));
+    if (n<=0) return res;
+    int cellW=window.width()/nx,cellH=window.height()/nx;
+    for (int i=0; i<n; i++) {
+        Room room;
+        room.name=QString("R%1").arg(i);
+        // half of the grid cell, randomly shifted inside it
+        int w=cellW/2,h=cellH/2;
+        int x0=window.left()+(i%nx)*cellW+rnd.bounded(cellW-w);
+        int y0=window.top()+(i/nx)*cellH+rnd.bounded(cellH-h);
+        Vector2D corners[4]={Vector2D(x0,y0),Vector2D(x0+w,y0),Vector2D(x0+w,y0+h),Vector2D(x0,y0+h)};
+        for (auto &c:corners) room.outline.addVertex(c);
+        int nbDoors=1+rnd.bounded(2);
+        int edge=rnd.bounded(4);
+        for (int k=0; k<nbDoors; k++) {
+            // doors on distinct edges, away from the corners
+            Vector2D A=corners[(edge+k)%4],B=corners[(edge+k+1)%4];
+            float t=0.2+0.6*rnd.generateDouble();
+            room.doors.push_back(A+t*(B-A));
+        }
+        res.push_back(room);
+    }
+    return res;
+}
+
+QJsonDocument ScenarioGenerator::toJson(const QRect &window,const QList<Server> &servers,const QList<Drone> &drones,
+                                        const QVector<Room> &rooms) {
+    QJsonObject root;
+    QJsonObject win;
+    win["origine"]=QString("%1,%2").arg(window.left()).arg(window.top());
+    win["size"]=QString("%1,%2").arg(window.width()).arg(window.height());
+    root["window"]=win;
+    QJsonArray arrServers;
+    for (auto &s:servers) {
+        QJsonObject obj;
+        obj["name"]=s.name;
+        obj["position"]=QString("%1,%2").arg(int(s.position.x())).arg(int(s.position.y()));
+        obj["color"]=s.color.name();
+        arrServers.append(obj);
+    }
+    root["servers"]=arrServers;
+    QJsonArray arrDrones;
+    for (auto &d:drones) {
+        QJsonObject obj;
+        obj["name"]=d.name;
+        obj["position"]=QString("%1,%2").arg(int(d.position.x)).arg(int(d.position.y));
+        if (d.hasTarget()) obj["target"]=servers[d.target].name;
+        arrDrones.append(obj);
+    }
+    root["drones"]=arrDrones;
+    if (!rooms.isEmpty()) {
+        QJsonArray arrRooms;
+        for (auto &r:rooms) {
+            QJsonObject obj;
+            obj["name"]=r.name;
+            QJsonArray vertices,doors;
+            for (int i=0; i<r.outline.nbVertices(); i++) {
+                vertices.append(QString("%1,%2").arg(r.outline[i].x).arg(r.outline[i].y));
+            }
+            for (auto &d:r.doors) {
+                doors.append(QString("%1,%2").arg(d.x).arg(d.y));
+            }
+            obj["vertices"]=vertices;
+            obj["doors"]=doors;
+            arrRooms.append(obj);
+        }
+        root["rooms"]=arrRooms;
+    }
+    return QJsonDocument(root);
+}
@@ -0,0 +1,52 @@
+#ifndef SCENARIOGENERATOR_H
+#define SCENARIOGENERATOR_H
+
+#include <QRandomGenerator>
+#include <QJsonDocument>
+#include <QRect>
+#include <serveranddrone.h>
+#include <room.h>
+
+/**
+ * @brief The ScenarioGenerator class creates reproducible synthetic maps (same seed, same map)
+ * to test and benchmark the geometry on large and degenerate layouts.
+ */
+class ScenarioGenerator {
+public:
+    enum Layout {
+        Uniform, ///< uniform random positions
+        Clustered, ///< gaussian clusters around random centers
+        Grid, ///< regular grid: many cocircular points
+        Collinear ///< points on a few lines
+    };
+    ScenarioGenerator(quint32 seed):rnd(seed) {}
+    static QString layoutName(Layout layout);
+    /**
+     * @brief positions : n distinct integer positions inside the window
+     * (every point of the window if it has less than n points)
+     */
+    QVector<QPoint> positions(Layout layout,int n,const QRect &window);
+    /**
+     * @brief servers : n servers (id, name, position and color)
+     */
+    QList<Server> servers(Layout layout,int n,const QRect &window);
+    /**
+     * @brief drones : n drones at random positions with random targets
+     * (the targets are indices in servers)
+     */
+    QList<Drone> drones(int n,const QList<Server> &servers,const QRect &window);
+    /**
+     * @brief rooms : n square rooms on a grid, with one or two doors each
+     */
+    QVector<Room> rooms(int n,const QRect &window);
+    /**
+     * @brief toJson : description in the format read by MainWindow::loadJson
+     */
+    static QJsonDocument toJson(const QRect &window,const QList<Server> &servers,const QList<Drone> &drones,
+                                const QVector<Room> &rooms=QVector<Room>());
+private:
+    QPoint randomPoint(const QRect &window);
+    QRandomGenerator rnd;
+};
+
+#endif // SCENARIOGENERATOR_H
@@ -0,0 +1,40 @@
+#ifndef SCRATCHBUFFER_H
+#define SCRATCHBUFFER_H
+
+#include <QVector>
+
+/**
+ * @brief The ScratchBuffer class lends a temporary QVector<T> from a pool of the thread:
+ * the buffer is empty but keeps the capacity of its previous uses, and it returns to the
+ * pool when the ScratchBuffer is destroyed. The temporary arrays of the geometry
+ * (triangulation, clipping, mesh construction) are allocated once per thread instead of once per call.
+ * Usage: ScratchBuffer<Vector2D> pts; pts->push_back(p);
+ */
+template<class T> class ScratchBuffer {
+public:
+    ScratchBuffer() {
+        auto &p=pool();
+        if (!p.isEmpty()) {
+            buffer.swap(p.last());
+            p.removeLast();
+        }
+        buffer.clear();
+    }
+    ~ScratchBuffer() {
+        auto &p=pool();
+        p.push_back(QVector<T>());
+        p.last().swap(buffer);
+    }
+    ScratchBuffer(const ScratchBuffer&)=delete;
+    ScratchBuffer& operator=(const ScratchBuffer&)=delete;
+    QVector<T>& operator*() { return buffer; }
+    QVector<T>* operator->() { return &buffer; }
+private:
+    static QVector<QVector<T>>& pool() {
+        thread_local QVector<QVector<T>> buffers;
+        return buffers;
+    }
+    QVector<T> buffer;
+};
+
+#endif // SCRATCHBUFFER_H
@@ -1,57 +1,99 @@
 #include "serveranddrone.h"
 #include <QDebug>
+#include <scratchbuffer.h>
+#include <voronoicells.h>
 
-Link::Link(Server *n1,Server *n2,const QPair<Vector2D,Vector2D> &edge):
-    node1(n1),node2(n2) {
+Link::Link(const Server &n1,const Server &n2,const QPair<Vector2D,Vector2D> &edge):
+    node1(n1.id),node2(n2.id) {
     // computation of the length of the link
     Vector2D center=0.5*(edge.first+edge.second);
-    distance = (center-Vector2D(n1->position.x(),n1->position.y())).length();
-    distance += (center-Vector2D(n2->position.x(),n2->position.y())).length();
-    edgeCenter=QPointF(center.x,center.y);
+    distance = (center-Vector2D(n1.position.x(),n1.position.y())).length();
+    distance += (center-Vector2D(n2.position.x(),n2.position.y())).length();
+    edgeCenter=center;
 }
 
-void Link::draw(QPainter &painter) {
-    painter.drawLine(node1->position,edgeCenter);
-    painter.drawLine(node2->position,edgeCenter);
+void Link::draw(QPainter &painter,const QList<Server> &servers) const {
+    QPointF center(edgeCenter.x,edgeCenter.y);
+    painter.drawLine(servers[node1].position,center);
+    painter.drawLine(servers[node2].position,center);
 }
 
 /* Motions of the drone to reach the "destination" position*/
-void Drone::move(qreal dt) {
+void Drone::move(qreal dt,const MotionParameters &motion) {
     Vector2D dir=destination-position;
     double d=dir.length();
 
-    if (d<slowDownDistance) {
-        speed=(d*speedLocal/slowDownDistance)*dir;
+    if (d<motion.slowDownDistance) {
+        speed=(d*motion.speedLocal/motion.slowDownDistance)*dir;
     } else {
-        speed+=(accelation*dt/d)*dir;
-        if (speed.length()>speedMax) {
+        speed+=(motion.acceleration*dt/d)*dir;
+        if (speed.length()>motion.speedMax) {
             speed.normalize();
-            speed*=speedMax;
+            speed*=motion.speedMax;
         }
     }
-    // new position and orientation of the drone
+    // new position of the drone, the orientation is computed when needed (see updateAzimuts)
     position+=(dt*speed);
-    Vector2D Vn = (1.0/speed.length())*speed;
-    if (Vn.y==0) {
-        if (Vn.x>0) {
-            azimut = -90;
-        } else {
-            azimut = 90.0;
-        }
-    } else if (Vn.y>0) {
-        azimut = 180.0-180.0*atan(Vn.x/Vn.y)/M_PI;
-    } else {
-        azimut = -180.0*atan(Vn.x/Vn.y)/M_PI;
-    }
+    azimutOutdated=true;
 
     /* Write here your code that manages drone trajectories */
+    // go to the next waypoint as soon as the slow down area is reached,
+    // only the last one (the target) makes the drone slow down
+    if (routeStep<route.size()-1 && (destination-position).length()<motion.slowDownDistance) {
+        routeStep++;
+        destination=route[routeStep];
+    }
 }
 
-Server* Drone::overflownArea(QList<Server>& list) {
-    auto it=list.begin();
-    while (it!=list.end() && !it->area.contains(position)) {
-        it++;
+void Drone::updateAzimuts(QList<Drone> &drones,const QVector<int> &indices) {
+    // gather the speeds of the outdated drones in contiguous arrays
+    ScratchBuffer<int> ids;
+    ScratchBuffer<float> vx,vy,res;
+    ids->resize(indices.size());
+    vx->resize(indices.size());
+    vy->resize(indices.size());
+    res->resize(indices.size());
+    int *pi=ids->data();
+    float *px=vx->data(),*py=vy->data(),*pr=res->data();
+    int n=0;
+    for (int i:indices) {
+        const Drone &d=drones[i];
+        if (!d.azimutOutdated) continue;
+        pi[n]=i;
+        px[n]=d.speed.x;
+        py[n]=d.speed.y;
+        pr[n++]=d.azimut;
     }
-    connectedTo= it!=list.end()?&(*it):nullptr;
+    // branchless loop: the azimut is 0 when going up (-y) and increases clockwise
+    for (int k=0; k<n; k++) {
+        float a=180.0f-(180.0f/float(M_PI))*fastAtan2(px[k],py[k]);
+        pr[k]=(px[k]*px[k]+py[k]*py[k]>0.0f)?a:pr[k];
+    }
+    for (int k=0; k<n; k++) {
+        Drone &d=drones[pi[k]];
+        d.azimut=pr[k];
+        d.azimutOutdated=false;
+    }
+}
+
+void Drone::updateAzimuts(QList<Drone> &drones) {
+    ScratchBuffer<int> all;
+    for (int i=0; i<drones.size(); i++) all->push_back(i);
+    updateAzimuts(drones,*all);
+}
+
+void Drone::setRoute(const QVector<Vector2D> &waypoints) {
+    route=waypoints;
+    routeStep=0;
+    if (!route.isEmpty()) destination=route[0];
+}
+
+ServerId Drone::overflownArea(const VoronoiCells &cells) {
+    connectedTo=findArea(cells);
     return connectedTo;
 }
+
+ServerId Drone::findArea(const VoronoiCells &cells) const {
+    // drones stay most of the time in the same cell or move to a neighbor: the walk is short
+    return cells.locate(position,connectedTo);
+}
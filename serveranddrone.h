@@ -6,61 +6,157 @@
 #include <QPainter>
 #include <polygon.h>
 
-const qreal accelation = 2.0; // unit/s²
-const qreal speedMax = 1.0; // unit/s
-const qreal speedLocal = 0.1; // unit/s
-const qreal slowDownDistance = 20;
-const qreal minDistance=5;
-class Link;
+const int defaultServerCapacity=10; ///< number of drones a server can handle
+const qreal congestionWeight=1.0; ///< extra cost of a link per overloaded capacity unit
 
+/**
+ * Servers and links are stored by value in the tables of their map (see ServerMap) and
+ * referenced by their index: the handles stay valid when a table grows and the routing
+ * reads contiguous memory instead of chasing pointers.
+ */
+typedef qint32 ServerId; ///< index of a server in the servers of its map
+typedef qint32 LinkId; ///< index of a link in the links of its map
+const qint32 invalidId=-1; ///< no server or no link
+
+class VoronoiCells;
+
+/**
+ * @brief The MotionParameters struct : settings of the motion of the drones of a simulation
+ * (set at runtime, see BatchRunner for parameter sweeps)
+ */
+struct MotionParameters {
+    qreal acceleration=2.0; ///< unit/s²
+    qreal speedMax=1.0; ///< unit/s
+    qreal speedLocal=0.1; ///< unit/s, speed at slowDownDistance of the target
+    qreal slowDownDistance=20; ///< the drones slow down at this distance of the target
+    qreal minDistance=5; ///< minimal distance between two drones
+};
+
+/**
+ * @brief The Server class is a server of the map, it does not change during a simulation:
+ * the map is shared by the fleets (see ServerMap), their drones are counted in ServerLoad.
+ * The cells of the servers are stored by the map (see VoronoiCells).
+ */
 class Server {
 public :
-    int id;
+    ServerId id; ///< index of the server in its map
     QString name;
     QPointF position;
     QColor color;
-    Polygon area;
-    QList<Link*> links;
-    /** bestDistance: vector of pair(link, distance)
-     *  link is the link to follow from the current server to reach a server destination
-     *  for example bestDistance[0]={link to go to server#0,distance to this server}
-    **/
-    QVector<QPair<Link*,qreal>> bestDistance;
+    QVector<LinkId> links;
+    int capacity=defaultServerCapacity; ///< number of drones the server can handle
+};
+
+/**
+ * @brief The ServerLoad struct : drones connected to a server and handoff metrics, for one fleet
+ * (loads[i] is the load of the server of id i, see Fleet)
+ */
+struct ServerLoad {
+    int capacity=defaultServerCapacity; ///< copy of Server::capacity
+    int nbConnected=0; ///< number of drones in the cell
+    /**
+     * @brief queueLength
+     * @return the number of drones waiting for a connection slot
+     */
+    int queueLength() const { return qMax(0,nbConnected-capacity); }
+    bool isOverloaded() const { return nbConnected>capacity; }
+    /**
+     * @brief congestion
+     * @return 0 if the server is under its capacity, the overload ratio otherwise
+     */
+    qreal congestion() const { return capacity>0?qreal(queueLength())/capacity:qreal(nbConnected); }
+
+    // metrics for capacity planning
+    int handoffsIn=0; ///< total number of drones that entered the cell
+    int handoffsOut=0; ///< total number of drones that left the cell
+    int stepHandoffs=0; ///< drones that entered the cell during the last step
+    qreal throughput=0; ///< handoffs in per second (moving average)
+    int maxConnected=0;
+    int maxQueueLength=0;
 };
 
 class Link {
 public:
+    Link() {}
     /**
      * @brief Link : create a new link
      * @param n1 : one server
      * @param n2 : the other server
      * @param edge : the common edge vertices (extremity)
      */
-    Link(Server *n1,Server *n2,const QPair<Vector2D,Vector2D> &edge);
-    void draw(QPainter &painter);
-    Server* getNode1() { return node1; }
-    Server* getNode2() { return node2; }
+    Link(const Server &n1,const Server &n2,const QPair<Vector2D,Vector2D> &edge);
+    /**
+     * @brief draw : lines from the servers to the center of their common edge
+     * @param servers servers of the map of the link
+     */
+    void draw(QPainter &painter,const QList<Server> &servers) const;
+    ServerId getNode1() const { return node1; }
+    ServerId getNode2() const { return node2; }
+    /**
+     * @brief getOther : the server at the other end of the link
+     */
+    ServerId getOther(ServerId s) const { return (s==node1)?node2:node1; }
     qreal getDistance() const { return distance; }
-    Vector2D getEdgeCenter() { return Vector2D(edgeCenter.x(),edgeCenter.y()); }
+    /**
+     * @brief getCost : length of the link increased by the congestion of the servers
+     * @param loads loads of the servers of a fleet
+     * @return the cost used by routing
+     */
+    qreal getCost(const QVector<ServerLoad> &loads) const {
+        return distance*(1.0+0.5*congestionWeight*(loads[node1].congestion()+loads[node2].congestion()));
+    }
+    Vector2D getEdgeCenter() const { return edgeCenter; }
 private:
-    Server *node1;
-    Server *node2;
-    QPointF edgeCenter;
-    qreal distance;
+    ServerId node1=invalidId;
+    ServerId node2=invalidId;
+    Vector2D edgeCenter;
+    qreal distance=0;
 };
 
 class Drone {
 public :
     QString name;
     Vector2D position;
-    Server *target;
-    qreal azimut=0;
+    ServerId target=invalidId;
+    qreal azimut=0; ///< orientation in degrees, follows the speed after updateAzimuts()
     Vector2D destination;
-    void move(qreal dt);
-    Server* overflownArea(QList<Server>& list);
+    void move(qreal dt,const MotionParameters &motion);
+    /**
+     * @brief updateAzimuts : orientation of the drones that moved since their last update,
+     * computed from the speed by a batched fast atan2 (error < 0.001°). A drone that
+     * does not move keeps its orientation. Only called for the drones that are drawn or recorded.
+     * @param indices drones to update
+     */
+    static void updateAzimuts(QList<Drone> &drones,const QVector<int> &indices);
+    static void updateAzimuts(QList<Drone> &drones);
+    /**
+     * @brief setAzimut : set the orientation, it is kept until the next move()
+     */
+    void setAzimut(qreal a) {
+        azimut=a;
+        azimutOutdated=false;
+    }
+    bool hasTarget() const { return target!=invalidId; }
+    ServerId overflownArea(const VoronoiCells &cells);
+    /**
+     * @brief findArea : search the cell containing the drone, from the current one
+     * @return the server of the cell or invalidId, the connection is not changed
+     */
+    ServerId findArea(const VoronoiCells &cells) const;
+    ServerId getConnectedTo() const { return connectedTo; }
+    void connectTo(ServerId s) { connectedTo=s; }
+    /**
+     * @brief setRoute : set the list of waypoints to follow, the last one is the target
+     * @param waypoints shared list of positions (see RoutePlanner)
+     */
+    void setRoute(const QVector<Vector2D> &waypoints);
+    bool hasRoute() const { return !route.isEmpty(); }
 private:
-    Server *connectedTo;
+    ServerId connectedTo=invalidId;
     Vector2D speed;
+    bool azimutOutdated=false; ///< the speed changed since the last updateAzimuts()
+    QVector<Vector2D> route; ///< waypoints to the target (shared between drones)
+    int routeStep=0; ///< index of the current destination in route
 };
 
 #endif // SERVERANDDRONE_H
@@ -0,0 +1,9 @@
+#include "servermap.h"
+#include <mapbuilder.h>
+
+void ServerMap::build() {
+    MapBuilder::createVoronoiMap(servers,barriers,cells,origin,size);
+    MapBuilder::createServersLinks(servers,cells,links);
+    navigation.build(rooms,wallClearance);
+    router.reset(MapBuilder::createRouter(servers,links));
+}
@@ -0,0 +1,43 @@
+#ifndef SERVERMAP_H
+#define SERVERMAP_H
+
+#include <QPoint>
+#include <QSize>
+#include <QSharedPointer>
+#include <serveranddrone.h>
+#include <room.h>
+#include <navigationgraph.h>
+#include <router.h>
+#include <voronoicells.h>
+
+/**
+ * @brief The ServerMap class is the part of a map that does not change during a simulation:
+ * window, servers and their cells, links, barriers, rooms, navigation graph and routing by length.
+ * It is built once (MapLoader, BatchRunner), then only read through a ServerMapPtr shared
+ * by all the fleets that fly over it: a Fleet only stores its drones and the loads of the servers.
+ * Servers and links are referenced by their index (ServerId, LinkId), the tables must not
+ * be reordered after the build.
+ */
+class ServerMap {
+public:
+    ServerMap() {}
+    /**
+     * @brief build : cells, links, navigation graph and router of the servers and rooms
+     */
+    void build();
+
+    QPoint origin;
+    QSize size;
+    QList<Server> servers; ///< servers[i] has the ServerId i
+    VoronoiCells cells; ///< cells[i] is the cell of the server i
+    QVector<Link> links; ///< links[i] has the LinkId i
+    QVector<MeshEdge> barriers; ///< segments between servers that the cells and the links do not cross
+    QVector<Room> rooms;
+    qreal wallClearance=MotionParameters().slowDownDistance; ///< clearance of the navigation graph, the slow down distance of the fleets
+    NavigationGraph navigation; ///< visibility graph of the walls of the rooms
+    QSharedPointer<const Router> router; ///< shortest paths by length (without congestion)
+};
+
+typedef QSharedPointer<const ServerMap> ServerMapPtr;
+
+#endif // SERVERMAP_H
@@ -0,0 +1,279 @@
+#include "telemetry.h"
+#include <QtEndian>
+#include <QDebug>
+#include <cmath>
+#include <limits>
+
+namespace {
+void putVarint(QByteArray &out,quint64 v) {
+    while (v>=0x80) {
+        out.append(char(v|0x80));
+        v>>=7;
+    }
+    out.append(char(v));
+}
+
+void putSigned(QByteArray &out,qint64 v) {
+    putVarint(out,(quint64(v)<<1)^quint64(v>>63)); // zigzag: small magnitudes give small codes
+}
+
+/**
+ * @brief getVarint
+ * @param pos position of the varint in data, moved after it
+ * @return the value, 0 at the end of data
+ */
+quint64 getVarint(const QByteArray &data,int &pos) {
+    quint64 v=0;
+    int shift=0;
+    while (pos<data.size() && shift<64) {
+        quint8 b=quint8(data[pos++]);
+        v|=quint64(b&0x7f)<<shift;
+        if (!(b&0x80)) break;
+        shift+=7;
+    }
+    return v;
+}
+
+qint64 getSigned(const QByteArray &data,int &pos) {
+    quint64 v=getVarint(data,pos);
+    return qint64(v>>1)^-qint64(v&1);
+}
+
+qint64 quantize(qreal v,int scale) {
+    return std::isfinite(v)?qint64(std::llround(v*scale)):0;
+}
+}
+
+bool TelemetryRecorder::open(const QString &fileName,int nbDrones,int nbServers) {
+    close();
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    QByteArray header("DRTL");
+    putVarint(header,telemetryVersion);
+    putVarint(header,nbDrones);
+    putVarint(header,nbServers);
+    putVarint(header,telemetryPositionScale);
+    putVarint(header,telemetryAzimutScale);
+    file.write(header);
+    recordedDrones=nbDrones;
+    current.fill(DroneSample(),nbDrones);
+    chunk.clear();
+    nbFrames=0;
+    stopping=false;
+    writer=new Writer(this);
+    writer->start();
+    return true;
+}
+
+void TelemetryRecorder::close() {
+    if (writer==nullptr) return;
+    pushChunk();
+    mutex.lock();
+    stopping=true;
+    hasChunk.wakeAll();
+    mutex.unlock();
+    writer->wait();
+    delete writer;
+    writer=nullptr;
+    file.close();
+}
+
+void TelemetryRecorder::record(qint64 timeMs,QList<Drone> &drones) {
+    if (writer==nullptr) return;
+    if (nbFrames==0) {
+        // keyframe: the differences are computed from 0
+        lastTime=0;
+        last.fill(DroneSample(),recordedDrones);
+        for (auto &s:last) s.connected=s.target=0;
+    }
+    Drone::updateAzimuts(drones);
+    putSigned(chunk,timeMs-lastTime);
+    lastTime=timeMs;
+    for (int i=0; i<recordedDrones; i++) {
+        DroneSample &p=last[i];
+        DroneSample &s=current[i];
+        if (i<drones.size()) {
+            Drone &drone=drones[i];
+            s.x=quantize(drone.position.x,telemetryPositionScale);
+            s.y=quantize(drone.position.y,telemetryPositionScale);
+            s.azimut=quantize(drone.azimut,telemetryAzimutScale);
+            s.connected=drone.getConnectedTo();
+            s.target=drone.target;
+        }
+        putSigned(chunk,s.x-p.x);
+        putSigned(chunk,s.y-p.y);
+        putSigned(chunk,s.azimut-p.azimut);
+        putSigned(chunk,s.connected-p.connected);
+        putSigned(chunk,s.target-p.target);
+        p=s;
+    }
+    if (++nbFrames==telemetryKeyframeInterval) pushChunk();
+}
+
+void TelemetryRecorder::pushChunk() {
+    if (nbFrames==0) return;
+    QByteArray frames;
+    putVarint(frames,nbFrames);
+    frames.append(chunk);
+    quint32 size=qToLittleEndian(quint32(frames.size()));
+    QByteArray block(reinterpret_cast<const char*>(&size),sizeof(size));
+    block.append(frames);
+    mutex.lock();
+    pending.append(block);
+    hasChunk.wakeOne();
+    mutex.unlock();
+    chunk.clear();
+    nbFrames=0;
+}
+
+void TelemetryRecorder::writeChunks() {
+    mutex.lock();
+    while (true) {
+        while (pending.isEmpty() && !stopping) hasChunk.wait(&mutex);
+        if (pending.isEmpty()) break;
+        QByteArray block=pending.takeFirst();
+        mutex.unlock();
+        file.write(block);
+        mutex.lock();
+    }
+    mutex.unlock();
+    file.flush();
+}
+
+bool TelemetryReader::open(const QString &fileName) {
+    close();
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    QByteArray header=file.read(64);
+    int pos=4;
+    if (header.size()<4 || header.mid(0,4)!="DRTL" || int(getVarint(header,pos))!=telemetryVersion) {
+        qWarning() << "Telemetry: bad header in" << fileName;
+        close();
+        return false;
+    }
+    quint64 nbDrones=getVarint(header,pos);
+    servers=getVarint(header,pos);
+    positionScale=getVarint(header,pos);
+    azimutScale=getVarint(header,pos);
+    if (nbDrones>quint64(std::numeric_limits<int>::max()) || positionScale<=0 || azimutScale<=0) {
+        qWarning() << "Telemetry: bad header in" << fileName;
+        close();
+        return false;
+    }
+    drones=int(nbDrones);
+    // index of the chunks: size and time of the keyframe
+    qint64 offset=pos;
+    qint64 fileSize=file.size();
+    while (offset+qint64(sizeof(quint32))<fileSize) {
+        file.seek(offset);
+        QByteArray head=file.read(sizeof(quint32)+20);
+        quint32 size=qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(head.constData()));
+        if (offset+qint64(sizeof(quint32))+size>fileSize) break; // truncated chunk
+        int p=sizeof(quint32);
+        quint64 nbFrames=getVarint(head,p);
+        // a frame takes at least 1 byte for its time and 5 per drone: a drone count that cannot
+        // fit in the chunk is a corrupt file (and would allocate the frame for nothing)
+        if (nbFrames==0 || nbFrames>size || 1+5*quint64(drones)>size/nbFrames) {
+            qWarning() << "Telemetry: corrupt chunk at" << offset << "in" << fileName;
+            close();
+            return false;
+        }
+        keyframes.append({offset,qint64(size),getSigned(head,p)});
+        offset+=sizeof(quint32)+size;
+    }
+    return true;
+}
+
+void TelemetryReader::close() {
+    file.close();
+    drones=servers=0;
+    keyframes.clear();
+    chunkIndex=-1;
+    chunk.clear();
+    chunkFrames=chunkFrame=readPos=0;
+    frameTime=0;
+    frame.clear();
+}
+
+int TelemetryReader::keyframeIndex(qint64 timeMs) const {
+    // last keyframe with time<=timeMs (binary search)
+    int lo=0,hi=keyframes.size();
+    while (hi-lo>1) {
+        int mid=(lo+hi)/2;
+        if (keyframes[mid].time<=timeMs) lo=mid; else hi=mid;
+    }
+    return lo;
+}
+
+bool TelemetryReader::loadChunk(int i) {
+    if (i<0 || i>=keyframes.size()) return false;
+    file.seek(keyframes[i].offset+sizeof(quint32));
+    chunk=file.read(keyframes[i].size);
+    chunkIndex=i;
+    readPos=0;
+    chunkFrames=getVarint(chunk,readPos);
+    chunkFrame=0;
+    return chunkFrames>0;
+}
+
+void TelemetryReader::decodeFrame() {
+    if (chunkFrame==0) {
+        frameTime=0;
+        frame.fill(DroneSample(),drones);
+        for (auto &s:frame) s.connected=s.target=0;
+    }
+    frameTime+=getSigned(chunk,readPos);
+    for (auto &s:frame) {
+        s.x+=getSigned(chunk,readPos);
+        s.y+=getSigned(chunk,readPos);
+        s.azimut+=getSigned(chunk,readPos);
+        s.connected+=getSigned(chunk,readPos);
+        s.target+=getSigned(chunk,readPos);
+    }
+    chunkFrame++;
+}
+
+bool TelemetryReader::next() {
+    if (chunkIndex<0 || chunkFrame==chunkFrames) {
+        if (!loadChunk(chunkIndex+1)) return false;
+    }
+    decodeFrame();
+    return true;
+}
+
+qint64 TelemetryReader::nextTime() const {
+    if (chunkIndex>=0 && chunkFrame<chunkFrames) {
+        int pos=readPos;
+        return frameTime+getSigned(chunk,pos);
+    }
+    return (chunkIndex+1<keyframes.size())?keyframes[chunkIndex+1].time:-1;
+}
+
+bool TelemetryReader::seek(qint64 timeMs) {
+    if (keyframes.isEmpty() || !loadChunk(keyframeIndex(timeMs))) return false;
+    decodeFrame();
+    advanceTo(timeMs);
+    return true;
+}
+
+bool TelemetryReader::advanceTo(qint64 timeMs) {
+    qint64 t;
+    while ((t=nextTime())>=0 && t<=timeMs) {
+        if (!next()) return false;
+    }
+    return t>=0;
+}
+
+void TelemetryReader::apply(QList<Drone> &drones,const QList<Server> &servers,QVector<ServerLoad> &loads) const {
+    for (auto &l:loads) l.nbConnected=0;
+    for (int i=0; i<drones.size() && i<frame.size(); i++) {
+        const DroneSample &s=frame[i];
+        Drone &drone=drones[i];
+        drone.position=Vector2D(float(s.x)/positionScale,float(s.y)/positionScale);
+        drone.setAzimut(qreal(s.azimut)/azimutScale);
+        ServerId connected=(s.connected>=0 && s.connected<servers.size())?s.connected:invalidId;
+        drone.connectTo(connected);
+        if (connected!=invalidId) loads[connected].nbConnected++;
+        drone.target=(s.target>=0 && s.target<servers.size())?s.target:invalidId;
+    }
+}
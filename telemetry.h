@@ -0,0 +1,152 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+/**
+ * Telemetry log of the drones: one frame per step with the state of every drone.
+ * The file is a header followed by chunks, a chunk starts with a keyframe (values from 0)
+ * followed by frames encoded as the difference with the previous frame. Integers are
+ * stored as zigzag varints, so that the small differences between two steps take 1 byte.
+ *  header: "DRTL" version nbDrones nbServers positionScale azimutScale
+ *  chunk:  size (4 bytes, little endian, size of the rest of the chunk) nbFrames frames
+ *  frame:  time (ms), then for each drone x y azimut connected target
+ */
+
+#include <QVector>
+#include <QList>
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThread>
+#include <serveranddrone.h>
+
+const int telemetryVersion=1;
+const int telemetryKeyframeInterval=50; ///< number of frames in a chunk
+const int telemetryPositionScale=64; ///< positions are stored in 1/64 unit
+const int telemetryAzimutScale=1000; ///< azimuts are stored in millidegrees
+
+/**
+ * @brief The DroneSample struct : quantized state of a drone in a frame
+ */
+struct DroneSample {
+    qint64 x=0,y=0; ///< position*telemetryPositionScale
+    qint64 azimut=0; ///< azimut*telemetryAzimutScale
+    qint64 connected=-1; ///< id of the server of the cell, -1 if none
+    qint64 target=-1; ///< id of the target server, -1 if none
+};
+
+/**
+ * @brief The TelemetryRecorder class encodes the frames in the calling thread and
+ * writes the complete chunks in a background thread: record() never waits for the disk.
+ */
+class TelemetryRecorder {
+public:
+    ~TelemetryRecorder() { close(); }
+    /**
+     * @brief open : create the file and start the writing thread
+     * @return false if the file cannot be created
+     */
+    bool open(const QString &fileName,int nbDrones,int nbServers);
+    /**
+     * @brief close : write the last chunk and wait for the end of the writing thread
+     */
+    void close();
+    bool isRecording() const { return writer!=nullptr; }
+    /**
+     * @brief record : add a frame
+     * @param timeMs time of the frame since the start of the record
+     */
+    void record(qint64 timeMs,QList<Drone> &drones);
+private:
+    class Writer : public QThread {
+    public:
+        Writer(TelemetryRecorder *r):recorder(r) {}
+        void run() override { recorder->writeChunks(); }
+    private:
+        TelemetryRecorder *recorder;
+    };
+    void writeChunks();
+    void pushChunk();
+
+    QFile file;
+    Writer *writer=nullptr;
+    QMutex mutex; ///< protects pending and stopping
+    QWaitCondition hasChunk;
+    QList<QByteArray> pending; ///< chunks waiting for the writing thread
+    bool stopping=false;
+
+    // encoder state (calling thread only)
+    int recordedDrones=0;
+    QByteArray chunk; ///< frames of the current chunk
+    int nbFrames=0; ///< number of frames in chunk
+    qint64 lastTime=0;
+    QVector<DroneSample> last; ///< previous frame (base of the differences)
+    QVector<DroneSample> current; ///< state of each drone, a removed drone keeps its last state
+};
+
+/**
+ * @brief The TelemetryReader class decodes a log file frame by frame, the chunks are
+ * indexed at the opening to seek any time from the previous keyframe.
+ */
+class TelemetryReader {
+public:
+    bool open(const QString &fileName);
+    void close();
+    bool isOpen() const { return file.isOpen(); }
+    int nbDrones() const { return drones; }
+    int nbServers() const { return servers; }
+    int nbKeyframes() const { return keyframes.size(); }
+    qint64 keyframeTime(int i) const { return keyframes[i].time; }
+    /**
+     * @brief keyframeIndex
+     * @return the index of the last keyframe at or before timeMs (0 if none)
+     */
+    int keyframeIndex(qint64 timeMs) const;
+    /**
+     * @brief seek : decode from the previous keyframe to the last frame at or before timeMs
+     * @return false if the file has no frame
+     */
+    bool seek(qint64 timeMs);
+    /**
+     * @brief next : decode the next frame
+     * @return false at the end of the file
+     */
+    bool next();
+    /**
+     * @brief advanceTo : decode the frames until the last one at or before timeMs
+     * @return false at the end of the file
+     */
+    bool advanceTo(qint64 timeMs);
+    qint64 time() const { return frameTime; }
+    qint64 nextTime() const;
+    const QVector<DroneSample>& samples() const { return frame; }
+    /**
+     * @brief apply : set the state of the drones to the current frame
+     * (the number of drones in the cells of the servers is counted again)
+     * @param loads loads of the servers of the fleet of the drones
+     */
+    void apply(QList<Drone> &drones,const QList<Server> &servers,QVector<ServerLoad> &loads) const;
+private:
+    struct Keyframe {
+        qint64 offset; ///< position of the chunk in the file
+        qint64 size; ///< size of the frames
+        qint64 time; ///< time of its first frame
+    };
+    bool loadChunk(int i);
+    void decodeFrame();
+
+    QFile file;
+    int drones=0,servers=0;
+    int positionScale=telemetryPositionScale,azimutScale=telemetryAzimutScale;
+    QVector<Keyframe> keyframes;
+    // decoder state
+    int chunkIndex=-1;
+    QByteArray chunk;
+    int chunkFrames=0; ///< number of frames in chunk
+    int chunkFrame=0; ///< number of frames of chunk already decoded
+    int readPos=0; ///< position of the next frame in chunk
+    qint64 frameTime=0;
+    QVector<DroneSample> frame;
+};
+
+#endif // TELEMETRY_H
@@ -1,138 +1,420 @@
 #include <trianglemesh.h>
+#include <profiler.h>
+#include <scratchbuffer.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
-TriangleMesh::TriangleMesh(QList<Server> &servers) {
-    // fill tabVerticies from servers
-    for (auto &s:servers) {
-        tabVertices.push_back(Vector2D(s.position.x(),s.position.y()));
+namespace {
+quint64 positionKey(float x,float y) {
+    quint32 ix,iy;
+    memcpy(&ix,&x,sizeof(ix));
+    memcpy(&iy,&y,sizeof(iy));
+    return (quint64(ix)<<32) | iy;
+}
+
+/// key of the directed edge (a,b)
+quint64 edgeKey(int a,int b) {
+    return (quint64(quint32(a))<<32) | quint32(b);
+}
+}
+
+TriangleMesh::TriangleMesh(const QList<Server> &servers,const QVector<MeshEdge> &constraints) {
+    PROFILE_SCOPE("TriangleMesh");
+    int n=servers.size();
+    // vertex i is server i
+    vertexX.reserve(n);
+    vertexY.reserve(n);
+    ScratchBuffer<Vector2D> positions;
+    ScratchBuffer<QPair<quint64,int>> keys;
+    for (int i=0; i<n; i++) {
+        Vector2D p(servers[i].position.x(),servers[i].position.y());
+        vertexX.push_back(p.x);
+        vertexY.push_back(p.y);
+        positions->push_back(p);
+        keys->push_back({positionKey(p.x,p.y),i});
     }
+    // first index of each position (duplicated servers)
+    std::sort(keys->begin(),keys->end());
+    auto indexOf=[&keys](const Vector2D &p) {
+        quint64 k=positionKey(p.x,p.y);
+        auto it=std::lower_bound(keys->begin(),keys->end(),qMakePair(k,-1));
+        return (it!=keys->end() && it->first==k)?it->second:-1;
+    };
     // create the convex hull
-    Polygon convexHull(tabVertices);
-
-    tabTriangles=convexHull.getTriangles();
-    // list of server that are not in the convexhull
-    QList<Vector2D> internalVertices;
-    for (auto &s:servers) {
-        Vector2D p(Vector2D(s.position.x(),s.position.y()));
-        if (!convexHull.isAVertex(p)) {
-            internalVertices.append(p);
+    Polygon convexHull(*positions);
+    auto hullTriangles=convexHull.getTriangles();
+    // a triangulation of n vertices has less than 2n triangles: no reallocation during the insertions
+    tabTriangles.reserve(2*n);
+    adjacent.reserve(6*n);
+    ScratchBuffer<quint8> isInserted;
+    isInserted->fill(0,n);
+    for (auto &tri:hullTriangles) {
+        MeshTriangle t={{indexOf(tri[0]),indexOf(tri[1]),indexOf(tri[2])}};
+        tabTriangles.push_back(t);
+        for (int k=0; k<3; k++) (*isInserted)[t[k]]=1;
+    }
+
+    // incremental Delaunay: the hull triangulation is flipped, then each vertex splits the triangle
+    // found by a walk from the previous one and the new triangles are flipped
+    buildAdjacency();
+    ScratchBuffer<int> pending;
+    for (int t=0; t<tabTriangles.size(); t++) pending->push_back(t);
+    flipToDelaunay(*pending);
+    auto link=[this](int t,int k,int neighbor,int from,int to) {
+        // edge k of t is the edge (to,from) of neighbor
+        adjacent[3*t+k]=neighbor;
+        if (neighbor>=0) adjacent[3*neighbor+tabTriangles[neighbor].edgeIndex(to,from)]=t;
+    };
+    auto addTriangle=[this](const MeshTriangle &tri) {
+        tabTriangles.push_back(tri);
+        adjacent.resize(adjacent.size()+3);
+        return tabTriangles.size()-1;
+    };
+    // insertion order along the rows of a grid (one row in two reversed): short walks between
+    // consecutive vertices
+    ScratchBuffer<QPair<quint64,int>> order;
+    if (n>0) {
+        const double x0=*std::min_element(vertexX.begin(),vertexX.end());
+        const double y0=*std::min_element(vertexY.begin(),vertexY.end());
+        const double w=*std::max_element(vertexX.begin(),vertexX.end())-x0;
+        const double h=*std::max_element(vertexY.begin(),vertexY.end())-y0;
+        const int size=qMax(1,int(sqrt(n/4.0)));
+        for (int i=0; i<n; i++) {
+            int col=w>0?qMin(size-1,int((vertexX[i]-x0)*size/w)):0;
+            int row=h>0?qMin(size-1,int((vertexY[i]-y0)*size/h)):0;
+            if (row%2==1) col=size-1-col;
+            order->push_back({quint64(row)*size+col,i});
         }
+        std::sort(order->begin(),order->end());
     }
+    int walkStart=0;
+    for (auto &cell:*order) {
+        int vertex=cell.second;
+        // vertex of the convex hull, a duplicated server is inserted once at its first index
+        if (indexOf((*positions)[vertex])!=vertex || (*isInserted)[vertex]) continue;
+        int t=locate(vertex,walkStart);
+        if (t<0) continue;
+        const MeshTriangle tri=tabTriangles[t];
+        // edges of tri that contain the vertex (exact test)
+        int onEdge=-1,nbOnEdges=0;
+        for (int i=0; i<3; i++) {
+            if (orient(tri[i],tri[(i+1)%3],vertex)==0) {
+                onEdge=i;
+                nbOnEdges++;
+            }
+        }
+        if (nbOnEdges>1) continue; // vertex of tri: duplicated server position
+        if (onEdge==-1) {
+            int v0=tri[0],v1=tri[1],v2=tri[2];
+            int n1=adjacent[3*t+1],n2=adjacent[3*t+2];
+            tabTriangles[t]={{v0,v1,vertex}};
+            int t1=addTriangle({{v1,v2,vertex}});
+            int t2=addTriangle({{v2,v0,vertex}});
+            link(t1,0,n1,v1,v2);
+            link(t2,0,n2,v2,v0);
+            link(t,1,t1,v1,vertex);
+            link(t1,1,t2,v2,vertex);
+            link(t2,1,t,v0,vertex);
+            vertexTriangle[v2]=t1;
+            pending->push_back(t2);
+            pending->push_back(t1);
+        } else {
+            // vertex on the edge P0P1: tri and its neighbor by this edge are split in 2 triangles
+            // (a split in 3 would create a flat triangle)
+            int P0=tri[onEdge];
+            int P1=tri[(onEdge+1)%3];
+            int P2=tri[(onEdge+2)%3];
+            int neighbor=adjacent[3*t+onEdge];
+            int across12=adjacent[3*t+(onEdge+1)%3];
+            int across20=adjacent[3*t+(onEdge+2)%3];
+            tabTriangles[t]={{P0,vertex,P2}};
+            int t2=addTriangle({{vertex,P1,P2}});
+            link(t,1,t2,vertex,P2);
+            link(t,2,across20,P2,P0);
+            link(t2,1,across12,P1,P2);
+            vertexTriangle[P1]=t2;
+            if (neighbor>=0) {
+                const MeshTriangle other=tabTriangles[neighbor];
+                int e=other.edgeIndex(P1,P0);
+                int Q=other[(e+2)%3];
+                int acrossQ1=adjacent[3*neighbor+(e+2)%3];
+                int across0Q=adjacent[3*neighbor+(e+1)%3];
+                tabTriangles[neighbor]={{P1,vertex,Q}};
+                int t1=addTriangle({{vertex,P0,Q}});
+                link(neighbor,0,t2,P1,vertex);
+                link(neighbor,1,t1,vertex,Q);
+                link(neighbor,2,acrossQ1,Q,P1);
+                link(t1,0,t,vertex,P0);
+                link(t1,1,across0Q,P0,Q);
+                vertexTriangle[P0]=t1;
+                pending->push_back(t1);
+                pending->push_back(neighbor);
+            } else {
+                adjacent[3*t]=-1;
+                adjacent[3*t2]=-1;
+            }
+            pending->push_back(t2);
+        }
+        vertexTriangle[vertex]=t;
+        pending->push_back(t);
+        flipToDelaunay(*pending);
+        walkStart=vertexTriangle[vertex];
+    }
+
+    if (!constraints.isEmpty() && !tabTriangles.isEmpty()) {
+        PROFILE_SCOPE("TriangleMesh::constraints");
+        for (auto &c:constraints) {
+            if (c.first<0 || c.first>=n || c.second<0 || c.second>=n) continue;
+            // a duplicated server is replaced by the first server at its position (vertex of the mesh)
+            int a=indexOf((*positions)[c.first]);
+            int b=indexOf((*positions)[c.second]);
+            if (vertexTriangle[a]<0 || vertexTriangle[b]<0) continue;
+            while (a>=0 && a!=b) a=insertEdge(a,b);
+            if (a<0) qWarning() << "TriangleMesh: constraint" << c.first << c.second << "crosses a previous one";
+        }
+        constrainedEdges.reserve(constrainedKeys.size());
+        for (quint64 key:constrainedKeys) constrainedEdges.push_back({int(key>>32),int(key&0xffffffff)});
+        std::sort(constrainedEdges.begin(),constrainedEdges.end());
+    }
+}
 
-    for (auto &vertex:internalVertices) {
-        auto tri=tabTriangles.begin();
-        while (tri!=tabTriangles.end() && !tri->contains(&vertex)) tri++;
-        if (tri!=tabTriangles.end()) {
-            Vector2D v0 = (*tri)[0];
-            Vector2D v1 = (*tri)[1];
-            Vector2D v2 = (*tri)[2];
-            tri->update(v0,v1,vertex);
-            tabTriangles.push_back(Triangle(v1,v2,vertex));
-            tabTriangles.push_back(Triangle(v2,v0,vertex));
+bool TriangleMesh::isConstrained(int a,int b) const {
+    return constrainedKeys.contains(a<b?edgeKey(a,b):edgeKey(b,a));
+}
+
+void TriangleMesh::buildAdjacency() {
+    // the directed edge (a,b) of a triangle is the edge (b,a) of its neighbor
+    ScratchBuffer<QPair<quint64,int>> edges;
+    edges->reserve(3*tabTriangles.size());
+    vertexTriangle.fill(-1,vertexX.size());
+    for (int t=0; t<tabTriangles.size(); t++) {
+        const MeshTriangle &tri=tabTriangles[t];
+        for (int k=0; k<3; k++) {
+            edges->push_back({edgeKey(tri[k],tri[(k+1)%3]),3*t+k});
+            vertexTriangle[tri[k]]=t;
         }
     }
+    std::sort(edges->begin(),edges->end());
+    adjacent.fill(-1,3*tabTriangles.size());
+    for (auto &e:*edges) {
+        quint64 reverse=(e.first<<32) | (e.first>>32);
+        auto it=std::lower_bound(edges->begin(),edges->end(),qMakePair(reverse,-1));
+        if (it!=edges->end() && it->first==reverse) adjacent[e.second]=it->second/3;
+    }
+}
 
-    while (!checkDelaunay()) {
-        // search the first triangle that is not delaunay compliant and flippabe
-        auto it = tabTriangles.begin();
-        while (it!=tabTriangles.end() && !(*it).canBeFlipped()) {
-            it++;
+int TriangleMesh::insertEdge(int a,int b) {
+    // triangles around a, CCW from vertexTriangle[a] then CW if a is on the hull
+    ScratchBuffer<int> fan;
+    const int first=vertexTriangle[a];
+    int t=first;
+    do {
+        fan->push_back(t);
+        const MeshTriangle &tri=tabTriangles[t];
+        t=adjacent[3*t+(tri.vertexIndex(a)+2)%3];
+    } while (t>=0 && t!=first);
+    if (t<0) {
+        for (t=adjacent[3*first+tabTriangles[first].vertexIndex(a)]; t>=0; t=adjacent[3*t+tabTriangles[t].vertexIndex(a)]) {
+            fan->push_back(t);
+        }
+    }
+    auto addConstraint=[this](int u,int v) { constrainedKeys.insert(u<v?edgeKey(u,v):edgeKey(v,u)); };
+    auto isBefore=[this,a,b](int v) {
+        // v on the ray [ab)
+        return orient(a,b,v)==0 && (vertexX[v]-vertexX[a])*(vertexX[b]-vertexX[a])+(vertexY[v]-vertexY[a])*(vertexY[b]-vertexY[a])>0;
+    };
+    // triangle (a,u,w) whose edge (u,w) is crossed by [ab], u on the right of [ab] and w on its left
+    int start=-1,u=-1,w=-1;
+    for (int f:*fan) {
+        const MeshTriangle &tri=tabTriangles[f];
+        int i=tri.vertexIndex(a);
+        int v1=tri[(i+1)%3],v2=tri[(i+2)%3];
+        if (v1==b || v2==b) {
+            addConstraint(a,b);
+            return b;
+        }
+        if (isBefore(v1) || isBefore(v2)) {
+            int v=isBefore(v1)?v1:v2;
+            addConstraint(a,v);
+            return v;
         }
-        if (it!=tabTriangles.end()) {
-            flipTriangle(&(*it));
+        if (start<0 && orient(a,v1,b)>0 && orient(a,b,v2)>0) {
+            start=f;
+            u=v1;
+            w=v2;
         }
     }
+    if (start<0) return -1;
 
-}
+    // walk along [ab] through the crossed triangles: the vertices on each side are the chains of the cavity
+    ScratchBuffer<int> crossed,leftChain,rightChain;
+    crossed->push_back(start);
+    rightChain->push_back(u);
+    leftChain->push_back(w);
+    int end=-1;
+    for (t=start; end<0;) {
+        if (isConstrained(u,w)) return -1;
+        int next=adjacent[3*t+tabTriangles[t].edgeIndex(u,w)];
+        if (next<0) return -1; // cannot happen, b is in the mesh
+        const MeshTriangle &tri=tabTriangles[next];
+        int q=tri[(tri.edgeIndex(w,u)+2)%3];
+        crossed->push_back(next);
+        t=next;
+        double o=orient(a,b,q);
+        if (q==b || o==0) {
+            end=q; // b or a vertex on [ab]
+        } else if (o>0) {
+            leftChain->push_back(q);
+            w=q;
+        } else {
+            rightChain->push_back(q);
+            u=q;
+        }
+    }
 
-bool TriangleMesh::checkDelaunay() {
-    bool areAllDelaunay=true;
-    for (auto &tri:tabTriangles) {
-        bool res = tri.checkDelaunay(tabVertices);
-        if (!res) {
-            auto L=findOppositPointOfTrianglesWithCommonEdge(tri);
-            auto it=L.begin();
-            while (it!=L.end() && tri.circleContains(*it)) {
-                it++;
+    // edges of the cavity with the triangles around it
+    struct BorderEdge {
+        int from,to,outside;
+    };
+    ScratchBuffer<BorderEdge> border;
+    for (int c:*crossed) {
+        const MeshTriangle &tri=tabTriangles[c];
+        for (int k=0; k<3; k++) {
+            int outside=adjacent[3*c+k];
+            if (outside<0 || !crossed->contains(outside)) border->push_back({tri[k],tri[(k+1)%3],outside});
+        }
+    }
+    // k crossed triangles, k vertices in the chains: k new triangles in the same slots
+    ScratchBuffer<MeshTriangle> created;
+    std::reverse(leftChain->begin(),leftChain->end());
+    triangulateCavity(a,end,leftChain->data(),leftChain->size(),*created);
+    triangulateCavity(end,a,rightChain->data(),rightChain->size(),*created);
+    for (int k=0; k<created->size(); k++) {
+        int slot=(*crossed)[k];
+        tabTriangles[slot]=(*created)[k];
+        for (int i=0; i<3; i++) vertexTriangle[(*created)[k][i]]=slot;
+    }
+    for (int k=0; k<created->size(); k++) {
+        int slot=(*crossed)[k];
+        const MeshTriangle &tri=tabTriangles[slot];
+        for (int i=0; i<3; i++) {
+            int from=tri[i],to=tri[(i+1)%3];
+            int neighbor=-1;
+            bool onBorder=false;
+            for (auto &e:*border) {
+                if (e.from==from && e.to==to) {
+                    onBorder=true;
+                    neighbor=e.outside;
+                    if (neighbor>=0) adjacent[3*neighbor+tabTriangles[neighbor].edgeIndex(to,from)]=slot;
+                    break;
+                }
+            }
+            if (!onBorder) {
+                for (int other:*crossed) {
+                    if (tabTriangles[other].edgeIndex(to,from)>=0) {
+                        neighbor=other;
+                        break;
+                    }
+                }
             }
-            tri.setDelaunay(false,it!=L.end());
+            adjacent[3*slot+i]=neighbor;
         }
-        areAllDelaunay=areAllDelaunay && res;
     }
-    return areAllDelaunay;
+    addConstraint(a,end);
+    return end;
 }
 
-void TriangleMesh::flipTriangle(Triangle *ptrTriangleClicked) {
-    // get the list of opposit points (0..3)
-    auto L=findOppositPointOfTrianglesWithCommonEdge(*ptrTriangleClicked);
-    // search the point that is inside the circumcircle
-    auto it=L.begin();
-    while (it!=L.end() && ptrTriangleClicked->circleContains(*it)) {
-        it++;
-    }
-    // if it exists
-    if (it!=L.end()) {
-        // search the opposit triangle and the ordered list of 4 points
-        auto res = findOppositTriangle(ptrTriangleClicked,*it);
-        // switch the vertices
-        ptrTriangleClicked->update(res.second[0],res.second[1],res.second[3]);
-        res.first->update(res.second[1],res.second[2],res.second[3]);
+void TriangleMesh::triangulateCavity(int p,int q,const int *chain,int n,QVector<MeshTriangle> &triangles) const {
+    if (n==0) return;
+    // the circles through p and q are nested on the side of the chain: the last vertex inside
+    // the circle of the current one gives an empty circle
+    int c=0;
+    for (int k=1; k<n; k++) {
+        if (incircle(vertexX[p],vertexY[p],vertexX[q],vertexY[q],vertexX[chain[c]],vertexY[chain[c]],
+                     vertexX[chain[k]],vertexY[chain[k]])>0) c=k;
     }
+    triangles.push_back({{p,q,chain[c]}});
+    triangulateCavity(chain[c],q,chain,c,triangles);
+    triangulateCavity(p,chain[c],chain+c+1,n-c-1,triangles);
 }
 
-QPair<Triangle*,Vector2D[4]> TriangleMesh::findOppositTriangle(Triangle *tri, Vector2D oppVertex) {
-    QPair<Triangle*,Vector2D[4]> res;
-
-    // search a triangle with (P0 oppVertex P1) vertices
-    auto it=tabTriangles.begin();
-    Triangle ref((*tri)[0],oppVertex,(*tri)[1]);
-    while (it!=tabTriangles.end() && !((*it)==ref)) {
-        it++;
-    }
-    if (it!=tabTriangles.end()) {
-        res.first = &(*it);
-        res.second[0]=(*tri)[0];
-        res.second[1]=oppVertex;
-        res.second[2]=(*tri)[1];
-        res.second[3]=(*tri)[2];
-        return res;
-    }
-    // search a triangle with (P1 oppVertex P2) vertices
-    it=tabTriangles.begin();
-    ref = Triangle((*tri)[1],oppVertex,(*tri)[2]);
-    while (it!=tabTriangles.end() && !((*it)==ref)) {
-        it++;
-    }
-    if (it!=tabTriangles.end()) {
-        res.first = &(*it);
-        res.second[0]=(*tri)[1];
-        res.second[1]=oppVertex;
-        res.second[2]=(*tri)[2];
-        res.second[3]=(*tri)[0];
-        return res;
-    }
-    // search a triangle with (P2 oppVertex P0) vertices
-    it=tabTriangles.begin();
-    ref = Triangle((*tri)[2],oppVertex,(*tri)[0]);
-    while (it!=tabTriangles.end() && !((*it)==ref)) {
-        it++;
-    }
-    if (it!=tabTriangles.end()) {
-        res.first = &(*it);
-        res.second[0]=(*tri)[2];
-        res.second[1]=oppVertex;
-        res.second[2]=(*tri)[0];
-        res.second[3]=(*tri)[1];
-        return res;
-    }
-    return res;
+int TriangleMesh::locate(int p,int start) const {
+    if (tabTriangles.isEmpty()) return -1;
+    // visibility walk: move across an edge that separates the triangle from p
+    int t=start;
+    for (int steps=0; steps<=tabTriangles.size(); steps++) {
+        const MeshTriangle &tri=tabTriangles[t];
+        int k=0;
+        while (k<3 && orient(tri[k],tri[(k+1)%3],p)>=0) k++;
+        if (k==3) return t;
+        if (adjacent[3*t+k]<0) break;
+        t=adjacent[3*t+k];
+    }
+    // cannot happen in a Delaunay mesh, avoids an endless walk on degenerate inputs
+    for (t=0; t<tabTriangles.size(); t++) {
+        if (contains(tabTriangles[t],p)) return t;
+    }
+    return -1;
+}
+
+void TriangleMesh::flipToDelaunay(QVector<int> &pending) {
+    // a mesh whose edges are all locally Delaunay is Delaunay: only the triangles changed by a flip are tested again
+    while (!pending.isEmpty()) {
+        int t=pending.takeLast();
+        int edge=0;
+        int neighbor=findFlip(t,edge);
+        if (neighbor>=0) {
+            flipTriangle(t,neighbor,edge);
+            pending.push_back(neighbor);
+            pending.push_back(t);
+        }
+    }
+}
+
+bool TriangleMesh::contains(const MeshTriangle &tri,int p) const {
+    return orient(tri[0],tri[1],p)>=0 && orient(tri[1],tri[2],p)>=0 && orient(tri[2],tri[0],p)>=0;
+}
+
+int TriangleMesh::findFlip(int t,int &edge) const {
+    const MeshTriangle &tri=tabTriangles[t];
+    for (int k=0; k<3; k++) {
+        int u=adjacent[3*t+k];
+        if (u<0) continue;
+        const MeshTriangle &other=tabTriangles[u];
+        int Q=other[(other.edgeIndex(tri[(k+1)%3],tri[k])+2)%3];
+        if (incircle(vertexX[tri[0]],vertexY[tri[0]],vertexX[tri[1]],vertexY[tri[1]],
+                     vertexX[tri[2]],vertexY[tri[2]],vertexX[Q],vertexY[Q])>0) {
+            edge=k;
+            return u;
+        }
+    }
+    return -1;
 }
 
-QVector<Vector2D> TriangleMesh::findOppositPointOfTrianglesWithCommonEdge(const Triangle &tri) {
-    QVector<Vector2D> res;
-    for (auto &t:tabTriangles) {
-        if (tri.hasEdge(t[1],t[0])) res.push_back(t[2]);
-        else if (tri.hasEdge(t[2],t[1])) res.push_back(t[0]);
-        else if (tri.hasEdge(t[0],t[2])) res.push_back(t[1]);
+void TriangleMesh::flipTriangle(int t,int neighbor,int edge) {
+    // t=(P0,P1,P2) and neighbor=(P1,P0,Q) become (P0,Q,P2) and (Q,P1,P2)
+    const MeshTriangle &tri=tabTriangles[t];
+    int P0=tri[edge],P1=tri[(edge+1)%3],P2=tri[(edge+2)%3];
+    const MeshTriangle &other=tabTriangles[neighbor];
+    int e=other.edgeIndex(P1,P0);
+    int Q=other[(e+2)%3];
+    // triangles along the 4 edges of the quadrilateral
+    int A=adjacent[3*t+(edge+1)%3]; // (P1,P2)
+    int B=adjacent[3*t+(edge+2)%3]; // (P2,P0)
+    int C=adjacent[3*neighbor+(e+1)%3]; // (P0,Q)
+    int D=adjacent[3*neighbor+(e+2)%3]; // (Q,P1)
+    tabTriangles[t]={{P0,Q,P2}};
+    tabTriangles[neighbor]={{Q,P1,P2}};
+    const int linksT[3]={C,neighbor,B},linksNeighbor[3]={D,A,t};
+    for (int k=0; k<3; k++) {
+        adjacent[3*t+k]=linksT[k];
+        adjacent[3*neighbor+k]=linksNeighbor[k];
     }
-    return res;
+    if (A>=0) adjacent[3*A+tabTriangles[A].edgeIndex(P2,P1)]=neighbor;
+    if (C>=0) adjacent[3*C+tabTriangles[C].edgeIndex(Q,P0)]=t;
+    vertexTriangle[P0]=t;
+    vertexTriangle[P1]=neighbor;
+    vertexTriangle[Q]=t;
+    vertexTriangle[P2]=t;
 }
@@ -1,29 +1,111 @@
 #ifndef TRIANGLEMESH_H
 #define TRIANGLEMESH_H
 
+#include <QSet>
 #include <serveranddrone.h>
 #include <polygon.h>
 
+/**
+ * @brief The MeshTriangle struct : CCW triangle of the mesh given by the indices of its vertices
+ * (indices of the servers in the list given to the mesh)
+ */
+struct MeshTriangle {
+    int v[3];
+    int operator[](int i) const { return v[i]; }
+    /**
+     * @brief edgeIndex
+     * @return i such that (a,b)=(v[i],v[i+1]), -1 if (a,b) is not an edge of the triangle
+     */
+    int edgeIndex(int a,int b) const {
+        if (a==v[0]) return b==v[1]?0:-1;
+        if (a==v[1]) return b==v[2]?1:-1;
+        if (a==v[2]) return b==v[0]?2:-1;
+        return -1;
+    }
+    /**
+     * @brief vertexIndex
+     * @return i such that v[i]=a, -1 if a is not a vertex of the triangle
+     */
+    int vertexIndex(int a) const {
+        return a==v[0]?0:(a==v[1]?1:(a==v[2]?2:-1));
+    }
+};
+
+/**
+ * @brief MeshEdge : segment between two vertices of the mesh (indices of the servers)
+ */
+typedef QPair<int,int> MeshEdge;
+
 class TriangleMesh {
 public:
-    TriangleMesh(QList<Server> &servers);
+    /**
+     * @brief TriangleMesh : Delaunay triangulation of the servers, constrained by segments between servers.
+     * Each segment is inserted in the Delaunay mesh by removing the triangles it crosses and
+     * triangulating again the two sides of the cavity, the other triangles are not changed.
+     * The segment is then an edge of the mesh (split at the servers on it) and the triangles are
+     * Delaunay only between vertices that see each other.
+     * @param constraints pairs of server indices, a segment crossing a previous one stops at the crossing
+     */
+    TriangleMesh(const QList<Server> &servers,const QVector<MeshEdge> &constraints=QVector<MeshEdge>());
     void setBox(const QPoint &origin,const QSize &size) { winX0=origin.x(); winY0=origin.y(); winX1=origin.x()+size.width(); winY1=origin.y()+size.height(); }
-    QVector<Triangle>* getTriangles() { return &tabTriangles; }
+    QVector<MeshTriangle>* getTriangles() { return &tabTriangles; }
+    Vector2D getVertex(int i) const { return Vector2D(vertexX[i],vertexY[i]); }
     bool isInWindow(int x,int y) const { return (x>winX0 && x<winX1 && y>winY0 && y<winY1); }
     bool isInWindow(const Vector2D pos) const { return (pos.x>winX0 && pos.x<winX1 && pos.y>winY0 && pos.y<winY1); }
     int getWindowXmin() const { return winX0; }
     int getWindowYmin() const { return winY0; }
     int getWindowXmax() const { return winX1; }
     int getWindowYmax() const { return winY1; }
+    /**
+     * @brief getConstraints
+     * @return the constrained edges of the mesh (the segments split at the vertices on them), sorted (a,b) with a<b
+     */
+    const QVector<MeshEdge>& getConstraints() const { return constrainedEdges; }
+    bool isConstrained(int a,int b) const;
 private:
-    bool checkDelaunay();
-    QVector<Vector2D> findOppositPointOfTrianglesWithCommonEdge(const Triangle &tri);
-    QPair<Triangle*,Vector2D[4]> findOppositTriangle(Triangle *tri, Vector2D oppVertex);
-    void flipTriangle(Triangle *);
+    bool contains(const MeshTriangle &tri,int p) const;
+    /**
+     * @brief locate : walk from the triangle start to a triangle that contains the vertex p
+     * @return the index of the triangle, -1 if p is outside the mesh
+     */
+    int locate(int p,int start) const;
+    /**
+     * @brief flipToDelaunay : flip the pending triangles and the triangles created by the flips until
+     * they are locally Delaunay
+     */
+    void flipToDelaunay(QVector<int> &pending);
+    double orient(int a,int b,int c) const {
+        return orient2d(vertexX[a],vertexY[a],vertexX[b],vertexY[b],vertexX[c],vertexY[c]);
+    }
+    /**
+     * @brief findFlip : search a neighbor of t whose opposite vertex is strictly inside the circumcircle of t
+     * @param t index of the triangle
+     * @param edge set to the index in t of the first vertex of the common edge
+     * @return the index of the neighbor, -1 if none
+     */
+    int findFlip(int t,int &edge) const;
+    /**
+     * @brief flipTriangle : replace the common edge of t and neighbor by the other diagonal of their quadrilateral
+     * (adjacency updated)
+     */
+    void flipTriangle(int t,int neighbor,int edge);
+    void buildAdjacency();
+    /**
+     * @brief insertEdge : insert the constrained edge from a to the first vertex of the segment [ab]
+     * @return the vertex reached (b or a vertex on [ab]), -1 if [ab] crosses a constrained edge
+     */
+    int insertEdge(int a,int b);
+    /**
+     * @brief triangulateCavity : constrained Delaunay triangulation of the polygon (p,q,chain[0],...,chain[n-1]) (CCW)
+     */
+    void triangulateCavity(int p,int q,const int *chain,int n,QVector<MeshTriangle> &triangles) const;
 
-    QVector<Vector2D> tabVertices;
-    QVector<Triangle> tabTriangles;
-    Polygon* convexHull=nullptr;
+    QVector<double> vertexX,vertexY; ///< coordinates of the vertices
+    QVector<MeshTriangle> tabTriangles;
+    QVector<int> adjacent; ///< adjacent[3*t+k] is the triangle across the edge (v[k],v[k+1]) of t, -1 on the hull
+    QVector<int> vertexTriangle; ///< a triangle of each vertex, -1 if the vertex is not in the mesh
+    QSet<quint64> constrainedKeys;
+    QVector<MeshEdge> constrainedEdges;
     int winX0,winX1,winY0,winY1;
 };
 
@@ -62,5 +62,20 @@ double operator ^(const Vector2D&,const Vector2D&);
 bool operator==(const Vector2D&,const Vector2D&);
 bool operator !=(const Vector2D&,const Vector2D&);
 
+/**
+ * @brief fastAtan2 : atan2(y,x) with a polynomial approximation of atan on [0,1]
+ * (error < 2e-5 rad) and selects instead of branches, so that loops are vectorized.
+ * @return angle in [-pi,pi], 0 for (0,0)
+ */
+inline float fastAtan2(float y,float x) {
+    float ax=std::fabs(x),ay=std::fabs(y);
+    float mx=ax>ay?ax:ay,mn=ax>ay?ay:ax;
+    float a=mn/(mx+1e-30f);
+    float s=a*a;
+    float r=((((0.0208351f*s-0.0851330f)*s+0.1801410f)*s-0.3302995f)*s+0.9998660f)*a;
+    r=(ay>ax)?1.57079637f-r:r;
+    r=(x<0)?3.14159274f-r:r;
+    return (y<0)?-r:r;
+}
 
 #endif // VECTOR2D_H
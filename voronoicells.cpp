@@ -0,0 +1,433 @@
+#include "voronoicells.h"
+#include <QMutexLocker>
+#include <profiler.h>
+#include <scratchbuffer.h>
+#include <rtree.h>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+namespace {
+const int maxLocateSearch=64; ///< servers tested by locate() around the closest server when it is behind a barrier
+}
+
+void VoronoiCells::build(const QList<Server> &servers,const QPoint &origin,const QSize &size,const QVector<MeshEdge> &barriers) {
+    QVector<MeshTriangle> triangles;
+    QVector<MeshEdge> edges;
+    if (servers.size()>=3) {
+        // the vertices of the mesh are the indices of the servers
+        TriangleMesh mesh(servers,barriers);
+        triangles.swap(*mesh.getTriangles());
+        edges=mesh.getConstraints();
+    }
+    build(servers,triangles,origin,size,edges);
+}
+
+void VoronoiCells::build(const QList<Server> &servers,const QVector<MeshTriangle> &triangles,const QPoint &origin,const QSize &size,
+                         const QVector<MeshEdge> &barriers) {
+    PROFILE_SCOPE("VoronoiCells::build");
+    clear();
+    int n=servers.size();
+    x0=origin.x();
+    y0=origin.y();
+    x1=x0+size.width();
+    y1=y0+size.height();
+    siteX.reserve(n);
+    siteY.reserve(n);
+    for (auto &s:servers) {
+        siteX.push_back(s.position.x());
+        siteY.push_back(s.position.y());
+    }
+    // directed edges of the triangles: (i,j) without (j,i) is an edge of the convex hull
+    ScratchBuffer<QPair<int,int>> edges;
+    edges->reserve(6*triangles.size());
+    for (auto &tri:triangles) {
+        for (int k=0; k<3; k++) edges->push_back({tri[k],tri[(k+1)%3]});
+    }
+    std::sort(edges->begin(),edges->end());
+    QVector<bool> unbounded(n,false);
+    int nbDirected=edges->size();
+    for (int e=0; e<nbDirected; e++) {
+        auto &edge=(*edges)[e];
+        if (!std::binary_search(edges->begin(),edges->begin()+nbDirected,qMakePair(edge.second,edge.first))) {
+            unbounded[edge.first]=unbounded[edge.second]=true;
+            edges->push_back({edge.second,edge.first});
+        }
+    }
+    std::sort(edges->begin(),edges->end());
+    edges->resize(std::unique(edges->begin(),edges->end())-edges->begin());
+    if (!edges->isEmpty()) {
+        // a duplicated server is not in the triangles: it gets the neighbors of the server at its position
+        // and their duplicates
+        ScratchBuffer<QPair<QPair<double,double>,int>> vertices;
+        for (int e=0; e<edges->size(); e++) {
+            int i=(*edges)[e].first;
+            if (e==0 || (*edges)[e-1].first!=i) vertices->push_back({{siteX[i],siteY[i]},i});
+        }
+        std::sort(vertices->begin(),vertices->end());
+        ScratchBuffer<QPair<int,int>> twins; ///< (server of the mesh,duplicated server)
+        for (int i=0; i<n; i++) {
+            auto first=std::lower_bound(edges->begin(),edges->end(),qMakePair(i,-1));
+            if (first!=edges->end() && first->first==i) continue;
+            auto twin=std::lower_bound(vertices->begin(),vertices->end(),qMakePair(qMakePair(siteX[i],siteY[i]),-1));
+            if (twin==vertices->end() || twin->first!=qMakePair(siteX[i],siteY[i])) continue;
+            twins->push_back({twin->second,i});
+            unbounded[i]=true; // no triangle gives its box
+        }
+        std::sort(twins->begin(),twins->end());
+        ScratchBuffer<QPair<int,int>> copies;
+        for (auto &t:*twins) {
+            for (auto e=std::lower_bound(edges->begin(),edges->end(),qMakePair(t.first,-1)); e!=edges->end() && e->first==t.first; e++) {
+                copies->push_back({t.second,e->second});
+                for (auto d=std::lower_bound(twins->begin(),twins->end(),qMakePair(e->second,-1)); d!=twins->end() && d->first==e->second; d++) {
+                    copies->push_back({t.second,d->second});
+                }
+            }
+        }
+        *edges+=*copies;
+        std::sort(edges->begin(),edges->end());
+    }
+    neighborStart.fill(0,n+1);
+    neighborIds.reserve(edges->size());
+    for (auto &e:*edges) {
+        neighborStart[e.first+1]++;
+        neighborIds.push_back(e.second);
+    }
+    for (int i=0; i<n; i++) neighborStart[i+1]+=neighborStart[i];
+
+    barrierStart.fill(0,n+1);
+    // the cell of an inner server is the polygon of the circumcenters of its triangles
+    boxes.resize(n);
+    for (int i=0; i<n; i++) {
+        Vector2D p(siteX[i],siteY[i]);
+        boxes[i]={p,p};
+        unbounded[i]=unbounded[i] || neighborStart[i]==neighborStart[i+1];
+    }
+    for (auto &tri:triangles) {
+        // circumcenter relative to the first vertex
+        double bx=siteX[tri[1]]-siteX[tri[0]],by=siteY[tri[1]]-siteY[tri[0]];
+        double cx=siteX[tri[2]]-siteX[tri[0]],cy=siteY[tri[2]]-siteY[tri[0]];
+        double d=2.0*(bx*cy-by*cx);
+        if (d==0) {
+            for (int k=0; k<3; k++) unbounded[tri[k]]=true;
+            continue;
+        }
+        double b2=bx*bx+by*by,c2=cx*cx+cy*cy;
+        float ux=float(siteX[tri[0]]+(cy*b2-by*c2)/d);
+        float uy=float(siteY[tri[0]]+(bx*c2-cx*b2)/d);
+        for (int k=0; k<3; k++) {
+            auto &box=boxes[tri[k]];
+            box.first={qMin(box.first.x,ux),qMin(box.first.y,uy)};
+            box.second={qMax(box.second.x,ux),qMax(box.second.y,uy)};
+        }
+    }
+    // the triangles are locally Delaunay across the unconstrained edges: the circumcenters are
+    // the vertices of the cells except around the servers at the ends of the barriers
+    for (auto &b:barriers) {
+        unbounded[b.first]=unbounded[b.second]=true;
+    }
+    setBounds(unbounded);
+    if (!barriers.isEmpty()) cutByBarriers(barriers);
+    cells.resize(n);
+    lruPrev.fill(invalidId,n);
+    lruNext.fill(invalidId,n);
+}
+
+void VoronoiCells::setBounds(const QVector<bool> &unbounded) {
+    // the cells are clipped by the window, the unbounded cells (convex hull) are clipped
+    // to get their box: O(sqrt(n)) of them on usual maps
+    for (int i=0; i<siteX.size(); i++) {
+        auto &box=boxes[i];
+        if (unbounded[i]) {
+            if (neighborStart[i]==neighborStart[i+1]) {
+                box={Vector2D(x0,y0),Vector2D(x1,y1)};
+            } else {
+                Polygon area=clip(i);
+                if (area.nbVertices()>0) box=area.getBoundingBox();
+            }
+        } else {
+            box.first={qMax(box.first.x,float(x0)),qMax(box.first.y,float(y0))};
+            box.second={qMin(box.second.x,float(x1)),qMin(box.second.y,float(y1))};
+        }
+    }
+}
+
+void VoronoiCells::cutByBarriers(const QVector<MeshEdge> &constraints) {
+    PROFILE_SCOPE("VoronoiCells::cutByBarriers");
+    int n=siteX.size();
+    barriers=constraints;
+    QVector<QPair<Vector2D,Vector2D>> barrierBoxes;
+    barrierBoxes.reserve(barriers.size());
+    for (auto &b:barriers) {
+        barrierBoxes.push_back({Vector2D(qMin(siteX[b.first],siteX[b.second]),qMin(siteY[b.first],siteY[b.second])),
+                                Vector2D(qMax(siteX[b.first],siteX[b.second]),qMax(siteY[b.first],siteY[b.second]))});
+    }
+    barrierIndex.build(barrierBoxes);
+    ScratchBuffer<int> candidates;
+    ScratchBuffer<Vector2D> clipBuffer;
+    ScratchBuffer<MeshEdge> lines;
+    for (int i=0; i<n; i++) {
+        // the box of the cell (bisectors only) does not meet a barrier on most maps: no clipping
+        candidates->clear();
+        barrierIndex.query(boxes[i].first,boxes[i].second,[&](int k) {
+            if (barriers[k].first!=i && barriers[k].second!=i) candidates->push_back(k);
+        });
+        if (candidates->isEmpty()) continue;
+        std::sort(candidates->begin(),candidates->end());
+        // no barrier line is recorded yet: the cell is clipped by the bisectors only
+        Polygon area=clip(i);
+        const double px=siteX[i],py=siteY[i];
+        for (int k:*candidates) {
+            int u=barriers[k].first,v=barriers[k].second;
+            if (area.nbVertices()==0) break;
+            double side=orient2d(siteX[u],siteY[u],siteX[v],siteY[v],px,py);
+            if (side==0) continue;
+            if (side<0) std::swap(u,v);
+            // the part of the cell behind the line of the barrier is either hidden from the server
+            // or not at all, the ends of the barrier being closer than the server beyond them
+            double a=siteY[u]-siteY[v],b=siteX[v]-siteX[u];
+            double c=-(a*siteX[u]+b*siteY[u]);
+            Polygon behind=area;
+            behind.clipHalfPlane(-a,-b,-c,*clipBuffer);
+            double twiceArea=0,gx=0,gy=0;
+            for (int j=0; j<behind.nbVertices(); j++) {
+                const Vector2D &A=behind[j],&B=behind[(j+1)%behind.nbVertices()];
+                double cross=double(A.x)*B.y-double(B.x)*A.y;
+                twiceArea+=cross;
+                gx+=(double(A.x)+B.x)*cross;
+                gy+=(double(A.y)+B.y)*cross;
+            }
+            if (twiceArea<=voronoiMinEdgeLength*voronoiMinEdgeLength) continue;
+            gx/=3*twiceArea;
+            gy/=3*twiceArea;
+            if (orient2d(px,py,gx,gy,siteX[u],siteY[u])*orient2d(px,py,gx,gy,siteX[v],siteY[v])<0) {
+                area.clipHalfPlane(a,b,c,*clipBuffer);
+                lines->push_back({u,v});
+                barrierStart[i+1]++;
+            }
+        }
+        if (area.nbVertices()>0) {
+            boxes[i]=area.getBoundingBox();
+        } else {
+            boxes[i]={Vector2D(px,py),Vector2D(px,py)};
+        }
+    }
+    for (int i=0; i<n; i++) barrierStart[i+1]+=barrierStart[i];
+    barrierLines=*lines;
+}
+
+void VoronoiCells::clear() {
+    QMutexLocker lock(&mutex);
+    siteX.clear();
+    siteY.clear();
+    neighborStart.fill(0,1);
+    neighborIds.clear();
+    barrierStart.fill(0,1);
+    barrierLines.clear();
+    barriers.clear();
+    barrierIndex.clear();
+    boxes.clear();
+    cells.clear();
+    lruPrev.clear();
+    lruNext.clear();
+    lruFirst=lruLast=invalidId;
+    built=0;
+}
+
+void VoronoiCells::setCacheSize(int n) {
+    QMutexLocker lock(&mutex);
+    cacheSize=n;
+    while (cacheSize>0 && built>cacheSize) evict();
+}
+
+int VoronoiCells::nbBuilt() const {
+    QMutexLocker lock(&mutex);
+    return built;
+}
+
+QSharedPointer<const Polygon> VoronoiCells::cell(ServerId i) const {
+    QMutexLocker lock(&mutex);
+    if (cells[i].isNull()) {
+        cells[i]=QSharedPointer<const Polygon>(new Polygon(clip(i)));
+        built++;
+        lruPrev[i]=invalidId;
+        lruNext[i]=lruFirst;
+        if (lruFirst!=invalidId) lruPrev[lruFirst]=i;
+        lruFirst=i;
+        if (lruLast==invalidId) lruLast=i;
+        while (cacheSize>0 && built>cacheSize) evict();
+    } else if (cacheSize>0) {
+        touch(i);
+    }
+    return cells[i];
+}
+
+void VoronoiCells::touch(ServerId i) const {
+    if (lruFirst==i) return;
+    // i has a previous cell: unlink it and insert it first
+    lruNext[lruPrev[i]]=lruNext[i];
+    if (lruNext[i]!=invalidId) lruPrev[lruNext[i]]=lruPrev[i];
+    else lruLast=lruPrev[i];
+    lruPrev[i]=invalidId;
+    lruNext[i]=lruFirst;
+    lruPrev[lruFirst]=i;
+    lruFirst=i;
+}
+
+void VoronoiCells::evict() const {
+    ServerId i=lruLast;
+    lruLast=lruPrev[i];
+    if (lruLast!=invalidId) lruNext[lruLast]=invalidId;
+    else lruFirst=invalidId;
+    lruPrev[i]=invalidId;
+    cells[i].reset();
+    built--;
+}
+
+Polygon VoronoiCells::clip(ServerId i) const {
+    // the cell of P is the window clipped by the bisectors of P and its neighbors
+    ScratchBuffer<Vector2D> clipBuffer;
+    Polygon area;
+    area.reserve(4);
+    area.addVertex(x0,y0);
+    area.addVertex(x1,y0);
+    area.addVertex(x1,y1);
+    area.addVertex(x0,y1);
+    const double px=siteX[i],py=siteY[i];
+    forEachNeighbor(i,[&](int j) {
+        if (area.nbVertices()==0) return;
+        const double qx=siteX[j],qy=siteY[j];
+        if (qx==px && qy==py) return;
+        // keep X such that |XP|<=|XQ| : (P-Q).X+(|Q|^2-|P|^2)/2>=0
+        area.clipHalfPlane(px-qx,py-qy,0.5*((qx*qx+qy*qy)-(px*px+py*py)),*clipBuffer);
+    });
+    clipByBarriers(i,[&](double a,double b,double c) {
+        if (area.nbVertices()>0) area.clipHalfPlane(a,b,c,*clipBuffer);
+    });
+    // degree-4 Voronoi vertices (grids) give tiny edges
+    area.removeCloseVertices(voronoiMinEdgeLength);
+    area.prepare();
+    return area;
+}
+
+ServerId VoronoiCells::locate(const Vector2D &p,ServerId hint) const {
+    int n=siteX.size();
+    if (n==0 || p.x<x0 || p.x>x1 || p.y<y0 || p.y>y1) return invalidId;
+    auto distance2=[this,&p](int j) {
+        double dx=siteX[j]-p.x,dy=siteY[j]-p.y;
+        return dx*dx+dy*dy;
+    };
+    ServerId current=(hint>=0 && hint<n)?hint:0;
+    double best=distance2(current);
+    // a server that is not the closest one has a closer Delaunay neighbor
+    for (;;) {
+        ServerId next=current;
+        forEachNeighbor(current,[&](int j) {
+            double d=distance2(j);
+            if (d<best) {
+                best=d;
+                next=j;
+            }
+        });
+        if (next==current) break;
+        current=next;
+    }
+    if (barriers.isEmpty() || contains(current,p)) return current;
+    // the closest server is behind a barrier: breadth-first search of the cell around it
+    ScratchBuffer<ServerId> visited;
+    visited->push_back(current);
+    for (int k=0; k<visited->size() && visited->size()<maxLocateSearch; k++) {
+        ServerId found=invalidId;
+        forEachNeighbor((*visited)[k],[&](int j) {
+            if (found!=invalidId || visited->contains(j)) return;
+            if (contains(j,p)) found=j;
+            else visited->push_back(j);
+        });
+        if (found!=invalidId) return found;
+    }
+    // p is in no cell (near the end of a barrier): the closest server around that p sees,
+    // the closest server is hidden
+    std::sort(visited->begin(),visited->end(),[&distance2](ServerId a,ServerId b) { return distance2(a)<distance2(b); });
+    for (ServerId j:*visited) {
+        if (!isHidden(j,p)) return j;
+    }
+    return invalidId;
+}
+
+bool VoronoiCells::isHidden(ServerId i,const Vector2D &p) const {
+    const double sx=siteX[i],sy=siteY[i];
+    Vector2D s(sx,sy);
+    bool hidden=false;
+    barrierIndex.query(Vector2D(qMin(s.x,p.x),qMin(s.y,p.y)),Vector2D(qMax(s.x,p.x),qMax(s.y,p.y)),[&](int k) {
+        int u=barriers[k].first,v=barriers[k].second;
+        if (hidden || u==i || v==i) return;
+        // proper crossing of [s,p] and [u,v]
+        double a=orient2d(siteX[u],siteY[u],siteX[v],siteY[v],sx,sy);
+        double b=orient2d(siteX[u],siteY[u],siteX[v],siteY[v],p.x,p.y);
+        double c=orient2d(sx,sy,p.x,p.y,siteX[u],siteY[u]);
+        double d=orient2d(sx,sy,p.x,p.y,siteX[v],siteY[v]);
+        hidden=((a>0 && b<0) || (a<0 && b>0)) && ((c>0 && d<0) || (c<0 && d>0));
+    });
+    return hidden;
+}
+
+bool VoronoiCells::contains(ServerId i,const Vector2D &p) const {
+    auto distance2=[this,&p](int j) {
+        double dx=siteX[j]-p.x,dy=siteY[j]-p.y;
+        return dx*dx+dy*dy;
+    };
+    const double d=distance2(i);
+    bool inside=true;
+    forEachNeighbor(i,[&](int j) {
+        if (inside && distance2(j)<d) inside=false;
+    });
+    clipByBarriers(i,[&](double a,double b,double c) {
+        if (a*p.x+b*p.y+c<0) inside=false;
+    });
+    return inside;
+}
+
+bool VoronoiCells::commonEdge(ServerId i,ServerId j,QPair<Vector2D,Vector2D> &edge) const {
+    const double px=siteX[i],py=siteY[i],qx=siteX[j],qy=siteY[j];
+    if (px==qx && py==qy) return false;
+    // the bisector of P and Q is M+t*D, clipped like the cell of P
+    const double mx=0.5*(px+qx),my=0.5*(py+qy);
+    const double dx=py-qy,dy=qx-px;
+    double lo=-std::numeric_limits<double>::infinity();
+    double hi=std::numeric_limits<double>::infinity();
+    auto clipLine=[&](double a,double b,double c) {
+        // keep a*x+b*y+c>=0
+        double ad=a*dx+b*dy,am=a*mx+b*my+c;
+        if (ad>0) lo=qMax(lo,-am/ad);
+        else if (ad<0) hi=qMin(hi,-am/ad);
+        else if (am<0) hi=-std::numeric_limits<double>::infinity();
+    };
+    clipLine(1,0,-x0);
+    clipLine(-1,0,x1);
+    clipLine(0,1,-y0);
+    clipLine(0,-1,y1);
+    forEachNeighbor(i,[&](int k) {
+        const double kx=siteX[k],ky=siteY[k];
+        if (k==j || (kx==px && ky==py)) return;
+        clipLine(px-kx,py-ky,0.5*((kx*kx+ky*ky)-(px*px+py*py)));
+    });
+    clipByBarriers(i,clipLine);
+    if (!barriers.isEmpty()) {
+        // i and j do not have the same neighbors near a barrier: the edge is also clipped like the cell of j
+        forEachNeighbor(j,[&](int k) {
+            const double kx=siteX[k],ky=siteY[k];
+            if (k==i || (kx==qx && ky==qy)) return;
+            clipLine(qx-kx,qy-ky,0.5*((kx*kx+ky*ky)-(qx*qx+qy*qy)));
+        });
+        clipByBarriers(j,clipLine);
+    }
+    if ((hi-lo)*std::sqrt(dx*dx+dy*dy)<=voronoiMinEdgeLength) return false;
+    edge={Vector2D(mx+lo*dx,my+lo*dy),Vector2D(mx+hi*dx,my+hi*dy)};
+    return true;
+}
+
+bool VoronoiCells::isNeighbor(ServerId i,ServerId j) const {
+    int first=neighborStart[i],last=neighborStart[i+1];
+    if (first==last) return i!=j;
+    return std::binary_search(neighborIds.begin()+first,neighborIds.begin()+last,j);
+}
@@ -0,0 +1,155 @@
+#ifndef VORONOICELLS_H
+#define VORONOICELLS_H
+
+#include <QVector>
+#include <QPair>
+#include <QPoint>
+#include <QSize>
+#include <QMutex>
+#include <QSharedPointer>
+#include <serveranddrone.h>
+#include <trianglemesh.h>
+#include <rtree.h>
+
+/// vertices of a cell closer than this length are merged, shorter common edges give no link
+const float voronoiMinEdgeLength=0.01f;
+
+/**
+ * @brief The VoronoiCells class stores the Delaunay triangulation of the servers and builds
+ * their cells (the window clipped by the bisectors of the server and its neighbors) the first
+ * time they are used. The cells are memoized, an optional LRU eviction (setCacheSize) caps the
+ * memory when only a region of a huge map is drawn.
+ * The queries that do not need the polygons only read the triangulation: locate() finds the cell
+ * of a point, bounds() and commonEdge() give the box of a cell and the edge between two cells,
+ * so the drones, the links and the index of the canvas never build a cell.
+ * Barriers (segments between servers) are constraints of the triangulation: the servers that do
+ * not see each other are not neighbors, and a cell is also cut by the line of each barrier that
+ * hides a part of the cell from its server (the points of a cell see its server).
+ * So no link crosses a barrier, and a cell only crosses the barriers that end at its server.
+ * The cells stay convex: near the ends of the barriers, small areas hidden from the servers
+ * of the cells around them are in no cell, locate() gives them the closest server they see.
+ * cell() is thread safe, the cells can be shared by the fleets of several threads.
+ * @warning server ids must be their index in the server list.
+ */
+class VoronoiCells {
+public:
+    VoronoiCells() { neighborStart.fill(0,1); barrierStart.fill(0,1); }
+    /**
+     * @brief build : Delaunay triangulation of the servers, no cell is built
+     * @param origin,size window of the map, the cells are clipped in it
+     * @param barriers segments between servers (constraints of the triangulation)
+     */
+    void build(const QList<Server> &servers,const QPoint &origin,const QSize &size,
+               const QVector<MeshEdge> &barriers=QVector<MeshEdge>());
+    /**
+     * @brief build : same with a triangulation given by the caller (consistent orientation)
+     * @param barriers pairs of servers, edges of the triangles
+     */
+    void build(const QList<Server> &servers,const QVector<MeshTriangle> &triangles,const QPoint &origin,const QSize &size,
+               const QVector<MeshEdge> &barriers=QVector<MeshEdge>());
+    void clear();
+    int size() const { return siteX.size(); }
+    /**
+     * @brief setCacheSize : maximal number of cells kept in memory, the least recently used
+     * are evicted first
+     * @param n 0 to keep all the cells
+     */
+    void setCacheSize(int n);
+    /**
+     * @brief cell : cell of server i, built at the first call
+     * @return the polygon (prepared for contains()), still valid if the cache evicts it
+     */
+    QSharedPointer<const Polygon> cell(ServerId i) const;
+    /**
+     * @brief nbBuilt
+     * @return the number of cells in memory
+     */
+    int nbBuilt() const;
+    /**
+     * @brief locate : server of the cell containing p (the closest server), by a walk on the
+     * Delaunay neighbors that only moves to closer servers. When the closest server is behind
+     * a barrier, the cell is searched among the servers around it. When p is in no cell, the
+     * closest of these servers that p sees (no barrier between them) is returned.
+     * @param hint first server of the walk (the current cell of a drone), the walk is short when it is close to p
+     * @return invalidId if p is outside of the window or if it sees none of the servers around it
+     */
+    ServerId locate(const Vector2D &p,ServerId hint=invalidId) const;
+    /**
+     * @brief bounds : box of the cell of i (circumcenters of its triangles in the window), the cell is not built
+     * (maps with barriers: the cells of the servers on a barrier or whose box meets one are clipped by build)
+     */
+    const QPair<Vector2D,Vector2D>& bounds(ServerId i) const { return boxes[i]; }
+    /**
+     * @brief commonEdge : edge between the cells of i and j, part of their bisector in the cell of i
+     * (and in the cell of j when there are barriers)
+     * @param edge extremities of the edge
+     * @return false if the cells do not share an edge longer than voronoiMinEdgeLength
+     */
+    bool commonEdge(ServerId i,ServerId j,QPair<Vector2D,Vector2D> &edge) const;
+    /**
+     * @brief forEachNeighbor : call f(j) for the Delaunay neighbors j of i
+     * (all the other servers when i is in no triangle: less than 3 servers or collinear servers,
+     * a duplicated server has the neighbors of the server at its position)
+     */
+    template<class F> void forEachNeighbor(ServerId i,F f) const {
+        int first=neighborStart[i],last=neighborStart[i+1];
+        if (first==last) {
+            for (int j=0; j<siteX.size(); j++) {
+                if (j!=i) f(j);
+            }
+        } else {
+            for (int k=first; k<last; k++) f(neighborIds[k]);
+        }
+    }
+    /**
+     * @brief isNeighbor : j is given by forEachNeighbor(i)
+     */
+    bool isNeighbor(ServerId i,ServerId j) const;
+    bool hasBarriers() const { return !barriers.isEmpty(); }
+    /**
+     * @brief isHidden : a barrier crosses the segment between the server i and p
+     */
+    bool isHidden(ServerId i,const Vector2D &p) const;
+private:
+    void setBounds(const QVector<bool> &unbounded);
+    /**
+     * @brief cutByBarriers : index the barriers, clip the cells whose box meets a barrier to get
+     * the barriers that cut them and their boxes (the other cells are not built)
+     */
+    void cutByBarriers(const QVector<MeshEdge> &constraints);
+    /**
+     * @brief clipByBarriers : call clipLine(a,b,c) for the half-planes a*x+b*y+c>=0 of the barriers that cut the cell of i
+     */
+    template<class F> void clipByBarriers(ServerId i,F clipLine) const {
+        for (int k=barrierStart[i]; k<barrierStart[i+1]; k++) {
+            // i is on the left of (u,v)
+            const MeshEdge &line=barrierLines[k];
+            double ux=siteX[line.first],uy=siteY[line.first];
+            double a=uy-siteY[line.second],b=siteX[line.second]-ux;
+            clipLine(a,b,-(a*ux+b*uy));
+        }
+    }
+    bool contains(ServerId i,const Vector2D &p) const;
+    Polygon clip(ServerId i) const;
+    void touch(ServerId i) const;
+    void evict() const;
+
+    QVector<double> siteX,siteY;
+    QVector<int> neighborStart; ///< neighbors of i are neighborIds[neighborStart[i]..neighborStart[i+1][, sorted
+    QVector<ServerId> neighborIds;
+    QVector<int> barrierStart; ///< barriers that cut the cell of i are barrierLines[barrierStart[i]..barrierStart[i+1][
+    QVector<MeshEdge> barrierLines; ///< directed barriers, the server is on their left
+    QVector<MeshEdge> barriers; ///< constrained edges of the triangulation
+    RTree barrierIndex; ///< boxes of the barriers
+    QVector<QPair<Vector2D,Vector2D>> boxes;
+    double x0=0,y0=0,x1=0,y1=0; ///< window
+    int cacheSize=0;
+
+    mutable QMutex mutex; ///< protects the cells and the LRU list
+    mutable QVector<QSharedPointer<const Polygon>> cells;
+    mutable QVector<ServerId> lruPrev,lruNext; ///< built cells, most recently used first
+    mutable ServerId lruFirst=invalidId,lruLast=invalidId;
+    mutable int built=0;
+};
+
+#endif // VORONOICELLS_H